@@ -10,7 +10,18 @@
 #include "dlgdebug.h"
 
 #include <qcheckbox.h>
+#include <qgroupbox.h>
+#include <qheaderview.h>
 #include <qlayout.h>
+#include <qpushbutton.h>
+#include <qtimer.h>
+#include <qtreewidget.h>
+
+#include <kglobal.h>
+#include <klocale.h>
+
+#include "core/document.h"
+#include "core/renderstatistics.h"
 
 #define DEBUG_SIMPLE_BOOL( cfgname, layout ) \
 { \
@@ -19,8 +30,31 @@
     layout->addWidget( foo ); \
 }
 
-DlgDebug::DlgDebug( QWidget * parent )
-    : QWidget( parent )
+static void addStatisticsItem( QTreeWidgetItem * parent, const QString & name, const QString & value )
+{
+    QTreeWidgetItem * item = new QTreeWidgetItem( parent );
+    item->setText( 0, name );
+    item->setText( 1, value );
+}
+
+static void addLatencyItems( QTreeWidgetItem * parent, const Okular::RenderStatistics & stats, Okular::RenderStatistics::Operation operation )
+{
+    addStatisticsItem( parent, "Count", QString::number( stats.operationCount( operation ) ) );
+    addStatisticsItem( parent, "Average", QString( "%1 ms" ).arg( stats.averageLatency( operation ), 0, 'f', 1 ) );
+    addStatisticsItem( parent, "Maximum", QString( "%1 ms" ).arg( stats.maximumLatency( operation ) ) );
+
+    const QList< int > buckets = Okular::RenderStatistics::latencyBuckets();
+    const QVector< qulonglong > histogram = stats.latencyHistogram( operation );
+    for ( int i = 0; i < histogram.count(); ++i )
+    {
+        const QString bucket = i < buckets.count() ? QString( "<= %1 ms" ).arg( buckets.at( i ) )
+                                                   : QString( "> %1 ms" ).arg( buckets.last() );
+        addStatisticsItem( parent, bucket, QString::number( histogram.at( i ) ) );
+    }
+}
+
+DlgDebug::DlgDebug( Okular::Document * document, QWidget * parent )
+    : QWidget( parent ), m_document( document ), m_statistics( 0 )
 {
     QVBoxLayout * lay = new QVBoxLayout( this );
     lay->setMargin( 0 );
@@ -29,5 +63,67 @@ DlgDebug::DlgDebug( QWidget * parent )
     DEBUG_SIMPLE_BOOL( "DebugDrawAnnotationRect", lay );
     DEBUG_SIMPLE_BOOL( "TocPageColumn", lay );
 
-    lay->addItem( new QSpacerItem( 5, 5, QSizePolicy::Fixed, QSizePolicy::MinimumExpanding ) );
+    if ( !m_document )
+    {
+        lay->addItem( new QSpacerItem( 5, 5, QSizePolicy::Fixed, QSizePolicy::MinimumExpanding ) );
+        return;
+    }
+
+    QGroupBox * statsBox = new QGroupBox( "Render statistics", this );
+    lay->addWidget( statsBox, 1 );
+    QVBoxLayout * statsLay = new QVBoxLayout( statsBox );
+    m_statistics = new QTreeWidget( statsBox );
+    m_statistics->setColumnCount( 2 );
+    m_statistics->setHeaderLabels( QStringList() << "Statistic" << "Value" );
+    m_statistics->setRootIsDecorated( true );
+    m_statistics->setAlternatingRowColors( true );
+    m_statistics->header()->setResizeMode( 0, QHeaderView::ResizeToContents );
+    statsLay->addWidget( m_statistics );
+    QPushButton * resetButton = new QPushButton( "Reset", statsBox );
+    statsLay->addWidget( resetButton, 0, Qt::AlignRight );
+    connect( resetButton, SIGNAL(clicked()), this, SLOT(resetStatistics()) );
+
+    QTimer * timer = new QTimer( this );
+    connect( timer, SIGNAL(timeout()), this, SLOT(updateStatistics()) );
+    timer->start( 1000 );
+
+    updateStatistics();
 }
+
+void DlgDebug::updateStatistics()
+{
+    const Okular::RenderStatistics stats = m_document->renderStatistics();
+    KLocale * locale = KGlobal::locale();
+
+    m_statistics->clear();
+
+    QTreeWidgetItem * general = new QTreeWidgetItem( m_statistics, QStringList() << "Generator" << stats.generatorName() );
+    addStatisticsItem( general, "Queued requests", QString::number( stats.queuedRequests() ) );
+    addStatisticsItem( general, "Executing requests", QString::number( stats.executingRequests() ) );
+    addStatisticsItem( general, "Requests sent", QString::number( stats.counter( Okular::RenderStatistics::PixmapRequests ) ) );
+    addStatisticsItem( general, "Cache hits", QString::number( stats.counter( Okular::RenderStatistics::PixmapCacheHits ) ) );
+    addStatisticsItem( general, "Dropped as too large", QString::number( stats.counter( Okular::RenderStatistics::PixmapRequestsTooLarge ) ) );
+
+    QTreeWidgetItem * memory = new QTreeWidgetItem( m_statistics, QStringList() << "Pixmap memory" );
+    addStatisticsItem( memory, "In use", locale->formatByteSize( stats.bytesInUse() ) );
+    addStatisticsItem( memory, "Allocated", locale->formatByteSize( stats.bytesAllocated() ) );
+    addStatisticsItem( memory, "Evicted", locale->formatByteSize( stats.bytesEvicted() ) );
+    addStatisticsItem( memory, "Pixmaps evicted", QString::number( stats.counter( Okular::RenderStatistics::PixmapsEvicted ) ) );
+
+    QTreeWidgetItem * rendering = new QTreeWidgetItem( m_statistics, QStringList() << "Render latency" );
+    addLatencyItems( rendering, stats, Okular::RenderStatistics::PixmapRendering );
+
+    QTreeWidgetItem * text = new QTreeWidgetItem( m_statistics, QStringList() << "Text extraction" );
+    addStatisticsItem( text, "Text pages evicted", QString::number( stats.counter( Okular::RenderStatistics::TextPagesEvicted ) ) );
+    addLatencyItems( text, stats, Okular::RenderStatistics::TextExtraction );
+
+    m_statistics->expandAll();
+}
+
+void DlgDebug::resetStatistics()
+{
+    m_document->resetRenderStatistics();
+    updateStatistics();
+}
+
+#include "dlgdebug.moc"
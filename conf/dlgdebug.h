@@ -12,10 +12,26 @@
 
 #include <qwidget.h>
 
+class QTreeWidget;
+
+namespace Okular {
+class Document;
+}
+
 class DlgDebug : public QWidget
 {
+    Q_OBJECT
+
     public:
-        DlgDebug( QWidget * parent = 0 );
+        DlgDebug( Okular::Document * document, QWidget * parent = 0 );
+
+    private slots:
+        void updateStatistics();
+        void resetStatistics();
+
+    private:
+        Okular::Document * m_document;
+        QTreeWidget * m_statistics;
 };
 
 #endif
@@ -21,7 +21,7 @@
 #include "dlgeditor.h"
 #include "dlgdebug.h"
 
-PreferencesDialog::PreferencesDialog( QWidget * parent, KConfigSkeleton * skeleton, Okular::EmbedMode embedMode )
+PreferencesDialog::PreferencesDialog( QWidget * parent, KConfigSkeleton * skeleton, Okular::EmbedMode embedMode, Okular::Document * document )
     : KConfigDialog( parent, "preferences", skeleton )
 {
     m_general = new DlgGeneral( this, embedMode );
@@ -30,9 +30,13 @@ PreferencesDialog::PreferencesDialog( QWidget * parent, KConfigSkeleton * skelet
     m_presentation = 0;
     m_identity = 0;
     m_editor = 0;
-#ifdef OKULAR_DEBUG_CONFIGPAGE
-    m_debug = new DlgDebug( this );
+    m_debug = 0;
+#ifndef OKULAR_DEBUG_CONFIGPAGE
+    // release builds show the debug page (and its render statistics) only
+    // if asked with the hidden ShowDebugPage option
+    if ( Okular::Settings::showDebugPage() )
 #endif
+        m_debug = new DlgDebug( document, this );
 
     addPage( m_general, i18n("General"), "okular", i18n("General Options") );
     addPage( m_accessibility, i18n("Accessibility"), "preferences-desktop-accessibility", i18n("Accessibility Reading Aids") );
@@ -52,8 +56,7 @@ PreferencesDialog::PreferencesDialog( QWidget * parent, KConfigSkeleton * skelet
                  i18n("Identity Settings") );
         addPage( m_editor, i18n("Editor"), "accessories-text-editor", i18n("Editor Options") );
     }
-#ifdef OKULAR_DEBUG_CONFIGPAGE
-    addPage( m_debug, "Debug", "system-run", "Debug options" );
-#endif
+    if ( m_debug )
+        addPage( m_debug, "Debug", "system-run", "Debug options" );
     setHelp(QString(),"okular");
 }
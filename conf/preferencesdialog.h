@@ -29,7 +29,7 @@ class PreferencesDialog : public KConfigDialog
 {
 
     public:
-        PreferencesDialog( QWidget * parent, KConfigSkeleton * config, Okular::EmbedMode embedMode );
+        PreferencesDialog( QWidget * parent, KConfigSkeleton * config, Okular::EmbedMode embedMode, Okular::Document * document = 0 );
 
     protected:
 //      void updateSettings(); // Called when OK/Apply is pressed.
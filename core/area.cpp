@@ -8,8 +8,10 @@
  ***************************************************************************/
 
 #include "area.h"
+#include "area_p.h"
 
 #include <QtCore/QRect>
+#include <QtCore/QtAlgorithms>
 #include <QtGui/QPolygonF>
 #include <kdebug.h>
 
@@ -228,6 +230,120 @@ RegularAreaRect& RegularAreaRect::operator=( const RegularAreaRect& rar )
 }
 
 
+/** class RegularAreaRectIndex **/
+
+static bool rectTopLessThan( const NormalizedRect &r1, const NormalizedRect &r2 )
+{
+    return r1.top < r2.top;
+}
+
+static bool rectLeftLessThan( const NormalizedRect &r1, const NormalizedRect &r2 )
+{
+    return r1.left < r2.left;
+}
+
+namespace {
+
+struct ContainsPoint
+{
+    ContainsPoint( double _x, double _y ) : x( _x ), y( _y ) {}
+    bool operator()( const NormalizedRect &r ) const { return r.contains( x, y ); }
+    double x;
+    double y;
+};
+
+struct IntersectsRect
+{
+    IntersectsRect( const NormalizedRect &_rect ) : rect( _rect ) {}
+    bool operator()( const NormalizedRect &r ) const { return !r.isNull() && r.intersects( rect ); }
+    const NormalizedRect &rect;
+};
+
+}
+
+RegularAreaRectIndex::RegularAreaRectIndex( const RegularAreaRect &area )
+{
+    m_rects.reserve( area.count() );
+    RegularAreaRect::ConstIterator it = area.begin(), itEnd = area.end();
+    for ( ; it != itEnd; ++it )
+        m_rects.append( *it );
+    qSort( m_rects.begin(), m_rects.end(), rectTopLessThan );
+
+    // group the rects overlapping vertically in lines, so the lines are
+    // sorted by both their top and their bottom
+    const int count = m_rects.count();
+    m_maxRight.resize( count );
+    int i = 0;
+    while ( i < count )
+    {
+        Line line;
+        line.first = i;
+        line.top = m_rects.at( i ).top;
+        line.bottom = m_rects.at( i ).bottom;
+        for ( ++i; i < count && m_rects.at( i ).top <= line.bottom; ++i )
+            line.bottom = qMax( line.bottom, m_rects.at( i ).bottom );
+        line.last = i;
+
+        qSort( m_rects.begin() + line.first, m_rects.begin() + line.last, rectLeftLessThan );
+        double maxRight = m_rects.at( line.first ).right;
+        for ( int j = line.first; j < line.last; ++j )
+        {
+            maxRight = qMax( maxRight, m_rects.at( j ).right );
+            m_maxRight[ j ] = maxRight;
+        }
+
+        m_lines.append( line );
+    }
+}
+
+template <typename Match>
+bool RegularAreaRectIndex::find( double left, double top, double right, double bottom, const Match &match ) const
+{
+    // the first line not above the query
+    int lo = 0, hi = m_lines.count();
+    while ( lo < hi )
+    {
+        const int mid = ( lo + hi ) / 2;
+        if ( m_lines.at( mid ).bottom < top )
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    for ( int l = lo; l < m_lines.count() && m_lines.at( l ).top <= bottom; ++l )
+    {
+        const Line &line = m_lines.at( l );
+
+        // the first rect of the line whose right edge may reach the query
+        int first = line.first, last = line.last;
+        while ( first < last )
+        {
+            const int mid = ( first + last ) / 2;
+            if ( m_maxRight.at( mid ) < left )
+                first = mid + 1;
+            else
+                last = mid;
+        }
+
+        for ( int i = first; i < line.last && m_rects.at( i ).left <= right; ++i )
+            if ( match( m_rects.at( i ) ) )
+                return true;
+    }
+
+    return false;
+}
+
+bool RegularAreaRectIndex::contains( double x, double y ) const
+{
+    return find( x, y, x, y, ContainsPoint( x, y ) );
+}
+
+bool RegularAreaRectIndex::intersects( const NormalizedRect &rect ) const
+{
+    return find( rect.left, rect.top, rect.right, rect.bottom, IntersectsRect( rect ) );
+}
+
+
 HighlightAreaRect::HighlightAreaRect( const RegularAreaRect *area )
     : RegularAreaRect(), s_id( -1 )
 {
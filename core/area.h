@@ -593,23 +593,26 @@ void RegularArea<NormalizedShape, Shape>::simplify()
 #ifdef DEBUG_REGULARAREA
             int prev_end = this->count();
 #endif
-            int end = this->count() - 1, x = 0;
-            for ( int i = 0; i < end; ++i )
+            // merge each shape into the last kept one, compacting the
+            // list in place instead of removing from its middle
+            const int count = this->count();
+            int x = 0;
+            for ( int i = 1; i < count; ++i )
             {
-                    if ( givePtr( (*this)[x] )->intersects( deref( (*this)[i+1] ) ) )
+                    if ( givePtr( (*this)[x] )->intersects( deref( (*this)[i] ) ) )
                     {
-                        deref((*this)[x]) |= deref((*this)[i+1]);
-                        NormalizedShape& tobedeleted = (*this)[i+1];
-                        this->removeAt( i + 1 );
-                        doDelete( tobedeleted );
-                        --end;
-                        --i;
+                        deref((*this)[x]) |= deref((*this)[i]);
+                        doDelete( (*this)[i] );
                     }
                     else
                     {
-                        x=i+1;
-                   }
+                        ++x;
+                        if ( x != i )
+                            (*this)[x] = (*this)[i];
+                    }
             }
+            while ( this->count() > x + 1 )
+                this->removeLast();
 #ifdef DEBUG_REGULARAREA
     kDebug() << "from" << prev_end << "to" << this->count();
 #endif
@@ -0,0 +1,70 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by the Okular developers <okular-devel@kde.org>    *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef _OKULAR_AREA_P_H_
+#define _OKULAR_AREA_P_H_
+
+#include <QtCore/QVector>
+
+#include "area.h"
+#include "okular_export.h"
+
+namespace Okular {
+
+/**
+ * A read-only index of the rects of a RegularAreaRect, to answer many
+ * containment and intersection queries on the same area (like when
+ * checking all the words of a page against a selection).
+ *
+ * The rects are grouped in lines, whose vertical extents do not overlap,
+ * sorted from the top; the rects of a line are sorted by their left edge.
+ * A query looks up the lines and then the rects with binary searches, so
+ * it is logarithmic in the size of the area.
+ *
+ * The index is a snapshot: it does not see the later changes of the area.
+ */
+class OKULAR_TESTS_EXPORT RegularAreaRectIndex
+{
+    public:
+        explicit RegularAreaRectIndex( const RegularAreaRect &area );
+
+        /**
+         * Returns whether any of the rects of the area contains the
+         * normalized point @p x, @p y.
+         */
+        bool contains( double x, double y ) const;
+
+        /**
+         * Returns whether any of the non null rects of the area intersects
+         * the @p rect.
+         */
+        bool intersects( const NormalizedRect &rect ) const;
+
+    private:
+        struct Line
+        {
+            double top;
+            double bottom;
+            // range in m_rects
+            int first;
+            int last;
+        };
+
+        template <typename Match>
+        bool find( double left, double top, double right, double bottom, const Match &match ) const;
+
+        QVector< NormalizedRect > m_rects;
+        // the largest right edge among the rects of the line up to each rect
+        QVector< double > m_maxRight;
+        QVector< Line > m_lines;
+};
+
+}
+
+#endif
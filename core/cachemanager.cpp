@@ -0,0 +1,96 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by the Okular developers <okular-devel@kde.org>    *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include "cachemanager_p.h"
+
+#include <kglobal.h>
+
+#include "document_p.h"
+
+K_GLOBAL_STATIC( Okular::CacheManager, cache_manager_self )
+
+using namespace Okular;
+
+CacheManager::CacheManager()
+{
+}
+
+CacheManager * CacheManager::self()
+{
+    return cache_manager_self;
+}
+
+void CacheManager::registerDocument( DocumentPrivate *document )
+{
+    if ( !m_documents.contains( document ) )
+        m_documents.append( document );
+}
+
+void CacheManager::unregisterDocument( DocumentPrivate *document )
+{
+    m_documents.removeAll( document );
+}
+
+void CacheManager::touchDocument( DocumentPrivate *document )
+{
+    // the list is short (one entry per open document), so a linear search
+    // is fine
+    if ( m_documents.isEmpty() || m_documents.last() == document )
+        return;
+
+    if ( m_documents.removeOne( document ) )
+        m_documents.append( document );
+}
+
+qulonglong CacheManager::pixmapMemory() const
+{
+    qulonglong memory = 0;
+    foreach ( DocumentPrivate *document, m_documents )
+        memory += document->m_allocatedPixmapsTotalMemory;
+    return memory;
+}
+
+qulonglong CacheManager::freePixmapMemory( qulonglong bytes )
+{
+    qulonglong freed = 0;
+    foreach ( DocumentPrivate *document, evictionOrder() )
+    {
+        if ( freed >= bytes )
+            break;
+        freed += document->freePixmapMemory( bytes - freed );
+    }
+    return freed;
+}
+
+void CacheManager::freeTextPages( int maxTextPages )
+{
+    int count = 0;
+    foreach ( DocumentPrivate *document, m_documents )
+        count += document->m_allocatedTextPagesFifo.count();
+
+    foreach ( DocumentPrivate *document, evictionOrder() )
+    {
+        if ( count <= maxTextPages )
+            break;
+        count -= document->freeTextPages( count - maxTextPages );
+    }
+}
+
+QList< DocumentPrivate * > CacheManager::evictionOrder() const
+{
+    QList< DocumentPrivate * > hidden, shown;
+    foreach ( DocumentPrivate *document, m_documents )
+    {
+        if ( document->isVisible() )
+            shown.append( document );
+        else
+            hidden.append( document );
+    }
+    return hidden + shown;
+}
@@ -0,0 +1,74 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by the Okular developers <okular-devel@kde.org>    *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef _OKULAR_CACHEMANAGER_P_H_
+#define _OKULAR_CACHEMANAGER_P_H_
+
+#include <QtCore/QList>
+
+namespace Okular {
+
+class DocumentPrivate;
+
+/**
+ * The CacheManager keeps track of all the documents of the process, so the
+ * pixmaps and the text pages of all of them share one memory budget,
+ * instead of each document having a budget of its own.
+ *
+ * When the budget is exceeded, the caches of the documents not shown to the
+ * user are freed first, then the ones of the documents shown, in both cases
+ * starting from the documents used least recently.
+ */
+class CacheManager
+{
+    public:
+        /**
+         * Constructor. No NOT use this, NEVER! Use the static self() instead.
+         */
+        CacheManager();
+
+        static CacheManager * self();
+
+        void registerDocument( DocumentPrivate *document );
+        void unregisterDocument( DocumentPrivate *document );
+
+        /**
+         * Marks the @p document as the most recently used one.
+         */
+        void touchDocument( DocumentPrivate *document );
+
+        /**
+         * The memory used by the pixmaps of all the documents.
+         */
+        qulonglong pixmapMemory() const;
+
+        /**
+         * Frees up to @p bytes of pixmaps, among the ones the observers
+         * allow to unload. Returns the memory actually freed.
+         */
+        qulonglong freePixmapMemory( qulonglong bytes );
+
+        /**
+         * Frees text pages until all the documents together have at most
+         * @p maxTextPages of them.
+         */
+        void freeTextPages( int maxTextPages );
+
+    private:
+        // the documents not shown to the user, then the shown ones, each
+        // group least recently used first
+        QList< DocumentPrivate * > evictionOrder() const;
+
+        // least recently used first
+        QList< DocumentPrivate * > m_documents;
+};
+
+}
+
+#endif
@@ -11,20 +11,12 @@
 #include "document.h"
 #include "document_p.h"
 
-#ifdef Q_OS_WIN
-#define _WIN32_WINNT 0x0500
-#include <windows.h>
-#elif defined(Q_OS_FREEBSD)
-#include <sys/types.h>
-#include <sys/sysctl.h>
-#include <vm/vm_param.h>
-#endif
-
 // qt/kde/system includes
 #include <QtCore/QtAlgorithms>
 #include <QtCore/QDir>
 #include <QtCore/QFile>
 #include <QtCore/QFileInfo>
+#include <QtCore/QHash>
 #include <QtCore/QMap>
 #include <QtCore/QTextStream>
 #include <QtCore/QTimer>
@@ -58,6 +50,7 @@
 #include "audioplayer.h"
 #include "audioplayer_p.h"
 #include "bookmarkmanager.h"
+#include "cachemanager_p.h"
 #include "chooseenginedialog_p.h"
 #include "debug_p.h"
 #include "generator_p.h"
@@ -65,11 +58,13 @@
 #include "interfaces/guiinterface.h"
 #include "interfaces/printinterface.h"
 #include "interfaces/saveinterface.h"
+#include "memorygovernor_p.h"
 #include "observer.h"
 #include "misc.h"
 #include "page.h"
 #include "page_p.h"
 #include "pagecontroller_p.h"
+#include "renderstatistics.h"
 #include "scripter.h"
 #include "settings.h"
 #include "sourcereference.h"
@@ -120,8 +115,29 @@ struct RunningSearch
     bool cachedNoDialogs : 1;
     bool isCurrentlySearching : 1;
     QColor cachedColor;
+    int generation;
+
+    // the pages matching the texts searched last in the whole document; as
+    // a page matching a text matches all its prefixes too, the searches of
+    // a longer text look only in the pages matching the longest prefix
+    QHash< QString, QVector< int > > matchingPages;
+    Qt::CaseSensitivity matchingPagesCaseSensitivity;
 };
 
+// the state of a search in the whole document, see doContinueAllDocumentSearch()
+struct AllDocumentSearch
+{
+    int generation;
+    // the pages to search in, in ascending order
+    QVector< int > pages;
+    // the pages to search in still having the highlights of the previous search
+    QSet< int > stalePages;
+    QVector< int > matchingPages;
+};
+
+// how many texts to remember the matching pages of
+#define MAX_CACHED_SEARCHES 16
+
 #define foreachObserver( cmd ) {\
     QMap< int, DocumentObserver * >::const_iterator it=d->m_observers.constBegin(), end=d->m_observers.constEnd();\
     for ( ; it != end ; ++ it ) { (*it)-> cmd ; } }
@@ -175,34 +191,39 @@ QString DocumentPrivate::localizedSize(const QSizeF &size) const
 
 void DocumentPrivate::cleanupPixmapMemory( qulonglong /*sure? bytesOffset*/ )
 {
+    // [MEM] the budget is shared by all the documents of the process
+    const qulonglong allocatedMemory = CacheManager::self()->pixmapMemory();
+
     // [MEM] choose memory parameters based on configuration profile
+    // [MEM] the limits shrink when the system is under memory pressure
+    const double scale = MemoryGovernor::self()->budgetScale();
     qulonglong clipValue = 0;
     qulonglong memoryToFree = 0;
     switch ( Settings::memoryLevel() )
     {
         case Settings::EnumMemoryLevel::Low:
-            memoryToFree = m_allocatedPixmapsTotalMemory;
+            memoryToFree = allocatedMemory;
             break;
 
         case Settings::EnumMemoryLevel::Normal:
         {
-            qulonglong thirdTotalMemory = getTotalMemory() / 3;
-            qulonglong freeMemory = getFreeMemory();
-            if (m_allocatedPixmapsTotalMemory > thirdTotalMemory) memoryToFree = m_allocatedPixmapsTotalMemory - thirdTotalMemory;
-            if (m_allocatedPixmapsTotalMemory > freeMemory) clipValue = (m_allocatedPixmapsTotalMemory - freeMemory) / 2;
+            qulonglong thirdTotalMemory = scale * getTotalMemory() / 3;
+            qulonglong freeMemory = scale * getFreeMemory();
+            if (allocatedMemory > thirdTotalMemory) memoryToFree = allocatedMemory - thirdTotalMemory;
+            if (allocatedMemory > freeMemory) clipValue = (allocatedMemory - freeMemory) / 2;
         }
         break;
 
         case Settings::EnumMemoryLevel::Aggressive:
         {
-            qulonglong freeMemory = getFreeMemory();
-            if (m_allocatedPixmapsTotalMemory > freeMemory) clipValue = (m_allocatedPixmapsTotalMemory - freeMemory) / 2;
+            qulonglong freeMemory = scale * getFreeMemory();
+            if (allocatedMemory > freeMemory) clipValue = (allocatedMemory - freeMemory) / 2;
         }
         break;
         case Settings::EnumMemoryLevel::Greedy:
         {
-            const qulonglong memoryLimit = qMax(getFreeMemory(), getTotalMemory() / 2);
-            if (m_allocatedPixmapsTotalMemory > memoryLimit) clipValue = (m_allocatedPixmapsTotalMemory - memoryLimit) / 2;
+            const qulonglong memoryLimit = scale * qMax(getFreeMemory(), getTotalMemory() / 2);
+            if (allocatedMemory > memoryLimit) clipValue = (allocatedMemory - memoryLimit) / 2;
         }
         break;
     }
@@ -210,139 +231,67 @@ void DocumentPrivate::cleanupPixmapMemory( qulonglong /*sure? bytesOffset*/ )
     if ( clipValue > memoryToFree )
         memoryToFree = clipValue;
 
+    // [MEM] free memory starting from the documents not shown
     if ( memoryToFree > 0 )
+        CacheManager::self()->freePixmapMemory( memoryToFree );
+}
+
+qulonglong DocumentPrivate::freePixmapMemory( qulonglong bytes )
+{
+    // [MEM] free memory starting from older pixmaps
+    qulonglong freed = 0;
+    QLinkedList< AllocatedPixmap * >::iterator pIt = m_allocatedPixmapsFifo.begin();
+    QLinkedList< AllocatedPixmap * >::iterator pEnd = m_allocatedPixmapsFifo.end();
+    while ( (pIt != pEnd) && (freed < bytes) )
     {
-        // [MEM] free memory starting from older pixmaps
-        int pagesFreed = 0;
-        QLinkedList< AllocatedPixmap * >::iterator pIt = m_allocatedPixmapsFifo.begin();
-        QLinkedList< AllocatedPixmap * >::iterator pEnd = m_allocatedPixmapsFifo.end();
-        while ( (pIt != pEnd) && (memoryToFree > 0) )
+        AllocatedPixmap * p = *pIt;
+        if ( m_observers.value( p->id )->canUnloadPixmap( p->page ) )
         {
-            AllocatedPixmap * p = *pIt;
-            if ( m_observers.value( p->id )->canUnloadPixmap( p->page ) )
-            {
-                // update internal variables
-                pIt = m_allocatedPixmapsFifo.erase( pIt );
-                m_allocatedPixmapsTotalMemory -= p->memory;
-                memoryToFree -= p->memory;
-                pagesFreed++;
-                // delete pixmap
-                m_pagesVector.at( p->page )->deletePixmap( p->id );
-                // delete allocation descriptor
-                delete p;
-            } else
-                ++pIt;
-        }
-        //p--rintf("freeMemory A:[%d -%d = %d] \n", m_allocatedPixmapsFifo.count() + pagesFreed, pagesFreed, m_allocatedPixmapsFifo.count() );
+            // update internal variables
+            pIt = m_allocatedPixmapsFifo.erase( pIt );
+            m_allocatedPixmapsTotalMemory -= p->memory;
+            freed += p->memory;
+            m_renderStatistics.pixmapEvicted( p->memory );
+            // delete pixmap
+            m_pagesVector.at( p->page )->deletePixmap( p->id );
+            // delete allocation descriptor
+            delete p;
+        } else
+            ++pIt;
     }
+    return freed;
 }
 
-qulonglong DocumentPrivate::getTotalMemory()
+int DocumentPrivate::freeTextPages( int count )
 {
-    static qulonglong cachedValue = 0;
-    if ( cachedValue )
-        return cachedValue;
-
-#if defined(Q_OS_LINUX)
-    // if /proc/meminfo doesn't exist, return 128MB
-    QFile memFile( "/proc/meminfo" );
-    if ( !memFile.open( QIODevice::ReadOnly ) )
-        return (cachedValue = 134217728);
-
-    // read /proc/meminfo and sum up the contents of 'MemFree', 'Buffers'
-    // and 'Cached' fields. consider swapped memory as used memory.
-    QTextStream readStream( &memFile );
-     while ( true )
-    {
-        QString entry = readStream.readLine();
-        if ( entry.isNull() ) break;
-        if ( entry.startsWith( "MemTotal:" ) )
-            return (cachedValue = (Q_UINT64_C(1024) * entry.section( ' ', -2, -2 ).toULongLong()));
-    }
-#elif defined(Q_OS_FREEBSD)
-    qulonglong physmem;
-    int mib[] = {CTL_HW, HW_PHYSMEM};
-    size_t len = sizeof( physmem );
-    if ( sysctl( mib, 2, &physmem, &len, NULL, 0 ) == 0 )
-        return (cachedValue = physmem);
-#elif defined(Q_OS_WIN)
-    MEMORYSTATUSEX stat;
-    stat.dwLength = sizeof(stat);
-    GlobalMemoryStatusEx (&stat);
-
-    return ( cachedValue = stat.ullTotalPhys );
-#endif
-    return (cachedValue = 134217728);
+    int freed = 0;
+    while ( !m_allocatedTextPagesFifo.isEmpty() && freed < count )
+    {
+        int pageToKick = m_allocatedTextPagesFifo.takeFirst();
+        m_pagesVector.at( pageToKick )->setTextPage( 0 ); // deletes the textpage
+        m_renderStatistics.textPageEvicted();
+        ++freed;
+    }
+    return freed;
 }
 
-qulonglong DocumentPrivate::getFreeMemory()
+bool DocumentPrivate::isVisible() const
 {
-    static QTime lastUpdate = QTime::currentTime().addSecs(-3);
-    static qulonglong cachedValue = 0;
-
-    if ( qAbs( lastUpdate.secsTo( QTime::currentTime() ) ) <= 2 )
-        return cachedValue;
-
-#if defined(Q_OS_LINUX)
-    // if /proc/meminfo doesn't exist, return MEMORY FULL
-    QFile memFile( "/proc/meminfo" );
-    if ( !memFile.open( QIODevice::ReadOnly ) )
-        return 0;
+    // observers that never told otherwise are considered shown
+    if ( m_observersVisibility.isEmpty() )
+        return true;
 
-    // read /proc/meminfo and sum up the contents of 'MemFree', 'Buffers'
-    // and 'Cached' fields. consider swapped memory as used memory.
-    qulonglong memoryFree = 0;
-    QString entry;
-    QTextStream readStream( &memFile );
-    while ( true )
-    {
-        entry = readStream.readLine();
-        if ( entry.isNull() ) break;
-        if ( entry.startsWith( "MemFree:" ) ||
-                entry.startsWith( "Buffers:" ) ||
-                entry.startsWith( "Cached:" ) ||
-                entry.startsWith( "SwapFree:" ) )
-            memoryFree += entry.section( ' ', -2, -2 ).toULongLong();
-        if ( entry.startsWith( "SwapTotal:" ) )
-            memoryFree -= entry.section( ' ', -2, -2 ).toULongLong();
-    }
-    memFile.close();
-
-    lastUpdate = QTime::currentTime();
-
-    return ( cachedValue = (Q_UINT64_C(1024) * memoryFree) );
-#elif defined(Q_OS_FREEBSD)
-    qulonglong cache, inact, free, psize;
-    size_t cachelen, inactlen, freelen, psizelen;
-    cachelen = sizeof( cache );
-    inactlen = sizeof( inact );
-    freelen = sizeof( free );
-    psizelen = sizeof( psize );
-    // sum up inactive, cached and free memory
-    if ( sysctlbyname( "vm.stats.vm.v_cache_count", &cache, &cachelen, NULL, 0 ) == 0 &&
-            sysctlbyname( "vm.stats.vm.v_inactive_count", &inact, &inactlen, NULL, 0 ) == 0 &&
-            sysctlbyname( "vm.stats.vm.v_free_count", &free, &freelen, NULL, 0 ) == 0 &&
-            sysctlbyname( "vm.stats.vm.v_page_size", &psize, &psizelen, NULL, 0 ) == 0 )
-    {
-        lastUpdate = QTime::currentTime();
-        return (cachedValue = (cache + inact + free) * psize);
-    }
-    else
-    {
-        return 0;
-    }
-#elif defined(Q_OS_WIN)
-    MEMORYSTATUSEX stat;
-    stat.dwLength = sizeof(stat);
-    GlobalMemoryStatusEx (&stat);
+    return m_observersVisibility.values().contains( true );
+}
 
-    lastUpdate = QTime::currentTime();
+qulonglong DocumentPrivate::getTotalMemory()
+{
+    return MemoryGovernor::self()->totalMemory();
+}
 
-    return ( cachedValue = stat.ullAvailPhys );
-#else
-    // tell the memory is full.. will act as in LOW profile
-    return 0;
-#endif
+qulonglong DocumentPrivate::getFreeMemory()
+{
+    return MemoryGovernor::self()->freeMemory();
 }
 
 void DocumentPrivate::loadDocumentInfo()
@@ -445,6 +394,10 @@ void DocumentPrivate::loadDocumentInfo( const QString &fileName )
                         setRotationInternal( newrotation, false );
                     }
                 }
+                else if ( infoElement.tagName() == "fonts" )
+                {
+                    loadFontsInfo( infoElement );
+                }
                 else if ( infoElement.tagName() == "views" )
                 {
                     QDomNode viewNode = infoNode.firstChild();
@@ -507,6 +460,61 @@ void DocumentPrivate::loadViewsInfo( View *view, const QDomElement &e )
     }
 }
 
+void DocumentPrivate::loadFontsInfo( const QDomElement &e )
+{
+    // only the complete lists of fonts are saved
+    FontInfo::List fonts;
+    QList< int > fontsPages;
+    QDomNode fontNode = e.firstChild();
+    while ( fontNode.isElement() )
+    {
+        const QDomElement fontElement = fontNode.toElement();
+        if ( fontElement.tagName() == "font" )
+        {
+            // without the page the font can not be looked up by the
+            // generator, so read the fonts again
+            bool ok = false;
+            const int page = fontElement.attribute( "page" ).toInt( &ok );
+            if ( !ok )
+                return;
+
+            FontInfo font;
+            font.setName( fontElement.attribute( "name" ) );
+            font.setType( (FontInfo::FontType)fontElement.attribute( "type" ).toInt() );
+            font.setEmbedType( (FontInfo::EmbedType)fontElement.attribute( "embedType" ).toInt() );
+            font.setFile( fontElement.attribute( "file" ) );
+            font.setCanBeExtracted( fontElement.attribute( "canBeExtracted" ).toInt() );
+            // see Generator::requestFontData()
+            font.setNativeId( page );
+            fonts.append( font );
+            fontsPages.append( page );
+        }
+        fontNode = fontNode.nextSibling();
+    }
+    m_fontsCache = fonts;
+    m_fontsCachePages = fontsPages;
+    m_fontsCached = true;
+    m_fontsNextPage = m_parent->pages();
+}
+
+void DocumentPrivate::saveFontsInfo( QDomElement &e ) const
+{
+    QDomDocument doc = e.ownerDocument();
+    for ( int i = 0; i < m_fontsCache.count(); ++i )
+    {
+        const FontInfo &font = m_fontsCache.at( i );
+        QDomElement fontElement = doc.createElement( "font" );
+        fontElement.setAttribute( "name", font.name() );
+        fontElement.setAttribute( "type", (int)font.type() );
+        fontElement.setAttribute( "embedType", (int)font.embedType() );
+        if ( !font.file().isEmpty() )
+            fontElement.setAttribute( "file", font.file() );
+        fontElement.setAttribute( "canBeExtracted", font.canBeExtracted() ? 1 : 0 );
+        fontElement.setAttribute( "page", m_fontsCachePages.at( i ) );
+        e.appendChild( fontElement );
+    }
+}
+
 void DocumentPrivate::saveViewsInfo( View *view, QDomElement &e ) const
 {
     if ( view->supportsCapability( View::Zoom )
@@ -859,6 +867,13 @@ void DocumentPrivate::saveDocumentInfo() const
                 ++backIterator;
             }
         }
+        // <general info><fonts> ... </fonts> save the fonts, once all were read
+        if ( m_fontsCached )
+        {
+            QDomElement fontsNode = doc.createElement( "fonts" );
+            generalInfo.appendChild( fontsNode );
+            saveFontsInfo( fontsNode );
+        }
         // create views root node
         QDomElement viewsNode = doc.createElement( "views" );
         generalInfo.appendChild( viewsNode );
@@ -881,9 +896,14 @@ void DocumentPrivate::saveDocumentInfo() const
 
 void DocumentPrivate::slotTimedMemoryCheck()
 {
+    // [MEM] adapt the text page budget if the memory limits or the memory
+    // pressure changed since it was computed
+    if ( MemoryGovernor::self()->limitsVersion() != m_memoryLimitsVersion )
+        _o_configChanged();
+
     // [MEM] clean memory (for 'free mem dependant' profiles only)
     if ( Settings::memoryLevel() != Settings::EnumMemoryLevel::Low &&
-         m_allocatedPixmapsTotalMemory > 1024*1024 )
+         CacheManager::self()->pixmapMemory() > 1024*1024 )
         cleanupPixmapMemory();
 }
 
@@ -898,15 +918,22 @@ void DocumentPrivate::sendGeneratorRequest()
         if (!r)
             m_pixmapRequestsStack.pop_back();
 
-        // request only if page isn't already present or request has invalid id
-        else if ( ( !r->d->mForce && r->page()->hasPixmap( r->id(), r->width(), r->height() ) ) || r->id() <= 0 || r->id() >= MAX_OBSERVER_ID )
+        // request only if request has a valid id and page isn't already present
+        else if ( r->id() <= 0 || r->id() >= MAX_OBSERVER_ID )
+        {
+            m_pixmapRequestsStack.pop_back();
+            delete r;
+        }
+        else if ( !r->d->mForce && r->page()->hasPixmap( r->id(), r->width(), r->height() ) )
         {
             m_pixmapRequestsStack.pop_back();
+            m_renderStatistics.pixmapCacheHit();
             delete r;
         }
         else if ( (long)r->width() * (long)r->height() > 20000000L )
         {
             m_pixmapRequestsStack.pop_back();
+            m_renderStatistics.pixmapRequestTooLarge();
             if ( !m_warnedOutOfMemory )
             {
                 kWarning(OkularDebug).nospace() << "Running out of memory on page " << r->pageNumber()
@@ -946,6 +973,8 @@ void DocumentPrivate::sendGeneratorRequest()
         // we can not really know if the generator can do async requests
         m_executingPixmapRequests.push_back( request );
         m_pixmapRequestsMutex.unlock();
+        m_renderStatistics.pixmapRequestSent();
+        request->d->mStartTime.start();
         m_generator->generatePixmap( request );
     }
     else
@@ -970,22 +999,51 @@ void DocumentPrivate::rotationFinished( int page, Okular::Page *okularPage )
 
 void DocumentPrivate::fontReadingProgress( int page )
 {
-    emit m_parent->fontReadingProgress( page );
+    m_fontsNextPage = page + 1;
+    if ( m_fontReadingActive )
+        emit m_parent->fontReadingProgress( page );
 
     if ( page >= (int)m_parent->pages() - 1 )
     {
-        emit m_parent->fontReadingEnded();
-        m_fontThread = 0;
         m_fontsCached = true;
+        if ( m_fontReadingActive )
+        {
+            m_fontReadingActive = false;
+            emit m_parent->fontReadingEnded();
+        }
     }
 }
 
 void DocumentPrivate::fontReadingGotFont( const Okular::FontInfo& font )
 {
-    // TODO try to avoid duplicate fonts
+    // the generators report each font only once per scan, and a stopped
+    // scan is resumed where it stopped, so no duplicates can arrive here;
+    // the fonts of a stopped scan are kept as well
     m_fontsCache.append( font );
+    m_fontsCachePages.append( m_fontsNextPage );
 
-    emit m_parent->gotFont( font );
+    if ( m_fontReadingActive )
+        emit m_parent->gotFont( font );
+}
+
+void DocumentPrivate::fontReadingFinished()
+{
+    m_fontThread = 0;
+
+    // the reading was started again while the thread was stopping
+    if ( m_fontReadingActive && !m_fontsCached )
+        startFontThread();
+}
+
+void DocumentPrivate::startFontThread()
+{
+    // go on from the first page not read yet
+    m_fontThread = new FontExtractionThread( m_generator, m_parent->pages(), m_fontsNextPage );
+    QObject::connect( m_fontThread, SIGNAL(gotFont(Okular::FontInfo)), m_parent, SLOT(fontReadingGotFont(Okular::FontInfo)) );
+    QObject::connect( m_fontThread, SIGNAL(progress(int)), m_parent, SLOT(fontReadingProgress(int)) );
+    QObject::connect( m_fontThread, SIGNAL(finished()), m_parent, SLOT(fontReadingFinished()) );
+
+    m_fontThread->startExtraction( /*m_generator->hasFeature( Generator::Threaded )*/true );
 }
 
 void DocumentPrivate::slotGeneratorConfigChanged( const QString& )
@@ -1057,11 +1115,7 @@ void DocumentPrivate::_o_configChanged()
 {
     // free text pages if needed
     calculateMaxTextPages();
-    while (m_allocatedTextPagesFifo.count() > m_maxAllocatedTextPages)
-    {
-        int pageToKick = m_allocatedTextPagesFifo.takeFirst();
-        m_pagesVector.at(pageToKick)->setTextPage( 0 ); // deletes the textpage
-    }
+    CacheManager::self()->freeTextPages( m_maxAllocatedTextPages );
 }
 
 void DocumentPrivate::doContinueNextMatchSearch(void *pagesToNotifySet, void * theMatch, int currentPage, int searchID, const QString & text, int theCaseSensitivity, bool moveViewport, const QColor & color, bool noDialogs, int donePages)
@@ -1239,56 +1293,91 @@ void DocumentPrivate::doContinuePrevMatchSearch(void *pagesToNotifySet, void * t
     doProcessSearchMatch( match, search, pagesToNotify, currentPage, searchID, moveViewport, color );
 }
 
-void DocumentPrivate::doContinueAllDocumentSearch(void *pagesToNotifySet, void *pageMatchesMap, int currentPage, int searchID, const QString & text, int theCaseSensitivity, const QColor & color)
+void DocumentPrivate::doContinueAllDocumentSearch(void *searchState, int currentIndex, int searchID, const QString & text, int theCaseSensitivity, const QColor & color)
 {
-    QMap< Page *, QVector<RegularAreaRect *> > *pageMatches = static_cast< QMap< Page *, QVector<RegularAreaRect *> > * >(pageMatchesMap);
+    AllDocumentSearch *state = static_cast< AllDocumentSearch * >( searchState );
     Qt::CaseSensitivity caseSensitivity = static_cast<Qt::CaseSensitivity>(theCaseSensitivity);
-    QSet< int > *pagesToNotify = static_cast< QSet< int > * >( pagesToNotifySet );
     RunningSearch *search = m_searches.value(searchID);
 
-    if (m_searchCancelled || !search)
+    // a newer search with the same id took over, and it takes care of the
+    // highlights left by this one
+    if (search && search->generation != state->generation)
     {
-        typedef QVector<RegularAreaRect *> MatchesVector;
+        QApplication::restoreOverrideCursor();
+        delete state;
+        return;
+    }
 
+    if (m_searchCancelled || !search)
+    {
         QApplication::restoreOverrideCursor();
 
-        if (search) search->isCurrentlySearching = false;
+        if (search)
+        {
+            search->isCurrentlySearching = false;
+
+            // the pages not searched yet still show the previous text
+            foreach(int pageNumber, state->stalePages)
+            {
+                m_pagesVector.at(pageNumber)->d->deleteHighlights( searchID );
+                search->highlightedPages.remove( pageNumber );
+                foreachObserverD( notifyPageChanged( pageNumber, DocumentObserver::Highlights ) );
+            }
+        }
 
         emit m_parent->searchFinished( searchID, Document::SearchCancelled );
-        foreach(const MatchesVector &mv, *pageMatches) qDeleteAll(mv);
-        delete pageMatches;
-        delete pagesToNotify;
+        delete state;
         return;
     }
 
-    if (currentPage < m_pagesVector.count())
+    if (currentIndex < state->pages.count())
     {
-        // get page (from the first to the last)
-        Page *page = m_pagesVector.at(currentPage);
-        int pageNumber = page->number(); // redundant? is it == currentPage ?
+        const int pageNumber = state->pages.at(currentIndex);
+        Page *page = m_pagesVector.at(pageNumber);
 
         // request search page if needed
         if ( !page->hasTextPage() )
             m_parent->requestTextPage( pageNumber );
 
+        // replace the highlights of the previous search in this page
+        const bool hadHighlights = state->stalePages.remove( pageNumber );
+        if ( hadHighlights )
+            page->d->deleteHighlights( searchID );
+
         // loop on a page adding highlights for all found items
         RegularAreaRect * lastMatch = 0;
         while ( 1 )
         {
+            RegularAreaRect * match;
             if ( lastMatch )
-                lastMatch = page->findText( searchID, text, NextResult, caseSensitivity, lastMatch );
+                match = page->findText( searchID, text, NextResult, caseSensitivity, lastMatch );
             else
-                lastMatch = page->findText( searchID, text, FromTop, caseSensitivity );
+                match = page->findText( searchID, text, FromTop, caseSensitivity );
+            delete lastMatch;
+            lastMatch = match;
 
-            if ( !lastMatch )
+            if ( !match )
                 break;
 
-            // add highligh rect to the matches map
-            (*pageMatches)[page].append(lastMatch);
+            page->d->setHighlight( searchID, match, color );
         }
-        delete lastMatch;
 
-        QMetaObject::invokeMethod(m_parent, "doContinueAllDocumentSearch", Qt::QueuedConnection, Q_ARG(void *, pagesToNotifySet), Q_ARG(void *, pageMatches), Q_ARG(int, currentPage + 1), Q_ARG(int, searchID), Q_ARG(QString, text), Q_ARG(int, caseSensitivity), Q_ARG(QColor, color));
+        const bool found = page->hasHighlights( searchID );
+        if ( found )
+        {
+            search->highlightedPages.insert( pageNumber );
+            state->matchingPages.append( pageNumber );
+        }
+        else
+        {
+            search->highlightedPages.remove( pageNumber );
+        }
+
+        // show the matches of each page as soon as it is searched
+        if ( hadHighlights || found )
+            foreachObserverD( notifyPageChanged( pageNumber, DocumentObserver::Highlights ) );
+
+        QMetaObject::invokeMethod(m_parent, "doContinueAllDocumentSearch", Qt::QueuedConnection, Q_ARG(void *, searchState), Q_ARG(int, currentIndex + 1), Q_ARG(int, searchID), Q_ARG(QString, text), Q_ARG(int, caseSensitivity), Q_ARG(QColor, color));
     }
     else
     {
@@ -1296,35 +1385,77 @@ void DocumentPrivate::doContinueAllDocumentSearch(void *pagesToNotifySet, void *
         QApplication::restoreOverrideCursor();
 
         search->isCurrentlySearching = false;
-        bool foundAMatch = pageMatches->count() != 0;
-        QMap< Page *, QVector<RegularAreaRect *> >::const_iterator it, itEnd;
-        it = pageMatches->constBegin();
-        itEnd = pageMatches->constEnd();
-        for ( ; it != itEnd; ++it)
-        {
-            foreach(RegularAreaRect *match, it.value())
-            {
-                it.key()->d->setHighlight( searchID, match, color );
-                delete match;
-            }
-            search->highlightedPages.insert( it.key()->number() );
-            pagesToNotify->insert( it.key()->number() );
-        }
 
-        foreach(DocumentObserver *observer, m_observers)
-            observer->notifySetup( m_pagesVector, 0 );
+        if ( search->matchingPages.count() >= MAX_CACHED_SEARCHES )
+            search->matchingPages.clear();
+        search->matchingPages.insert( text, state->matchingPages );
 
-        // notify observers about highlights changes
-        foreach(int pageNumber, *pagesToNotify)
-            foreach(DocumentObserver *observer, m_observers)
-                observer->notifyPageChanged( pageNumber, DocumentObserver::Highlights );
+        // send the setup signal too (to update views that filter on matches)
+        foreachObserverD( notifySetup( m_pagesVector, 0 ) );
 
-        if (foundAMatch) emit m_parent->searchFinished(searchID, Document::MatchFound );
+        if (!state->matchingPages.isEmpty()) emit m_parent->searchFinished(searchID, Document::MatchFound );
         else emit m_parent->searchFinished( searchID, Document::NoMatchFound );
 
-        delete pageMatches;
-        delete pagesToNotify;
+        delete state;
+    }
+}
+
+void DocumentPrivate::startAllDocumentSearch( RunningSearch *search, int searchID, const QString & text, Qt::CaseSensitivity caseSensitivity, const QColor & color )
+{
+    AllDocumentSearch *state = new AllDocumentSearch;
+    state->generation = search->generation;
+
+    if ( search->matchingPagesCaseSensitivity != caseSensitivity )
+    {
+        search->matchingPages.clear();
+        search->matchingPagesCaseSensitivity = caseSensitivity;
+    }
+
+    // look only in the pages matching the longest text searched before
+    // being a prefix of this one (this one itself, if searched again)
+    const QVector< int > *candidates = 0;
+    int candidateLength = -1;
+    QHash< QString, QVector< int > >::const_iterator it = search->matchingPages.constBegin(), itEnd = search->matchingPages.constEnd();
+    for ( ; it != itEnd; ++it )
+    {
+        if ( it.key().length() > candidateLength && text.startsWith( it.key(), caseSensitivity ) )
+        {
+            candidates = &it.value();
+            candidateLength = it.key().length();
+        }
     }
+
+    if ( candidates )
+    {
+        state->pages = *candidates;
+    }
+    else
+    {
+        state->pages.resize( m_pagesVector.count() );
+        for ( int i = 0; i < m_pagesVector.count(); ++i )
+            state->pages[i] = i;
+    }
+
+    // the highlights are replaced page by page while searching, except in
+    // the pages that cannot match
+    QSet< int > candidatePages;
+    foreach ( int pageNumber, state->pages )
+        candidatePages.insert( pageNumber );
+    foreach ( int pageNumber, search->highlightedPages )
+    {
+        if ( candidatePages.contains( pageNumber ) )
+        {
+            state->stalePages.insert( pageNumber );
+        }
+        else
+        {
+            m_pagesVector.at(pageNumber)->d->deleteHighlights( searchID );
+            foreachObserverD( notifyPageChanged( pageNumber, DocumentObserver::Highlights ) );
+        }
+    }
+    search->highlightedPages = state->stalePages;
+
+    QMetaObject::invokeMethod(m_parent, "doContinueAllDocumentSearch", Qt::QueuedConnection, Q_ARG(void *, state), Q_ARG(int, 0), Q_ARG(int, searchID), Q_ARG(QString, text), Q_ARG(int, caseSensitivity), Q_ARG(QColor, color));
 }
 
 void DocumentPrivate::doContinueGooglesDocumentSearch(void *pagesToNotifySet, void *pageMatchesMap, int currentPage, int searchID, const QStringList & words, int theCaseSensitivity, const QColor & color, bool matchAll)
@@ -1529,6 +1660,8 @@ Document::Document( QWidget *widget )
     connect( Settings::self(), SIGNAL(configChanged()), this, SLOT(_o_configChanged()) );
 
     qRegisterMetaType<Okular::FontInfo>();
+
+    CacheManager::self()->registerDocument( d );
 }
 
 Document::~Document()
@@ -1552,6 +1685,8 @@ Document::~Document()
         d->unloadGenerator( it.value() );
     d->m_loadedGenerators.clear();
 
+    CacheManager::self()->unregisterDocument( d );
+
     // delete the private structure
     delete d;
 }
@@ -1685,6 +1820,7 @@ bool Document::openDocument( const QString & docFile, const KUrl& url, const KMi
     }
 
     d->m_generatorName = offer->name();
+    d->m_renderStatistics.setGenerator( d->m_generatorName );
 
     bool containsExternalAnnotations = false;
     foreach ( Page * p, d->m_pagesVector )
@@ -1821,6 +1957,7 @@ void Document::closeDocument()
         d->m_fontThread->wait();
         d->m_fontThread = 0;
     }
+    d->m_fontReadingActive = false;
 
     // stop any audio playback
     AudioPlayer::instance()->stopPlaybacks();
@@ -1864,8 +2001,12 @@ void Document::closeDocument()
     d->m_exportFormats.clear();
     d->m_exportToText = ExportFormat();
     d->m_fontsCached = false;
+    d->m_fontsNextPage = -1;
     d->m_fontsCache.clear();
+    d->m_fontsCachePages.clear();
     d->m_rotation = Rotation0;
+    d->m_relayoutPending = false;
+    d->m_relayoutScheduled = false;
 
     // send an empty list to observers (to free their data)
     foreachObserver( notifySetup( QVector< Page * >(), DocumentObserver::DocumentChanged ) );
@@ -1948,6 +2089,7 @@ void Document::removeObserver( DocumentObserver * pObserver )
             if ( p->id == observerId )
             {
                 aIt = d->m_allocatedPixmapsFifo.erase( aIt );
+                d->m_allocatedPixmapsTotalMemory -= p->memory;
                 delete p;
             }
             else
@@ -1956,6 +2098,7 @@ void Document::removeObserver( DocumentObserver * pObserver )
 
         // delete observer entry from the map
         d->m_observers.remove( observerId );
+        d->m_observersVisibility.remove( observerId );
     }
 }
 
@@ -2062,39 +2205,42 @@ const DocumentSynopsis * Document::documentSynopsis() const
 
 void Document::startFontReading()
 {
-    if ( !d->m_generator || !d->m_generator->hasFeature( Generator::FontInfo ) || d->m_fontThread )
+    if ( !d->m_generator || !d->m_generator->hasFeature( Generator::FontInfo ) || d->m_fontReadingActive )
         return;
 
+    // in case we have cached fonts (all of them, or the ones read before
+    // the last stopFontReading()), simulate a reading; this way the API is
+    // the same, and users no need to care about the internal caching
+    for ( int i = 0; i < d->m_fontsCache.count(); ++i )
+        emit gotFont( d->m_fontsCache.at( i ) );
+
     if ( d->m_fontsCached )
     {
-        // in case we have cached fonts, simulate a reading
-        // this way the API is the same, and users no need to care about the
-        // internal caching
-        for ( int i = 0; i < d->m_fontsCache.count(); ++i )
-        {
-            emit gotFont( d->m_fontsCache.at( i ) );
-            emit fontReadingProgress( i / pages() );
-        }
+        emit fontReadingProgress( pages() - 1 );
         emit fontReadingEnded();
         return;
     }
 
-    d->m_fontThread = new FontExtractionThread( d->m_generator, pages() );
-    connect( d->m_fontThread, SIGNAL(gotFont(Okular::FontInfo)), this, SLOT(fontReadingGotFont(Okular::FontInfo)) );
-    connect( d->m_fontThread, SIGNAL(progress(int)), this, SLOT(fontReadingProgress(int)) );
+    if ( d->m_fontsNextPage > -1 )
+        emit fontReadingProgress( d->m_fontsNextPage - 1 );
 
-    d->m_fontThread->startExtraction( /*d->m_generator->hasFeature( Generator::Threaded )*/true );
+    d->m_fontReadingActive = true;
+    // if the thread of the last reading is still stopping, it goes on once
+    // it is done (see fontReadingFinished())
+    if ( !d->m_fontThread )
+        d->startFontThread();
 }
 
 void Document::stopFontReading()
 {
-    if ( !d->m_fontThread )
+    if ( !d->m_fontReadingActive )
         return;
 
-    disconnect( d->m_fontThread, 0, this, 0 );
-    d->m_fontThread->stopExtraction();
-    d->m_fontThread = 0;
-    d->m_fontsCache.clear();
+    // do not wait for the thread to finish the page it is reading: the
+    // fonts it still reports are kept, so the next reading starts from there
+    d->m_fontReadingActive = false;
+    if ( d->m_fontThread )
+        d->m_fontThread->stopExtraction();
 }
 
 bool Document::canProvideFontInformation() const
@@ -2124,11 +2270,25 @@ const QVector< VisiblePageRect * > & Document::visiblePageRects() const
 
 void Document::setVisiblePageRects( const QVector< VisiblePageRect * > & visiblePageRects, int excludeId )
 {
+    QSet< int > oldPages;
     QVector< VisiblePageRect * >::const_iterator vIt = d->m_pageRects.constBegin();
     QVector< VisiblePageRect * >::const_iterator vEnd = d->m_pageRects.constEnd();
     for ( ; vIt != vEnd; ++vIt )
+    {
+        oldPages.insert( (*vIt)->pageNumber );
         delete *vIt;
+    }
     d->m_pageRects = visiblePageRects;
+
+    // lay out the resized pages when the visible pages change
+    if ( d->m_relayoutPending )
+    {
+        QSet< int > newPages;
+        for ( vIt = visiblePageRects.constBegin(), vEnd = visiblePageRects.constEnd(); vIt != vEnd; ++vIt )
+            newPages.insert( (*vIt)->pageNumber );
+        if ( newPages != oldPages )
+            d->scheduleRelayout();
+    }
     // notify change to all other (different from id) observers
     QMap< int, DocumentObserver * >::const_iterator it = d->m_observers.constBegin(), end = d->m_observers.constEnd();
     for ( ; it != end ; ++ it )
@@ -2136,6 +2296,16 @@ void Document::setVisiblePageRects( const QVector< VisiblePageRect * > & visible
             (*it)->notifyVisibleRectsChanged();
 }
 
+void Document::setObserverVisible( int id, bool visible )
+{
+    if ( !d->m_observers.contains( id ) )
+        return;
+
+    d->m_observersVisibility.insert( id, visible );
+    if ( visible )
+        CacheManager::self()->touchDocument( d );
+}
+
 uint Document::currentPage() const
 {
     return (*d->m_viewportIterator).pageNumber;
@@ -2299,6 +2469,7 @@ void Document::requestPixmaps( const QLinkedList< PixmapRequest * > & requests,
             requestedPages.insert( (*rIt)->pageNumber() );
     }
     const bool removeAllPrevious = reqOptions & RemoveAllPrevious;
+    CacheManager::self()->touchDocument( d );
     d->m_pixmapRequestsMutex.lock();
     QLinkedList< PixmapRequest * >::iterator sIt = d->m_pixmapRequestsStack.begin(), sEnd = d->m_pixmapRequestsStack.end();
     while ( sIt != sEnd )
@@ -2314,6 +2485,33 @@ void Document::requestPixmaps( const QLinkedList< PixmapRequest * > & requests,
             ++sIt;
     }
 
+    // 1.1 [CANCEL RUNNING] the requests of requesterID being generated are
+    // obsolete as well, unless a new request asks for the same pixmap
+    QLinkedList< PixmapRequest * >::const_iterator eIt = d->m_executingPixmapRequests.constBegin(), eEnd = d->m_executingPixmapRequests.constEnd();
+    for ( ; eIt != eEnd; ++eIt )
+    {
+        PixmapRequest * executing = *eIt;
+        if ( executing->id() != requesterID
+             || !( removeAllPrevious || requestedPages.contains( executing->pageNumber() ) ) )
+            continue;
+
+        // the size of a running request is swapped for rotated documents
+        int width = executing->width(), height = executing->height();
+        if ( (int)d->m_rotation % 2 )
+            qSwap( width, height );
+
+        bool stillWanted = false;
+        QLinkedList< PixmapRequest * >::const_iterator rIt = requests.constBegin(), rEnd = requests.constEnd();
+        for ( ; rIt != rEnd && !stillWanted; ++rIt )
+            stillWanted = (*rIt)->pageNumber() == executing->pageNumber()
+                          && (*rIt)->width() == width && (*rIt)->height() == height;
+        if ( !stillWanted )
+        {
+            kDebug(OkularDebug).nospace() << "cancelling request id=" << executing->id() << " " << executing->width() << "x" << executing->height() << "@" << executing->pageNumber();
+            executing->d->mCancelled = 1;
+        }
+    }
+
     // 2. [ADD TO STACK] add requests to stack
     bool threadingDisabled = !Settings::enableThreading();
     QLinkedList< PixmapRequest * >::const_iterator rIt = requests.constBegin(), rEnd = requests.constEnd();
@@ -2813,6 +3011,8 @@ void Document::searchText( int searchID, const QString & text, bool fromStart, Q
     {
         RunningSearch * search = new RunningSearch();
         search->continueOnPage = -1;
+        search->generation = 0;
+        search->matchingPagesCaseSensitivity = caseSensitivity;
         searchIt = d->m_searches.insert( searchID, search );
     }
     if (d->m_lastSearchID != searchID)
@@ -2831,6 +3031,18 @@ void Document::searchText( int searchID, const QString & text, bool fromStart, Q
     s->cachedNoDialogs = noDialogs;
     s->cachedColor = color;
     s->isCurrentlySearching = true;
+    s->generation = ++d->m_searchGeneration;
+
+    // set hourglass cursor
+    QApplication::setOverrideCursor( Qt::WaitCursor );
+
+    // 1. ALLDOC - proces all document marking pages
+    if ( type == AllDocument )
+    {
+        // search and highlight 'text' (as a solid phrase) on all pages
+        d->startAllDocumentSearch( s, searchID, text, caseSensitivity, color );
+        return;
+    }
 
     // global data for search
     QSet< int > *pagesToNotify = new QSet< int >;
@@ -2841,19 +3053,8 @@ void Document::searchText( int searchID, const QString & text, bool fromStart, Q
         d->m_pagesVector.at(pageNumber)->d->deleteHighlights( searchID );
     s->highlightedPages.clear();
 
-    // set hourglass cursor
-    QApplication::setOverrideCursor( Qt::WaitCursor );
-
-    // 1. ALLDOC - proces all document marking pages
-    if ( type == AllDocument )
-    {
-        QMap< Page *, QVector<RegularAreaRect *> > *pageMatches = new QMap< Page *, QVector<RegularAreaRect *> >;
-
-        // search and highlight 'text' (as a solid phrase) on all pages
-        QMetaObject::invokeMethod(this, "doContinueAllDocumentSearch", Qt::QueuedConnection, Q_ARG(void *, pagesToNotify), Q_ARG(void *, pageMatches), Q_ARG(int, 0), Q_ARG(int, searchID), Q_ARG(QString, text), Q_ARG(int, caseSensitivity), Q_ARG(QColor, color));
-    }
     // 2. NEXTMATCH - find next matching item (or start from top)
-    else if ( type == NextMatch )
+    if ( type == NextMatch )
     {
         // find out from where to start/resume search from
         int viewportPage = (*d->m_viewportIterator).pageNumber;
@@ -3229,7 +3430,7 @@ void Document::processAction( const Action * action )
             const ScriptAction * linkscript = static_cast< const ScriptAction * >( action );
             if ( !d->m_scripter )
                 d->m_scripter = new Scripter( d );
-            d->m_scripter->execute( linkscript->scriptType(), linkscript->script() );
+            d->m_scripter->executeAction( linkscript->scriptType(), linkscript->script() );
             } break;
 
         case Action::Movie:
@@ -3771,6 +3972,21 @@ void Document::setAnnotationEditingEnabled( bool enable )
     foreachObserver( notifySetup( d->m_pagesVector, 0 ) );
 }
 
+RenderStatistics Document::renderStatistics() const
+{
+    d->m_pixmapRequestsMutex.lock();
+    const int queued = d->m_pixmapRequestsStack.count();
+    const int executing = d->m_executingPixmapRequests.count();
+    d->m_pixmapRequestsMutex.unlock();
+
+    return d->m_renderStatistics.statistics( d->m_allocatedPixmapsTotalMemory, queued, executing );
+}
+
+void Document::resetRenderStatistics()
+{
+    d->m_renderStatistics.reset();
+}
+
 void DocumentPrivate::requestDone( PixmapRequest * req )
 {
     if ( !req )
@@ -3792,6 +4008,20 @@ void DocumentPrivate::requestDone( PixmapRequest * req )
         kDebug(OkularDebug) << "requestDone with generator not in READY state.";
 #endif
 
+    // a cancelled request has no pixmap to account for, unless the generator
+    // completed it anyway; in any case its observer asked for something else
+    if ( req->isCancelled() && !req->page()->hasPixmap( req->id(), req->width(), req->height() ) )
+    {
+        m_pixmapRequestsMutex.lock();
+        m_executingPixmapRequests.removeAll( req );
+        bool hasPixmaps = !m_pixmapRequestsStack.isEmpty();
+        m_pixmapRequestsMutex.unlock();
+        delete req;
+        if ( hasPixmaps )
+            sendGeneratorRequest();
+        return;
+    }
+
     // [MEM] 1.1 find and remove a previous entry for the same page and id
     QLinkedList< AllocatedPixmap * >::iterator aIt = m_allocatedPixmapsFifo.begin();
     QLinkedList< AllocatedPixmap * >::iterator aEnd = m_allocatedPixmapsFifo.end();
@@ -3813,6 +4043,8 @@ void DocumentPrivate::requestDone( PixmapRequest * req )
         AllocatedPixmap * memoryPage = new AllocatedPixmap( req->id(), req->pageNumber(), memoryBytes );
         m_allocatedPixmapsFifo.append( memoryPage );
         m_allocatedPixmapsTotalMemory += memoryBytes;
+        if ( req->d->mStartTime.isValid() )
+            m_renderStatistics.pixmapRequestDone( req->d->mStartTime.elapsed(), memoryBytes );
 
         // 2. notify an observer that its pixmap changed
         itObserver.value()->notifyPageChanged( req->pageNumber(), DocumentObserver::Pixmap );
@@ -3856,9 +4088,78 @@ void DocumentPrivate::setPageBoundingBox( int page, const NormalizedRect& boundi
 
 }
 
+void DocumentPrivate::resizePage( int page, double width, double height, Rotation orientation )
+{
+    Page * kp = m_pagesVector.value( page, 0 );
+    if ( !m_generator || !kp )
+        return;
+
+    if ( !kp->d->resize( width, height, orientation ) )
+        return;
+
+    // [MEM] the pixmaps of the page are gone
+    QLinkedList< AllocatedPixmap * >::iterator aIt = m_allocatedPixmapsFifo.begin();
+    QLinkedList< AllocatedPixmap * >::iterator aEnd = m_allocatedPixmapsFifo.end();
+    while ( aIt != aEnd )
+    {
+        AllocatedPixmap * p = *aIt;
+        if ( p->page == page )
+        {
+            aIt = m_allocatedPixmapsFifo.erase( aIt );
+            m_allocatedPixmapsTotalMemory -= p->memory;
+            delete p;
+        }
+        else
+            ++aIt;
+    }
+
+    // the pages resized out of the view are laid out again together, later
+    m_relayoutPending = true;
+    QVector< VisiblePageRect * >::const_iterator vIt = m_pageRects.constBegin(), vEnd = m_pageRects.constEnd();
+    for ( ; vIt != vEnd; ++vIt )
+    {
+        if ( (*vIt)->pageNumber == page )
+        {
+            scheduleRelayout();
+            break;
+        }
+    }
+}
+
+void DocumentPrivate::scheduleRelayout()
+{
+    if ( !m_relayoutPending || m_relayoutScheduled )
+        return;
+
+    // once for all the pages resized in the same event loop iteration
+    m_relayoutScheduled = true;
+    QTimer::singleShot( 0, m_parent, SLOT(relayoutPages()) );
+}
+
+void DocumentPrivate::requestReload()
+{
+    emit m_parent->reloadRequested();
+}
+
+void DocumentPrivate::requestClose()
+{
+    emit m_parent->closeRequested();
+}
+
+void DocumentPrivate::relayoutPages()
+{
+    m_relayoutScheduled = false;
+    if ( !m_relayoutPending )
+        return;
+
+    m_relayoutPending = false;
+    foreachObserverD( notifySetup( m_pagesVector, DocumentObserver::NewLayoutForPages ) );
+}
+
 void DocumentPrivate::calculateMaxTextPages()
 {
-    int multipliers = qMax(1, qRound(getTotalMemory() / 536870912.0)); // 512 MB
+    m_memoryLimitsVersion = MemoryGovernor::self()->limitsVersion();
+    int multipliers = qMax(1, qRound(MemoryGovernor::self()->budgetScale() * getTotalMemory() / 536870912.0)); // 512 MB
     switch (Settings::memoryLevel())
     {
         case Settings::EnumMemoryLevel::Low:
@@ -3883,15 +4184,11 @@ void DocumentPrivate::textGenerationDone( Page *page )
 {
     if ( !m_generator || m_closingLoop ) return;
 
-    // 1. If we reached the cache limit, delete the first text page from the fifo
-    if (m_allocatedTextPagesFifo.size() == m_maxAllocatedTextPages)
-    {
-        int pageToKick = m_allocatedTextPagesFifo.takeFirst();
-        if (pageToKick != page->number()) // this should never happen but better be safe than sorry
-        {
-            m_pagesVector.at(pageToKick)->setTextPage( 0 ); // deletes the textpage
-        }
-    }
+    // 1. If we reached the cache limit (shared by all the documents), delete
+    //    the oldest text pages, starting from the documents not shown
+    //    (the limit can shrink at runtime, so there can be more than one)
+    m_allocatedTextPagesFifo.removeAll( page->number() );
+    CacheManager::self()->freeTextPages( m_maxAllocatedTextPages - 1 );
 
     // 2. Add the page to the fifo of generated text pages
     m_allocatedTextPagesFifo.append( page->number() );
@@ -48,6 +48,7 @@ class Action;
 class MovieAction;
 class Page;
 class PixmapRequest;
+class RenderStatistics;
 class SourceReference;
 class View;
 class VisiblePageRect;
@@ -182,6 +183,18 @@ class OKULAR_EXPORT Document : public QObject
          */
         void setVisiblePageRects( const QVector< VisiblePageRect * > & visiblePageRects, int excludeId = -1 );
 
+        /**
+         * Sets whether the observer with the given @p id is shown to the user.
+         *
+         * The memory for pixmaps and text pages is shared by all the
+         * documents of the process; when it runs short, the documents with
+         * no observer shown are the first ones to lose their pixmaps and
+         * text pages.
+         *
+         * @since 0.15 (KDE 4.9)
+         */
+        void setObserverVisible( int id, bool visible );
+
         /**
          * Returns the list of visible page rectangles.
          */
@@ -674,6 +687,21 @@ class OKULAR_EXPORT Document : public QObject
         */
         void setAnnotationEditingEnabled( bool enable );
 
+        /**
+         * Returns a snapshot of the rendering statistics (latencies, queue
+         * lengths, eviction counts) of the current generator.
+         *
+         * @since 0.15 (KDE 4.9)
+         */
+        RenderStatistics renderStatistics() const;
+
+        /**
+         * Clears the rendering statistics collected so far.
+         *
+         * @since 0.15 (KDE 4.9)
+         */
+        void resetRenderStatistics();
+
 
     public Q_SLOTS:
         /**
@@ -801,6 +829,22 @@ class OKULAR_EXPORT Document : public QObject
          */
         void processMovieAction( const Okular::MovieAction *action );
 
+        /**
+         * This signal is emitted when the generator asks for the document
+         * to be loaded again, as the pages it handed are out of date.
+         *
+         * @since 0.15 (KDE 4.9)
+         */
+        void reloadRequested();
+
+        /**
+         * This signal is emitted when the generator asks for the document
+         * to be closed, as it could not load it after handing its pages.
+         *
+         * @since 0.15 (KDE 4.9)
+         */
+        void closeRequested();
+
     private:
         /// @cond PRIVATE
         friend class DocumentPrivate;
@@ -815,14 +859,16 @@ class OKULAR_EXPORT Document : public QObject
         Q_PRIVATE_SLOT( d, void rotationFinished( int page, Okular::Page *okularPage ) )
         Q_PRIVATE_SLOT( d, void fontReadingProgress( int page ) )
         Q_PRIVATE_SLOT( d, void fontReadingGotFont( const Okular::FontInfo& font ) )
+        Q_PRIVATE_SLOT( d, void fontReadingFinished() )
         Q_PRIVATE_SLOT( d, void slotGeneratorConfigChanged( const QString& ) )
         Q_PRIVATE_SLOT( d, void refreshPixmaps( int ) )
+        Q_PRIVATE_SLOT( d, void relayoutPages() )
         Q_PRIVATE_SLOT( d, void _o_configChanged() )
 
         // search thread simulators
         Q_PRIVATE_SLOT( d, void doContinueNextMatchSearch(void *pagesToNotifySet, void * match, int currentPage, int searchID, const QString & text, int caseSensitivity, bool moveViewport, const QColor & color, bool noDialogs, int donePages) )
         Q_PRIVATE_SLOT( d, void doContinuePrevMatchSearch(void *pagesToNotifySet, void * match, int currentPage, int searchID, const QString & text, int caseSensitivity, bool moveViewport, const QColor & color, bool noDialogs, int donePages) )
-        Q_PRIVATE_SLOT( d, void doContinueAllDocumentSearch(void *pagesToNotifySet, void *pageMatchesMap, int currentPage, int searchID, const QString & text, int caseSensitivity, const QColor & color) )
+        Q_PRIVATE_SLOT( d, void doContinueAllDocumentSearch(void *searchState, int currentIndex, int searchID, const QString & text, int caseSensitivity, const QColor & color) )
         Q_PRIVATE_SLOT( d, void doContinueGooglesDocumentSearch(void *pagesToNotifySet, void *pageMatchesMap, int currentPage, int searchID, const QStringList & words, int caseSensitivity, const QColor & color, bool matchAll) )
 };
 
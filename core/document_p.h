@@ -26,6 +26,7 @@
 // local includes
 #include "fontinfo.h"
 #include "generator.h"
+#include "renderstatistics_p.h"
 
 class QEventLoop;
 class QTimer;
@@ -69,10 +70,12 @@ class DocumentPrivate
         DocumentPrivate( Document *parent )
           : m_parent( parent ),
             m_lastSearchID( -1 ),
+            m_searchGeneration( 0 ),
             m_tempFile( 0 ),
             m_docSize( -1 ),
             m_allocatedPixmapsTotalMemory( 0 ),
             m_maxAllocatedTextPages( 0 ),
+            m_memoryLimitsVersion( -1 ),
             m_warnedOutOfMemory( false ),
             m_rotation( Rotation0 ),
             m_exportCached( false ),
@@ -85,9 +88,13 @@ class DocumentPrivate
             m_scripter( 0 ),
             m_archiveData( 0 ),
             m_fontsCached( false ),
+            m_fontsNextPage( -1 ),
+            m_fontReadingActive( false ),
             m_documentInfo( 0 ),
             m_annotationEditingEnabled ( true ),
-            m_annotationBeingMoved( false )
+            m_annotationBeingMoved( false ),
+            m_relayoutPending( false ),
+            m_relayoutScheduled( false )
         {
             calculateMaxTextPages();
         }
@@ -96,6 +103,9 @@ class DocumentPrivate
         QString pagesSizeString() const;
         QString localizedSize(const QSizeF &size) const;
         void cleanupPixmapMemory( qulonglong bytesOffset = 0 );
+        qulonglong freePixmapMemory( qulonglong bytes );
+        int freeTextPages( int count );
+        bool isVisible() const;
         void calculateMaxTextPages();
         qulonglong getTotalMemory();
         qulonglong getFreeMemory();
@@ -103,6 +113,8 @@ class DocumentPrivate
         void loadDocumentInfo( const QString &fileName );
         void loadViewsInfo( View *view, const QDomElement &e );
         void saveViewsInfo( View *view, QDomElement &e ) const;
+        void loadFontsInfo( const QDomElement &e );
+        void saveFontsInfo( QDomElement &e ) const;
         QString giveAbsolutePath( const QString & fileName ) const;
         bool openRelativeFile( const QString & fileName );
         Generator * loadGeneratorLibrary( const KService::Ptr &service );
@@ -129,14 +141,18 @@ class DocumentPrivate
         void rotationFinished( int page, Okular::Page *okularPage );
         void fontReadingProgress( int page );
         void fontReadingGotFont( const Okular::FontInfo& font );
+        void fontReadingFinished();
+        void startFontThread();
         void slotGeneratorConfigChanged( const QString& );
         void refreshPixmaps( int );
+        void relayoutPages();
         void _o_configChanged();
         void doContinueNextMatchSearch(void *pagesToNotifySet, void * match, int currentPage, int searchID, const QString & text, int caseSensitivity, bool moveViewport, const QColor & color, bool noDialogs, int donePages);
         void doContinuePrevMatchSearch(void *pagesToNotifySet, void * theMatch, int currentPage, int searchID, const QString & text, int theCaseSensitivity, bool moveViewport, const QColor & color, bool noDialogs, int donePages);
-        void doContinueAllDocumentSearch(void *pagesToNotifySet, void *pageMatchesMap, int currentPage, int searchID, const QString & text, int caseSensitivity, const QColor & color);
+        void doContinueAllDocumentSearch(void *searchState, int currentIndex, int searchID, const QString & text, int caseSensitivity, const QColor & color);
         void doContinueGooglesDocumentSearch(void *pagesToNotifySet, void *pageMatchesMap, int currentPage, int searchID, const QStringList & words, int caseSensitivity, const QColor & color, bool matchAll);
 
+        void startAllDocumentSearch( RunningSearch *search, int searchID, const QString & text, Qt::CaseSensitivity caseSensitivity, const QColor & color );
         void doProcessSearchMatch( RegularAreaRect *match, RunningSearch *search, QSet< int > *pagesToNotify, int currentPage, int searchID, bool moveViewport, const QColor & color );
 
         // generators stuff
@@ -150,6 +166,26 @@ class DocumentPrivate
          * Sets the bounding box of the given @p page (in terms of upright orientation, i.e., Rotation0).
          */
         void setPageBoundingBox( int page, const NormalizedRect& boundingBox );
+        /**
+         * Sets the size and the orientation of the given @p page; the new
+         * layout is notified to the observers right away if the page is
+         * visible, otherwise when the visible pages change or scheduleRelayout()
+         * is called.
+         */
+        void resizePage( int page, double width, double height, Rotation orientation );
+        /**
+         * Schedules the notification of the new layout of the resized pages,
+         * if any, to the observers.
+         */
+        void scheduleRelayout();
+        /**
+         * Asks the part to load the document again.
+         */
+        void requestReload();
+        /**
+         * Asks the part to close the document.
+         */
+        void requestClose();
         /**
          * Request a particular metadata of the Document itself (ie, not something
          * depending on the document type/backend).
@@ -163,6 +199,7 @@ class DocumentPrivate
         // find descriptors, mapped by ID (we handle multiple searches)
         QMap< int, RunningSearch * > m_searches;
         int m_lastSearchID;
+        int m_searchGeneration;
         bool m_searchCancelled;
 
         // needed because for remote documents docFileName is a local file and
@@ -183,6 +220,7 @@ class DocumentPrivate
 
         // observers / requests / allocator stuff
         QMap< int, DocumentObserver * > m_observers;
+        QMap< int, bool > m_observersVisibility;
         QLinkedList< PixmapRequest * > m_pixmapRequestsStack;
         QLinkedList< PixmapRequest * > m_executingPixmapRequests;
         QMutex m_pixmapRequestsMutex;
@@ -190,7 +228,9 @@ class DocumentPrivate
         qulonglong m_allocatedPixmapsTotalMemory;
         QList< int > m_allocatedTextPagesFifo;
         int m_maxAllocatedTextPages;
+        int m_memoryLimitsVersion;
         bool m_warnedOutOfMemory;
+        RenderStatisticsCollector m_renderStatistics;
 
         // the rotation applied to the document
         Rotation m_rotation;
@@ -231,8 +271,11 @@ class DocumentPrivate
 
         QPointer< FontExtractionThread > m_fontThread;
         bool m_fontsCached;
+        int m_fontsNextPage; // the first page still to scan for fonts
+        bool m_fontReadingActive; // between startFontReading() and its end or stop
         DocumentInfo *m_documentInfo;
         FontInfo::List m_fontsCache;
+        QList< int > m_fontsCachePages; // the page where each font was found
 
         QSet< View * > m_views;
 
@@ -240,6 +283,10 @@ class DocumentPrivate
         bool m_annotationsNeedSaveAs;
         bool m_annotationBeingMoved; // is an annotation currently being moved?
         bool m_showWarningLimitedAnnotSupport;
+
+        // some pages were resized, and the observers not notified yet
+        bool m_relayoutPending;
+        bool m_relayoutScheduled;
 };
 
 }
@@ -84,17 +84,27 @@ void GeneratorPrivate::pixmapGenerationFinished()
     PixmapRequest *request = mPixmapGenerationThread->request();
     mPixmapGenerationThread->endGeneration();
 
-    QMutexLocker locker( threadsLock() );
+    // not locked any longer: signalPixmapRequestDone() can start the
+    // generation of the next request
+    threadsLock()->lock();
     mPixmapReady = true;
+    mPixmapReadyCondition.wakeAll();
+    const bool closing = m_closing;
+    const bool textPageReady = mTextPageReady;
+    threadsLock()->unlock();
 
-    if ( m_closing )
+    if ( closing )
     {
         delete request;
-        if ( mTextPageReady )
-        {
-            locker.unlock();
+        if ( textPageReady )
             m_closingLoop->quit();
-        }
+        return;
+    }
+
+    // the image of a cancelled request may be incomplete, so just drop it
+    if ( request->isCancelled() )
+    {
+        q->signalPixmapRequestDone( request );
         return;
     }
 
@@ -113,23 +123,25 @@ void GeneratorPrivate::textpageGenerationFinished()
     Page *page = mTextPageGenerationThread->page();
     mTextPageGenerationThread->endGeneration();
 
-    QMutexLocker locker( threadsLock() );
+    threadsLock()->lock();
     mTextPageReady = true;
+    const bool closing = m_closing;
+    const bool pixmapReady = mPixmapReady;
+    threadsLock()->unlock();
 
-    if ( m_closing )
+    if ( closing )
     {
         delete mTextPageGenerationThread->textPage();
-        if ( mPixmapReady )
-        {
-            locker.unlock();
+        if ( pixmapReady )
             m_closingLoop->quit();
-        }
         return;
     }
 
     if ( mTextPageGenerationThread->textPage() )
     {
         TextPage *tp = mTextPageGenerationThread->textPage();
+        if ( m_document )
+            m_document->m_renderStatistics.textPageGenerated( mTextPageStartTime.elapsed() );
         page->setTextPage( tp );
         q->signalTextGenerationDone( page, tp );
     }
@@ -216,7 +228,9 @@ bool Generator::canGeneratePixmap() const
 void Generator::generatePixmap( PixmapRequest *request )
 {
     Q_D( Generator );
+    d->threadsLock()->lock();
     d->mPixmapReady = false;
+    d->threadsLock()->unlock();
 
     if ( request->asynchronous() && hasFeature( Threaded ) )
     {
@@ -228,6 +242,7 @@ void Generator::generatePixmap( PixmapRequest *request )
          */
         if ( hasFeature( TextExtraction ) && !request->page()->hasTextPage() && canGenerateTextPage() ) {
             d->mTextPageReady = false;
+            d->mTextPageStartTime.start();
             d->textPageGenerationThread()->startGeneration( request->page() );
         }
 
@@ -239,7 +254,10 @@ void Generator::generatePixmap( PixmapRequest *request )
     const bool bboxKnown = request->page()->isBoundingBoxKnown();
     const int pageNumber = request->page()->number();
 
+    d->threadsLock()->lock();
     d->mPixmapReady = true;
+    d->mPixmapReadyCondition.wakeAll();
+    d->threadsLock()->unlock();
 
     signalPixmapRequestDone( request );
     if ( !bboxKnown )
@@ -255,7 +273,11 @@ bool Generator::canGenerateTextPage() const
 void Generator::generateTextPage( Page *page )
 {
     Q_D( Generator );
+    QTime time;
+    time.start();
     TextPage *tp = textPage( page );
+    if ( d->m_document )
+        d->m_document->m_renderStatistics.textPageGenerated( time.elapsed() );
     page->setTextPage( tp );
     signalTextGenerationDone( page, tp );
 }
@@ -411,6 +433,41 @@ void Generator::updatePageBoundingBox( int page, const NormalizedRect & bounding
         d->m_document->setPageBoundingBox( page, boundingBox );
 }
 
+void Generator::updatePageSize( int page, double width, double height, Rotation orientation )
+{
+    Q_D( Generator );
+    if ( d->m_document ) // still connected to document?
+        d->m_document->resizePage( page, width, height, orientation );
+}
+
+void Generator::updatePageSizesDone()
+{
+    Q_D( Generator );
+    if ( d->m_document ) // still connected to document?
+        d->m_document->scheduleRelayout();
+}
+
+void Generator::updatePageObjects( int page )
+{
+    Q_D( Generator );
+    if ( d->m_document ) // still connected to document?
+        d->m_document->notifyAnnotationChanges( page );
+}
+
+void Generator::requestReload()
+{
+    Q_D( Generator );
+    if ( d->m_document ) // still connected to document?
+        d->m_document->requestReload();
+}
+
+void Generator::requestClose()
+{
+    Q_D( Generator );
+    if ( d->m_document ) // still connected to document?
+        d->m_document->requestClose();
+}
+
 void Generator::requestFontData(const Okular::FontInfo & /*font*/, QByteArray * /*data*/)
 {
 
@@ -431,6 +488,7 @@ PixmapRequest::PixmapRequest( int id, int pageNumber, int width, int height, int
     d->mPriority = priority;
     d->mAsynchronous = asynchronous;
     d->mForce = false;
+    d->mCancelled = 0;
 }
 
 PixmapRequest::~PixmapRequest()
@@ -473,6 +531,11 @@ Page* PixmapRequest::page() const
     return d->mPage;
 }
 
+bool PixmapRequest::isCancelled() const
+{
+    return d->mCancelled;
+}
+
 void PixmapRequestPrivate::swap()
 {
     qSwap( mWidth, mHeight );
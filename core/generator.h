@@ -186,6 +186,7 @@ class OKULAR_EXPORT Generator : public QObject
     /// @cond PRIVATE
     friend class PixmapGenerationThread;
     friend class TextPageGenerationThread;
+    friend class FontExtractionThread;
     /// @endcond
 
     Q_OBJECT
@@ -473,10 +474,62 @@ class OKULAR_EXPORT Generator : public QObject
          */
         void updatePageBoundingBox( int page, const NormalizedRect & boundingBox );
 
+        /**
+         * Set the size and the orientation of a page after the page has already
+         * been handed to the Document, for generators that create the pages
+         * with a guessed size and read the real one later. The @p width and
+         * @p height are meant like in the constructor of Page.
+         *
+         * The observers are notified of the new layout when a resized page is
+         * visible, when the visible pages change, or when the generator calls
+         * updatePageSizesDone(), so they lay the pages out once for all the
+         * pages resized meanwhile.
+         *
+         * @since 0.15 (KDE 4.9)
+         */
+        void updatePageSize( int page, double width, double height, Rotation orientation );
+
+        /**
+         * Notify the observers of the new layout of the pages resized with
+         * updatePageSize(), when the generator is done resizing them.
+         *
+         * @since 0.15 (KDE 4.9)
+         */
+        void updatePageSizesDone();
+
+        /**
+         * Notify the observers that the object rects or the annotations of a
+         * page changed after the page has already been handed to the
+         * Document.
+         *
+         * @since 0.15 (KDE 4.9)
+         */
+        void updatePageObjects( int page );
+
+        /**
+         * Ask for the document to be loaded again, when the pages already
+         * handed to the Document turned out to be out of date.
+         *
+         * @since 0.15 (KDE 4.9)
+         */
+        void requestReload();
+
+        /**
+         * Ask for the document to be closed, when it cannot be loaded
+         * after its pages were already handed to the Document.
+         *
+         * @since 0.15 (KDE 4.9)
+         */
+        void requestClose();
+
     protected Q_SLOTS:
         /**
          * Gets the font data for the given font
          *
+         * The fonts of the document can be restored from the data of a
+         * previous session: their native id is then the number of the page
+         * whose fontsForPage() reported them.
+         *
          * @since 0.8 (KDE 4.1)
          */
         void requestFontData(const Okular::FontInfo &font, QByteArray *data);
@@ -579,6 +632,21 @@ class OKULAR_EXPORT PixmapRequest
          */
         Page *page() const;
 
+        /**
+         * Returns whether the request has been cancelled, because a newer
+         * request of the same observer superseded it while it was being
+         * generated.
+         *
+         * Generators which render in more steps (or whose rendering library
+         * can be interrupted) should check it and stop the rendering as soon
+         * as possible; the result of a cancelled request is discarded anyway.
+         *
+         * It is safe to call from the generation thread.
+         *
+         * @since 0.15 (KDE 4.9)
+         */
+        bool isCancelled() const;
+
     private:
         Q_DISABLE_COPY( PixmapRequest )
 
@@ -9,6 +9,8 @@
 
 #include "generator_p.h"
 
+#include <QtCore/QMutex>
+
 #include <kdebug.h>
 
 #include "fontinfo.h"
@@ -59,10 +61,10 @@ void PixmapGenerationThread::run()
 {
     mImage = QImage();
 
-    if ( mRequest )
+    if ( mRequest && !mRequest->isCancelled() )
     {
         mImage = mGenerator->image( mRequest );
-        if ( mCalcBoundingBox )
+        if ( mCalcBoundingBox && !mRequest->isCancelled() )
             mBoundingBox = Utils::imageBoundingBox( &mImage );
     }
 }
@@ -104,8 +106,8 @@ void TextPageGenerationThread::run()
 }
 
 
-FontExtractionThread::FontExtractionThread( Generator *generator, int pages )
-    : mGenerator( generator ), mNumOfPages( pages ), mGoOn( true )
+FontExtractionThread::FontExtractionThread( Generator *generator, int pages, int firstPage )
+    : mGenerator( generator ), mNumOfPages( pages ), mFirstPage( firstPage ), mGoOn( true )
 {
 }
 
@@ -125,13 +127,29 @@ void FontExtractionThread::startExtraction( bool async )
 
 void FontExtractionThread::stopExtraction()
 {
+    GeneratorPrivate *d = mGenerator->d_func();
+    QMutexLocker locker( d->threadsLock() );
     mGoOn = false;
+    d->mPixmapReadyCondition.wakeAll();
 }
 
 void FontExtractionThread::run()
 {
-    for ( int i = -1; i < mNumOfPages && mGoOn; ++i )
+    for ( int i = mFirstPage; i < mNumOfPages && mGoOn; ++i )
     {
+        // the threaded generators usually hold their lock both while
+        // rendering and while reading the fonts of a page: let a running
+        // render go first, so a long scan does not stall the page view
+        if ( mGenerator->hasFeature( Generator::Threaded ) )
+        {
+            GeneratorPrivate *d = mGenerator->d_func();
+            QMutexLocker locker( d->threadsLock() );
+            while ( mGoOn && !d->mPixmapReady )
+                d->mPixmapReadyCondition.wait( d->threadsLock() );
+            if ( !mGoOn )
+                break;
+        }
+
         FontInfo::List list = mGenerator->fontsForPage( i );
         foreach ( const FontInfo& fi, list )
         {
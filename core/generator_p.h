@@ -12,8 +12,11 @@
 
 #include "area.h"
 
+#include <QtCore/QAtomicInt>
 #include <QtCore/QSet>
 #include <QtCore/QThread>
+#include <QtCore/QTime>
+#include <QtCore/QWaitCondition>
 #include <QtGui/QImage>
 
 class QEventLoop;
@@ -59,10 +62,14 @@ class GeneratorPrivate
         TextPageGenerationThread *mTextPageGenerationThread;
         mutable QMutex *m_mutex;
         QMutex *m_threadsMutex;
-        bool mPixmapReady : 1;
-        bool mTextPageReady : 1;
-        bool m_closing : 1;
+        // woken (under threadsLock()) when mPixmapReady becomes true
+        QWaitCondition mPixmapReadyCondition;
+        // not bitfields: mPixmapReady is read by other threads
+        bool mPixmapReady;
+        bool mTextPageReady;
+        bool m_closing;
         QEventLoop *m_closingLoop;
+        QTime mTextPageStartTime;
 };
 
 
@@ -79,6 +86,9 @@ class PixmapRequestPrivate
         bool mAsynchronous;
         bool mForce : 1;
         Page *mPage;
+        QTime mStartTime;
+        // set from the gui thread, read from the generation thread
+        QAtomicInt mCancelled;
 };
 
 
@@ -140,7 +150,7 @@ class FontExtractionThread : public QThread
     Q_OBJECT
 
     public:
-        FontExtractionThread( Generator *generator, int pages );
+        FontExtractionThread( Generator *generator, int pages, int firstPage = -1 );
 
         void startExtraction( bool async );
         void stopExtraction();
@@ -155,6 +165,7 @@ class FontExtractionThread : public QThread
     private:
         Generator *mGenerator;
         int mNumOfPages;
+        int mFirstPage;
         bool mGoOn;
 };
 
@@ -0,0 +1,385 @@
+/***************************************************************************
+ *   Copyright (C) 2004-2008 by Albert Astals Cid <aacid@kde.org>          *
+ *   Copyright (C) 2026 by the Okular developers <okular-devel@kde.org>    *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include "memorygovernor_p.h"
+
+#ifdef Q_OS_WIN
+#define _WIN32_WINNT 0x0500
+#include <windows.h>
+#elif defined(Q_OS_FREEBSD)
+#include <sys/types.h>
+#include <sys/sysctl.h>
+#include <vm/vm_param.h>
+#endif
+
+// qt/kde includes
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QTextStream>
+
+#include <kdebug.h>
+#include <kglobal.h>
+
+// local includes
+#include "debug_p.h"
+
+K_GLOBAL_STATIC( Okular::MemoryGovernor, memory_governor_self )
+
+// minimum time between two samples of the memory state, in ms
+#define MEMORY_SAMPLE_INTERVAL 2000
+
+using namespace Okular;
+
+#if defined(Q_OS_LINUX)
+static QByteArray readSysFile( const QString &fileName )
+{
+    QFile f( fileName );
+    if ( !f.open( QIODevice::ReadOnly ) )
+        return QByteArray();
+
+    return f.readAll().trimmed();
+}
+
+// returns 0 for "no limit" as well as for errors
+static qulonglong readCGroupLimit( const QString &fileName )
+{
+    const QByteArray value = readSysFile( fileName );
+    if ( value.isEmpty() || value == "max" )
+        return 0;
+
+    bool ok = false;
+    const qulonglong limit = value.toULongLong( &ok );
+    return ok ? limit : 0;
+}
+
+static qulonglong readCGroupStat( const QString &fileName, const QByteArray &key )
+{
+    QFile f( fileName );
+    if ( !f.open( QIODevice::ReadOnly ) )
+        return 0;
+
+    while ( !f.atEnd() )
+    {
+        const QByteArray line = f.readLine().trimmed();
+        const int space = line.indexOf( ' ' );
+        if ( space > 0 && line.left( space ) == key )
+            return line.mid( space + 1 ).toULongLong();
+    }
+    return 0;
+}
+#endif
+
+MemoryGovernor::MemoryGovernor()
+    : m_cgroupVersion( NoCGroup ), m_cgroupDetected( false ),
+      m_sampled( false ), m_physicalTotal( 0 ), m_total( 0 ), m_free( 0 ),
+      m_scale( 1.0 ), m_limitsVersion( 0 ), m_versionTotal( 0 ), m_versionScale( 1.0 )
+{
+}
+
+MemoryGovernor * MemoryGovernor::self()
+{
+    return memory_governor_self;
+}
+
+qulonglong MemoryGovernor::totalMemory()
+{
+    if ( !m_sampled )
+        sample();
+
+    return m_total;
+}
+
+qulonglong MemoryGovernor::freeMemory()
+{
+    update();
+
+    return m_free;
+}
+
+double MemoryGovernor::budgetScale()
+{
+    if ( !m_sampled )
+        sample();
+
+    return m_scale;
+}
+
+void MemoryGovernor::update()
+{
+    if ( m_sampled && m_lastSample.elapsed() >= 0 && m_lastSample.elapsed() < MEMORY_SAMPLE_INTERVAL )
+        return;
+
+    sample();
+}
+
+int MemoryGovernor::limitsVersion()
+{
+    update();
+
+    // consider changes smaller than 5% of the total or of the scale as noise;
+    // comparing with the values of the last version (and not of the last
+    // sample) catches slow drifts as well
+    const qulonglong totalDelta = m_total > m_versionTotal ? m_total - m_versionTotal : m_versionTotal - m_total;
+    if ( totalDelta > m_versionTotal / 20 || qAbs( m_scale - m_versionScale ) >= 0.05 )
+    {
+        m_versionTotal = m_total;
+        m_versionScale = m_scale;
+        ++m_limitsVersion;
+    }
+
+    return m_limitsVersion;
+}
+
+void MemoryGovernor::detectCGroup()
+{
+    m_cgroupDetected = true;
+
+#if defined(Q_OS_LINUX)
+    QFile cgroupFile( "/proc/self/cgroup" );
+    if ( !cgroupFile.open( QIODevice::ReadOnly ) )
+        return;
+
+    // each line is "hierarchy-ID:controller-list:cgroup-path"; the unified
+    // (v2) hierarchy has ID 0 and an empty controller list
+    QString v1Path, v2Path;
+    QTextStream readStream( &cgroupFile );
+    while ( true )
+    {
+        const QString entry = readStream.readLine();
+        if ( entry.isNull() ) break;
+        const QString id = entry.section( ':', 0, 0 );
+        const QString controllers = entry.section( ':', 1, 1 );
+        const QString path = entry.section( ':', 2 );
+        if ( id == "0" && controllers.isEmpty() )
+            v2Path = path;
+        else if ( controllers.split( ',' ).contains( "memory" ) )
+            v1Path = path;
+    }
+
+    // in hybrid setups the memory controller can still be on v1
+    if ( !v1Path.isEmpty() && QFile::exists( "/sys/fs/cgroup/memory/memory.usage_in_bytes" ) )
+    {
+        m_cgroupVersion = CGroupV1;
+        m_cgroupRoot = "/sys/fs/cgroup/memory";
+        m_cgroupDir = m_cgroupRoot + v1Path;
+    }
+    else if ( !v2Path.isEmpty() && QFile::exists( "/sys/fs/cgroup/cgroup.controllers" ) )
+    {
+        m_cgroupVersion = CGroupV2;
+        m_cgroupRoot = "/sys/fs/cgroup";
+        m_cgroupDir = m_cgroupRoot + v2Path;
+    }
+
+    if ( m_cgroupVersion != NoCGroup )
+    {
+        m_cgroupDir = QDir::cleanPath( m_cgroupDir );
+        // inside a cgroup namespace (eg containers) the path of the cgroup
+        // is not visible, and its files are at the root of the mount
+        if ( !QFile::exists( m_cgroupDir ) )
+            m_cgroupDir = m_cgroupRoot;
+    }
+
+    if ( m_cgroupVersion == CGroupV2 && QFile::exists( m_cgroupDir + "/memory.pressure" ) )
+        m_pressureFile = m_cgroupDir + "/memory.pressure";
+    else if ( QFile::exists( "/proc/pressure/memory" ) )
+        m_pressureFile = "/proc/pressure/memory";
+
+    kDebug(OkularDebug) << "cgroup:" << m_cgroupVersion << m_cgroupDir << "pressure:" << m_pressureFile;
+#endif
+}
+
+void MemoryGovernor::sample()
+{
+    if ( !m_cgroupDetected )
+        detectCGroup();
+
+    if ( !m_physicalTotal )
+        m_physicalTotal = physicalTotalMemory();
+
+    m_total = m_physicalTotal;
+    m_free = physicalFreeMemory();
+
+    if ( m_cgroupVersion != NoCGroup )
+    {
+        qulonglong limit = 0, usage = 0, reclaimable = 0;
+        readCGroupMemory( &limit, &usage, &reclaimable );
+        if ( limit > 0 && limit < m_total )
+        {
+            m_total = limit;
+            // like for the system memory, consider the inactive page cache
+            // of the cgroup as free memory
+            qulonglong headroom = limit > usage ? limit - usage : 0;
+            headroom = qMin( limit, headroom + reclaimable );
+            m_free = qMin( m_free, headroom );
+        }
+    }
+
+    // shrink linearly the budgets from no pressure (stalls <= 1% of the
+    // time) down to a quarter of them at heavy pressure (stalls >= 25%)
+    const double pressure = readPressure();
+    m_scale = 1.0 - 0.75 * qBound( 0.0, ( pressure - 1.0 ) / 24.0, 1.0 );
+
+    m_lastSample.start();
+    m_sampled = true;
+}
+
+qulonglong MemoryGovernor::physicalTotalMemory() const
+{
+#if defined(Q_OS_LINUX)
+    // if /proc/meminfo doesn't exist, return 128MB
+    QFile memFile( "/proc/meminfo" );
+    if ( !memFile.open( QIODevice::ReadOnly ) )
+        return 134217728;
+
+    QTextStream readStream( &memFile );
+    while ( true )
+    {
+        QString entry = readStream.readLine();
+        if ( entry.isNull() ) break;
+        if ( entry.startsWith( "MemTotal:" ) )
+            return Q_UINT64_C(1024) * entry.section( ' ', -2, -2 ).toULongLong();
+    }
+#elif defined(Q_OS_FREEBSD)
+    qulonglong physmem;
+    int mib[] = {CTL_HW, HW_PHYSMEM};
+    size_t len = sizeof( physmem );
+    if ( sysctl( mib, 2, &physmem, &len, NULL, 0 ) == 0 )
+        return physmem;
+#elif defined(Q_OS_WIN)
+    MEMORYSTATUSEX stat;
+    stat.dwLength = sizeof(stat);
+    GlobalMemoryStatusEx (&stat);
+
+    return stat.ullTotalPhys;
+#endif
+    return 134217728;
+}
+
+qulonglong MemoryGovernor::physicalFreeMemory() const
+{
+#if defined(Q_OS_LINUX)
+    // if /proc/meminfo doesn't exist, return MEMORY FULL
+    QFile memFile( "/proc/meminfo" );
+    if ( !memFile.open( QIODevice::ReadOnly ) )
+        return 0;
+
+    // read /proc/meminfo and sum up the contents of 'MemFree', 'Buffers'
+    // and 'Cached' fields. consider swapped memory as used memory.
+    qulonglong memoryFree = 0;
+    QString entry;
+    QTextStream readStream( &memFile );
+    while ( true )
+    {
+        entry = readStream.readLine();
+        if ( entry.isNull() ) break;
+        if ( entry.startsWith( "MemFree:" ) ||
+                entry.startsWith( "Buffers:" ) ||
+                entry.startsWith( "Cached:" ) ||
+                entry.startsWith( "SwapFree:" ) )
+            memoryFree += entry.section( ' ', -2, -2 ).toULongLong();
+        if ( entry.startsWith( "SwapTotal:" ) )
+            memoryFree -= entry.section( ' ', -2, -2 ).toULongLong();
+    }
+    memFile.close();
+
+    return Q_UINT64_C(1024) * memoryFree;
+#elif defined(Q_OS_FREEBSD)
+    qulonglong cache, inact, free, psize;
+    size_t cachelen, inactlen, freelen, psizelen;
+    cachelen = sizeof( cache );
+    inactlen = sizeof( inact );
+    freelen = sizeof( free );
+    psizelen = sizeof( psize );
+    // sum up inactive, cached and free memory
+    if ( sysctlbyname( "vm.stats.vm.v_cache_count", &cache, &cachelen, NULL, 0 ) == 0 &&
+            sysctlbyname( "vm.stats.vm.v_inactive_count", &inact, &inactlen, NULL, 0 ) == 0 &&
+            sysctlbyname( "vm.stats.vm.v_free_count", &free, &freelen, NULL, 0 ) == 0 &&
+            sysctlbyname( "vm.stats.vm.v_page_size", &psize, &psizelen, NULL, 0 ) == 0 )
+    {
+        return (cache + inact + free) * psize;
+    }
+    else
+    {
+        return 0;
+    }
+#elif defined(Q_OS_WIN)
+    MEMORYSTATUSEX stat;
+    stat.dwLength = sizeof(stat);
+    GlobalMemoryStatusEx (&stat);
+
+    return stat.ullAvailPhys;
+#else
+    // tell the memory is full.. will act as in LOW profile
+    return 0;
+#endif
+}
+
+void MemoryGovernor::readCGroupMemory( qulonglong *limit, qulonglong *usage, qulonglong *reclaimable ) const
+{
+#if defined(Q_OS_LINUX)
+    const bool v2 = m_cgroupVersion == CGroupV2;
+    const QString limitName = v2 ? "/memory.max" : "/memory.limit_in_bytes";
+    const QString usageName = v2 ? "/memory.current" : "/memory.usage_in_bytes";
+    const QByteArray inactiveKey = v2 ? "inactive_file" : "total_inactive_file";
+
+    // the effective limit is the tightest one among the cgroup and its
+    // ancestors; the usage to compare with is the one of that cgroup
+    QString dir = m_cgroupDir;
+    while ( true )
+    {
+        const qulonglong dirLimit = readCGroupLimit( dir + limitName );
+        if ( dirLimit > 0 && ( *limit == 0 || dirLimit < *limit ) )
+        {
+            *limit = dirLimit;
+            *usage = readCGroupLimit( dir + usageName );
+            *reclaimable = readCGroupStat( dir + "/memory.stat", inactiveKey );
+        }
+
+        if ( dir.length() <= m_cgroupRoot.length() )
+            break;
+        dir = dir.left( dir.lastIndexOf( '/' ) );
+    }
+#else
+    Q_UNUSED( limit )
+    Q_UNUSED( usage )
+    Q_UNUSED( reclaimable )
+#endif
+}
+
+double MemoryGovernor::readPressure() const
+{
+#if defined(Q_OS_LINUX)
+    if ( m_pressureFile.isEmpty() )
+        return 0;
+
+    QFile pressureFile( m_pressureFile );
+    if ( !pressureFile.open( QIODevice::ReadOnly ) )
+        return 0;
+
+    // lines are like "some avg10=1.23 avg60=0.50 avg300=0.10 total=12345";
+    // a stall of all the tasks ("full") counts more than a partial one
+    double pressure = 0;
+    while ( !pressureFile.atEnd() )
+    {
+        const QList< QByteArray > fields = pressureFile.readLine().simplified().split( ' ' );
+        if ( fields.count() < 2 || !fields.at( 1 ).startsWith( "avg10=" ) )
+            continue;
+
+        const double avg10 = fields.at( 1 ).mid( 6 ).toDouble();
+        if ( fields.at( 0 ) == "some" )
+            pressure = qMax( pressure, avg10 );
+        else if ( fields.at( 0 ) == "full" )
+            pressure = qMax( pressure, 4 * avg10 );
+    }
+    return pressure;
+#else
+    return 0;
+#endif
+}
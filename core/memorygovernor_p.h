@@ -0,0 +1,103 @@
+/***************************************************************************
+ *   Copyright (C) 2004-2008 by Albert Astals Cid <aacid@kde.org>          *
+ *   Copyright (C) 2026 by the Okular developers <okular-devel@kde.org>    *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef _OKULAR_MEMORYGOVERNOR_P_H_
+#define _OKULAR_MEMORYGOVERNOR_P_H_
+
+#include <QtCore/QString>
+#include <QtCore/QTime>
+
+namespace Okular {
+
+/**
+ * The MemoryGovernor is the single place where the process asks the system
+ * how much memory it may use for caches (pixmaps, text pages).
+ *
+ * Besides the system wide numbers (/proc/meminfo, sysctl, ...) it honours
+ * the memory limit of the cgroup (v1 or v2) the process lives in, so that
+ * okular does not overshoot the limit of a container or of a systemd slice,
+ * and it reads the PSI memory pressure to shrink the caches when the
+ * system starts stalling on memory.
+ *
+ * The values are sampled at most once every couple of seconds; callers
+ * get the cached values in between.
+ */
+class MemoryGovernor
+{
+    public:
+        /**
+         * Constructor. No NOT use this, NEVER! Use the static self() instead.
+         */
+        MemoryGovernor();
+
+        static MemoryGovernor * self();
+
+        /**
+         * The total memory available to the process: the physical memory,
+         * clamped by the cgroup limit, if any.
+         */
+        qulonglong totalMemory();
+
+        /**
+         * The memory that can still be allocated by the process: the free
+         * system memory, clamped by the headroom left in the cgroup.
+         */
+        qulonglong freeMemory();
+
+        /**
+         * The factor (between 0.25 and 1.0) the cache budgets should be
+         * scaled with, according to the current memory pressure.
+         */
+        double budgetScale();
+
+        /**
+         * Samples again the memory state, if the last sample is too old.
+         */
+        void update();
+
+        /**
+         * A counter increased every time the limits change enough that the
+         * budgets based on them should be recalculated; the callers compare
+         * it with the value they saw the last time they computed a budget.
+         */
+        int limitsVersion();
+
+    private:
+        enum CGroupVersion { NoCGroup, CGroupV1, CGroupV2 };
+
+        void detectCGroup();
+        void sample();
+        qulonglong physicalTotalMemory() const;
+        qulonglong physicalFreeMemory() const;
+        void readCGroupMemory( qulonglong *limit, qulonglong *usage, qulonglong *reclaimable ) const;
+        double readPressure() const;
+
+        CGroupVersion m_cgroupVersion;
+        QString m_cgroupRoot;
+        QString m_cgroupDir;
+        QString m_pressureFile;
+        bool m_cgroupDetected;
+
+        QTime m_lastSample;
+        bool m_sampled;
+        qulonglong m_physicalTotal;
+        qulonglong m_total;
+        qulonglong m_free;
+        double m_scale;
+
+        // the values the budgets were last told to be computed with
+        int m_limitsVersion;
+        qulonglong m_versionTotal;
+        double m_versionScale;
+};
+
+}
+
+#endif
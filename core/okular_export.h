@@ -30,4 +30,13 @@
 #define OKULAR_EXPORT KDE_EXPORT
 #endif
 
+/* export the private classes the unit tests use */
+#ifndef OKULAR_TESTS_EXPORT
+# ifdef COMPILING_TESTS
+#  define OKULAR_TESTS_EXPORT OKULAR_EXPORT
+# else
+#  define OKULAR_TESTS_EXPORT
+# endif
+#endif
+
 #endif
@@ -396,6 +396,27 @@ void PagePrivate::changeSize( const PageSize &size )
         qSwap( m_width, m_height );
 }
 
+bool PagePrivate::resize( double width, double height, Rotation orientation )
+{
+    if ( width <= 0 )
+        width = 1;
+    if ( height <= 0 )
+        height = 1;
+    if ( m_rotation % 2 )
+        qSwap( width, height );
+
+    if ( width == m_width && height == m_height && orientation == m_orientation )
+        return false;
+
+    m_page->deletePixmaps();
+    deleteTextSelections();
+
+    m_width = width;
+    m_height = height;
+    m_orientation = orientation;
+    return true;
+}
+
 const ObjectRect * Page::objectRect( ObjectRect::ObjectType type, double x, double y, double xScale, double yScale ) const
 {
     QLinkedList< ObjectRect * >::const_iterator it = m_rects.begin(), end = m_rects.end();
@@ -81,6 +81,16 @@ class PagePrivate
          */
         void changeSize( const PageSize &size );
 
+        /**
+         * Changes the size and the orientation of the page, when the ones it
+         * was created with were only a guess.
+         *
+         * The @p width and @p height are meant like in the constructor of Page.
+         *
+         * @returns whether the size or the orientation changed
+         */
+        bool resize( double width, double height, Rotation orientation );
+
         /**
          * Sets the @p color and @p areas of text selections.
          */
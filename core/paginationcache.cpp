@@ -0,0 +1,154 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by the Okular developers <okular-devel@kde.org>    *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include "paginationcache.h"
+
+#include <QtCore/QDataStream>
+#include <QtCore/QDateTime>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+
+#include <kdebug.h>
+#include <ksavefile.h>
+#include <kstandarddirs.h>
+
+#include "debug_p.h"
+
+using namespace Okular;
+
+// "OKPC", followed by the version of the format
+static const quint32 s_magic = 0x4f4b5043;
+static const quint32 s_version = 1;
+
+class PaginationCache::Private
+{
+    public:
+        Private()
+            : valid( false ), fileSize( 0 )
+        {
+        }
+
+        bool load();
+
+        QString cacheFileName;
+        QString settingsKey;
+        bool valid;
+        qint64 fileSize;
+        QDateTime lastModified;
+        QVector< QSize > pageSizes;
+        QMap< QString, QString > values;
+};
+
+bool PaginationCache::Private::load()
+{
+    QFile file( cacheFileName );
+    if ( !file.open( QIODevice::ReadOnly ) )
+        return false;
+
+    QDataStream stream( &file );
+    stream.setVersion( QDataStream::Qt_4_4 );
+
+    quint32 magic = 0, version = 0;
+    stream >> magic >> version;
+    if ( magic != s_magic || version != s_version )
+        return false;
+
+    qint64 storedSize = 0;
+    QDateTime storedModified;
+    QString storedKey;
+    stream >> storedSize >> storedModified >> storedKey;
+    if ( stream.status() != QDataStream::Ok || storedSize != fileSize
+         || storedModified != lastModified || storedKey != settingsKey )
+        return false;
+
+    QVector< QSize > sizes;
+    QMap< QString, QString > storedValues;
+    stream >> sizes >> storedValues;
+    if ( stream.status() != QDataStream::Ok || sizes.isEmpty() )
+        return false;
+
+    pageSizes = sizes;
+    values = storedValues;
+    return true;
+}
+
+
+PaginationCache::PaginationCache( const QString &fileName, const QString &settingsKey )
+    : d( new Private )
+{
+    const QFileInfo info( fileName );
+    if ( !info.isFile() )
+        return;
+
+    d->fileSize = info.size();
+    d->lastModified = info.lastModified();
+    d->settingsKey = settingsKey;
+    // named like the docdata of the document, see Document::openDocument()
+    d->cacheFileName = KStandardDirs::locateLocal( "data", "okular/docdata/" + QString::number( d->fileSize ) + '.' + info.fileName() + ".pages" );
+    d->valid = d->load();
+}
+
+PaginationCache::~PaginationCache()
+{
+    delete d;
+}
+
+bool PaginationCache::isValid() const
+{
+    return d->valid;
+}
+
+QVector< QSize > PaginationCache::pageSizes() const
+{
+    return d->pageSizes;
+}
+
+QString PaginationCache::value( const QString &name ) const
+{
+    return d->values.value( name );
+}
+
+void PaginationCache::setPageSizes( const QVector< QSize > &sizes )
+{
+    d->pageSizes = sizes;
+}
+
+void PaginationCache::setValue( const QString &name, const QString &value )
+{
+    d->values.insert( name, value );
+}
+
+bool PaginationCache::store()
+{
+    if ( d->cacheFileName.isEmpty() || d->pageSizes.isEmpty() )
+        return false;
+
+    KSaveFile file( d->cacheFileName );
+    if ( !file.open() )
+    {
+        kWarning(OkularDebug) << "Cannot write the pagination cache" << d->cacheFileName;
+        return false;
+    }
+
+    QDataStream stream( &file );
+    stream.setVersion( QDataStream::Qt_4_4 );
+    stream << s_magic << s_version
+           << d->fileSize << d->lastModified << d->settingsKey
+           << d->pageSizes << d->values;
+
+    d->valid = file.finalize();
+    return d->valid;
+}
+
+void PaginationCache::discard()
+{
+    if ( !d->cacheFileName.isEmpty() )
+        QFile::remove( d->cacheFileName );
+    d->valid = false;
+}
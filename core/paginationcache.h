@@ -0,0 +1,91 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by the Okular developers <okular-devel@kde.org>    *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef _OKULAR_PAGINATIONCACHE_H_
+#define _OKULAR_PAGINATIONCACHE_H_
+
+#include "okular_export.h"
+
+#include <QtCore/QMap>
+#include <QtCore/QSize>
+#include <QtCore/QString>
+#include <QtCore/QVector>
+
+namespace Okular {
+
+/**
+ * @short Persistent cache of the page sizes of a document.
+ *
+ * The generators of reflowable formats need to lay out the whole document
+ * to know how many pages it has and how big they are; this cache stores the
+ * result of that layout in the okular data directory, next to the docdata
+ * of the document, so the next time the document is opened its pages can be
+ * shown before the layout is done again.
+ *
+ * The cache is valid only if the size and the modification time of the
+ * file, and the settings key given by the generator (which must describe
+ * everything that influences the layout, like the fonts and the page size),
+ * are the same as when it was stored.
+ */
+class OKULAR_EXPORT PaginationCache
+{
+    public:
+        /**
+         * Creates a cache for the document @p fileName laid out with the
+         * settings described by @p settingsKey, and reads it from the disk.
+         */
+        PaginationCache( const QString &fileName, const QString &settingsKey );
+        ~PaginationCache();
+
+        /**
+         * Returns whether a cache matching the document and the settings
+         * was found.
+         */
+        bool isValid() const;
+
+        /**
+         * Returns the sizes of the pages of the document.
+         */
+        QVector< QSize > pageSizes() const;
+
+        /**
+         * Returns the additional data stored with the @p name, if any.
+         */
+        QString value( const QString &name ) const;
+
+        /**
+         * Sets the sizes of the pages of the document.
+         */
+        void setPageSizes( const QVector< QSize > &sizes );
+
+        /**
+         * Sets additional data to store with the @p name.
+         */
+        void setValue( const QString &name, const QString &value );
+
+        /**
+         * Writes the cache to the disk.
+         */
+        bool store();
+
+        /**
+         * Removes the cache from the disk, and invalidates it.
+         */
+        void discard();
+
+    private:
+        class Private;
+        Private * const d;
+
+        Q_DISABLE_COPY( PaginationCache )
+};
+
+}
+
+#endif
@@ -0,0 +1,232 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by the Okular developers <okular-devel@kde.org>    *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include "renderstatistics.h"
+#include "renderstatistics_p.h"
+
+using namespace Okular;
+
+// upper limits of the latency buckets, in milliseconds
+static const int s_latencyBuckets[] = { 1, 2, 5, 10, 20, 50, 100, 200, 500, 1000, 2000, 5000 };
+static const int s_latencyBucketCount = sizeof( s_latencyBuckets ) / sizeof( s_latencyBuckets[0] );
+
+static int latencyBucket( int msecs )
+{
+    int i = 0;
+    while ( i < s_latencyBucketCount && msecs > s_latencyBuckets[i] )
+        ++i;
+    return i;
+}
+
+class Okular::RenderStatisticsPrivate
+    : public QSharedData
+{
+    public:
+        struct Timing
+        {
+            Timing()
+              : histogram( s_latencyBucketCount + 1, 0 ), count( 0 ), total( 0 ), maximum( 0 )
+            {
+            }
+
+            void add( int msecs )
+            {
+                msecs = qMax( 0, msecs );
+                ++histogram[ latencyBucket( msecs ) ];
+                ++count;
+                total += msecs;
+                maximum = qMax( maximum, msecs );
+            }
+
+            QVector< qulonglong > histogram;
+            qulonglong count;
+            qulonglong total;
+            int maximum;
+        };
+
+        RenderStatisticsPrivate()
+          : bytesAllocated( 0 ), bytesEvicted( 0 ), bytesInUse( 0 ),
+            queuedRequests( 0 ), executingRequests( 0 )
+        {
+            for ( int i = 0; i < CounterCount; ++i )
+                counters[i] = 0;
+        }
+
+        enum { CounterCount = RenderStatistics::TextPagesEvicted + 1 };
+
+        QString generatorName;
+        Timing timings[2];
+        qulonglong counters[CounterCount];
+        qulonglong bytesAllocated;
+        qulonglong bytesEvicted;
+        qulonglong bytesInUse;
+        int queuedRequests;
+        int executingRequests;
+};
+
+
+RenderStatistics::RenderStatistics()
+    : d( new RenderStatisticsPrivate )
+{
+}
+
+RenderStatistics::RenderStatistics( const RenderStatistics &other )
+    : d( other.d )
+{
+}
+
+RenderStatistics::~RenderStatistics()
+{
+}
+
+RenderStatistics& RenderStatistics::operator=( const RenderStatistics &other )
+{
+    if ( this != &other )
+        d = other.d;
+
+    return *this;
+}
+
+QList< int > RenderStatistics::latencyBuckets()
+{
+    QList< int > buckets;
+    for ( int i = 0; i < s_latencyBucketCount; ++i )
+        buckets.append( s_latencyBuckets[i] );
+    return buckets;
+}
+
+QString RenderStatistics::generatorName() const
+{
+    return d->generatorName;
+}
+
+QVector< qulonglong > RenderStatistics::latencyHistogram( Operation operation ) const
+{
+    return d->timings[ operation ].histogram;
+}
+
+qulonglong RenderStatistics::operationCount( Operation operation ) const
+{
+    return d->timings[ operation ].count;
+}
+
+double RenderStatistics::averageLatency( Operation operation ) const
+{
+    const RenderStatisticsPrivate::Timing &timing = d->timings[ operation ];
+    return timing.count ? double( timing.total ) / timing.count : 0.0;
+}
+
+int RenderStatistics::maximumLatency( Operation operation ) const
+{
+    return d->timings[ operation ].maximum;
+}
+
+qulonglong RenderStatistics::counter( Counter counter ) const
+{
+    return d->counters[ counter ];
+}
+
+qulonglong RenderStatistics::bytesAllocated() const
+{
+    return d->bytesAllocated;
+}
+
+qulonglong RenderStatistics::bytesEvicted() const
+{
+    return d->bytesEvicted;
+}
+
+qulonglong RenderStatistics::bytesInUse() const
+{
+    return d->bytesInUse;
+}
+
+int RenderStatistics::queuedRequests() const
+{
+    return d->queuedRequests;
+}
+
+int RenderStatistics::executingRequests() const
+{
+    return d->executingRequests;
+}
+
+
+void RenderStatisticsCollector::setGenerator( const QString &name )
+{
+    m_generator = name;
+}
+
+RenderStatisticsPrivate * RenderStatisticsCollector::current()
+{
+    QHash< QString, RenderStatistics >::iterator it = m_statistics.find( m_generator );
+    if ( it == m_statistics.end() )
+    {
+        it = m_statistics.insert( m_generator, RenderStatistics() );
+        it.value().d->generatorName = m_generator;
+    }
+    // non-const access detaches, so snapshots already given away stay intact
+    return it.value().d.data();
+}
+
+void RenderStatisticsCollector::pixmapRequestSent()
+{
+    ++current()->counters[ RenderStatistics::PixmapRequests ];
+}
+
+void RenderStatisticsCollector::pixmapRequestDone( int msecs, qulonglong bytes )
+{
+    RenderStatisticsPrivate *stats = current();
+    stats->timings[ RenderStatistics::PixmapRendering ].add( msecs );
+    stats->bytesAllocated += bytes;
+}
+
+void RenderStatisticsCollector::pixmapCacheHit()
+{
+    ++current()->counters[ RenderStatistics::PixmapCacheHits ];
+}
+
+void RenderStatisticsCollector::pixmapRequestTooLarge()
+{
+    ++current()->counters[ RenderStatistics::PixmapRequestsTooLarge ];
+}
+
+void RenderStatisticsCollector::pixmapEvicted( qulonglong bytes )
+{
+    RenderStatisticsPrivate *stats = current();
+    ++stats->counters[ RenderStatistics::PixmapsEvicted ];
+    stats->bytesEvicted += bytes;
+}
+
+void RenderStatisticsCollector::textPageGenerated( int msecs )
+{
+    RenderStatisticsPrivate *stats = current();
+    stats->timings[ RenderStatistics::TextExtraction ].add( msecs );
+    ++stats->counters[ RenderStatistics::TextPagesGenerated ];
+}
+
+void RenderStatisticsCollector::textPageEvicted()
+{
+    ++current()->counters[ RenderStatistics::TextPagesEvicted ];
+}
+
+RenderStatistics RenderStatisticsCollector::statistics( qulonglong bytesInUse, int queuedRequests, int executingRequests ) const
+{
+    RenderStatistics stats = m_statistics.value( m_generator );
+    stats.d->generatorName = m_generator;
+    stats.d->bytesInUse = bytesInUse;
+    stats.d->queuedRequests = queuedRequests;
+    stats.d->executingRequests = executingRequests;
+    return stats;
+}
+
+void RenderStatisticsCollector::reset()
+{
+    m_statistics.clear();
+}
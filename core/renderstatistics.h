@@ -0,0 +1,152 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by the Okular developers <okular-devel@kde.org>    *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef _OKULAR_RENDERSTATISTICS_H_
+#define _OKULAR_RENDERSTATISTICS_H_
+
+#include <QtCore/QList>
+#include <QtCore/QSharedDataPointer>
+#include <QtCore/QString>
+#include <QtCore/QVector>
+
+#include "okular_export.h"
+
+namespace Okular {
+
+class RenderStatisticsCollector;
+class RenderStatisticsPrivate;
+
+/**
+ * @short A snapshot of the rendering statistics of a document.
+ *
+ * The statistics are collected for each generator used by a Document,
+ * and describe how the pixmap requests, the text extraction and the
+ * memory eviction performed since the generator was first used (or since
+ * the last Document::resetRenderStatistics()).
+ *
+ * The latencies are collected in histograms, whose buckets are described
+ * by latencyBuckets().
+ *
+ * @since 0.15 (KDE 4.9)
+ */
+class OKULAR_EXPORT RenderStatistics
+{
+    public:
+        /**
+         * The kind of timed operations.
+         */
+        enum Operation
+        {
+            PixmapRendering,    ///< The generation of a pixmap for a page
+            TextExtraction      ///< The generation of the text page of a page
+        };
+
+        /**
+         * The counted events.
+         */
+        enum Counter
+        {
+            PixmapRequests,         ///< Pixmap requests sent to the generator
+            PixmapCacheHits,        ///< Pixmap requests dropped because the pixmap was already available
+            PixmapRequestsTooLarge, ///< Pixmap requests dropped because too large
+            PixmapsEvicted,         ///< Pixmaps freed to keep the memory within the budget
+            TextPagesGenerated,     ///< Text pages generated
+            TextPagesEvicted        ///< Text pages freed to keep the cache within the budget
+        };
+
+        /**
+         * Construct empty statistics.
+         */
+        RenderStatistics();
+        /**
+         * Copy constructor.
+         */
+        RenderStatistics( const RenderStatistics &other );
+        /**
+         * Destructor.
+         */
+        ~RenderStatistics();
+
+        RenderStatistics& operator=( const RenderStatistics &other );
+
+        /**
+         * The upper limits (in milliseconds, inclusive) of the buckets of the
+         * latency histograms; the histograms have one more bucket for the
+         * latencies above the last limit.
+         */
+        static QList< int > latencyBuckets();
+
+        /**
+         * Returns the name of the generator the statistics are about.
+         */
+        QString generatorName() const;
+
+        /**
+         * Returns the histogram of the latencies of the @p operation.
+         */
+        QVector< qulonglong > latencyHistogram( Operation operation ) const;
+
+        /**
+         * Returns the number of timed @p operation's.
+         */
+        qulonglong operationCount( Operation operation ) const;
+
+        /**
+         * Returns the average latency of the @p operation, in milliseconds.
+         */
+        double averageLatency( Operation operation ) const;
+
+        /**
+         * Returns the highest latency of the @p operation, in milliseconds.
+         */
+        int maximumLatency( Operation operation ) const;
+
+        /**
+         * Returns the value of the @p counter.
+         */
+        qulonglong counter( Counter counter ) const;
+
+        /**
+         * Returns the amount of memory (in bytes) allocated for pixmaps.
+         */
+        qulonglong bytesAllocated() const;
+
+        /**
+         * Returns the amount of pixmap memory (in bytes) freed by the eviction.
+         */
+        qulonglong bytesEvicted() const;
+
+        /**
+         * Returns the amount of pixmap memory (in bytes) in use when the
+         * snapshot was taken.
+         */
+        qulonglong bytesInUse() const;
+
+        /**
+         * Returns the number of pixmap requests waiting to be sent to the
+         * generator when the snapshot was taken.
+         */
+        int queuedRequests() const;
+
+        /**
+         * Returns the number of pixmap requests being executed by the
+         * generator when the snapshot was taken.
+         */
+        int executingRequests() const;
+
+    private:
+        /// @cond PRIVATE
+        friend class RenderStatisticsCollector;
+        /// @endcond
+        QSharedDataPointer< RenderStatisticsPrivate > d;
+};
+
+}
+
+#endif
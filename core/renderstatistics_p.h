@@ -0,0 +1,54 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by the Okular developers <okular-devel@kde.org>    *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef _OKULAR_RENDERSTATISTICS_P_H_
+#define _OKULAR_RENDERSTATISTICS_P_H_
+
+#include "renderstatistics.h"
+
+#include <QtCore/QHash>
+
+namespace Okular {
+
+/**
+ * Collects the rendering statistics of a Document, one set for each
+ * generator it uses.
+ *
+ * All the methods are meant to be called from the GUI thread only, as
+ * all the rendering, text and eviction paths report to the Document there.
+ */
+class RenderStatisticsCollector
+{
+    public:
+        /**
+         * Sets the generator the next events are accounted to.
+         */
+        void setGenerator( const QString &name );
+
+        void pixmapRequestSent();
+        void pixmapRequestDone( int msecs, qulonglong bytes );
+        void pixmapCacheHit();
+        void pixmapRequestTooLarge();
+        void pixmapEvicted( qulonglong bytes );
+        void textPageGenerated( int msecs );
+        void textPageEvicted();
+
+        RenderStatistics statistics( qulonglong bytesInUse, int queuedRequests, int executingRequests ) const;
+        void reset();
+
+    private:
+        RenderStatisticsPrivate * current();
+
+        QHash< QString, RenderStatistics > m_statistics;
+        QString m_generator;
+};
+
+}
+
+#endif
@@ -15,6 +15,9 @@
 #include <kjs/kjsprototype.h>
 #include <kjs/kjsarguments.h>
 
+#include <qhash.h>
+#include <qregexp.h>
+
 #include <kdebug.h>
 
 #include "../debug_p.h"
@@ -47,10 +50,14 @@ class Okular::ExecutorKJSPrivate
         }
 
         void initTypes();
+        void reportResult( const KJSResult &result );
 
         DocumentPrivate *m_doc;
         KJSInterpreter *m_interpreter;
         KJSGlobalObject m_docObject;
+        // the name of the global function compiled for each script, or an
+        // empty name if the script has syntax errors
+        QHash< QString, QString > m_compiledScripts;
 };
 
 void ExecutorKJSPrivate::initTypes()
@@ -76,6 +83,19 @@ void ExecutorKJSPrivate::initTypes()
     m_docObject.setProperty( ctx, "util", JSUtil::object( ctx ) );
 }
 
+void ExecutorKJSPrivate::reportResult( const KJSResult &result )
+{
+    KJSContext* ctx = m_interpreter->globalContext();
+    if ( result.isException() || ctx->hasException() )
+    {
+        kDebug(OkularDebug) << "JS exception" << result.errorMessage();
+    }
+    else
+    {
+        kDebug(OkularDebug) << "result:" << result.value().toString( ctx );
+    }
+}
+
 ExecutorKJS::ExecutorKJS( DocumentPrivate *doc )
     : d( new ExecutorKJSPrivate( doc ) )
 {
@@ -101,13 +121,52 @@ void ExecutorKJS::execute( const QString &script )
 
     KJSResult result = d->m_interpreter->evaluate( "okular.js", 1,
                                                    script, &d->m_docObject );
-    KJSContext* ctx = d->m_interpreter->globalContext();
-    if ( result.isException() || ctx->hasException() )
-    {
-        kDebug(OkularDebug) << "JS exception" << result.errorMessage();
-    }
-    else
+    d->reportResult( result );
+}
+
+// Whether running @p script as the body of a function behaves as running it
+// as program code: it must not declare variables, constants or functions, as
+// they would become local to the function instead of global, nor use eval or
+// the arguments object, nor return, a syntax error at the top level of
+// program code. The check is on the raw text, so a match in a string or in a
+// comment only costs the compilation.
+static bool canCompileAsFunction( const QString &script )
+{
+    static const QRegExp declarations( "\\b(var|const|function|arguments|eval|return)\\b" );
+    return !script.contains( declarations );
+}
+
+void ExecutorKJS::executeCompiled( const QString &script )
+{
+    QHash< QString, QString >::const_iterator it = d->m_compiledScripts.constFind( script );
+    if ( it == d->m_compiledScripts.constEnd() )
     {
-        kDebug(OkularDebug) << "result:" << result.value().toString( ctx );
+        if ( !canCompileAsFunction( script ) )
+        {
+            execute( script );
+            return;
+        }
+
+        // the keystroke, format and validate scripts of the forms run at
+        // each change of the fields: parse them once, as functions kept in
+        // the global object (so the garbage collector does not free them)
+        QString name = QString( "__okular_script_%1" ).arg( d->m_compiledScripts.count() );
+        KJSResult result = d->m_interpreter->evaluate( "okular.js", 0,
+                                                       name + " = function() {\n" + script + "\n};",
+                                                       &d->m_docObject );
+        if ( result.isException() || d->m_interpreter->globalContext()->hasException() )
+        {
+            kDebug(OkularDebug) << "JS compilation exception" << result.errorMessage();
+            name.clear();
+        }
+        it = d->m_compiledScripts.insert( script, name );
     }
+
+    // do not try again the scripts with syntax errors
+    if ( it.value().isEmpty() )
+        return;
+
+    KJSResult result = d->m_interpreter->evaluate( "okular.js", 1,
+                                                   it.value() + ".call(this);", &d->m_docObject );
+    d->reportResult( result );
 }
@@ -24,6 +24,12 @@ class ExecutorKJS
         ~ExecutorKJS();
 
         void execute( const QString &script );
+        /**
+         * Executes @p script, compiled as the body of a function only the
+         * first time the same script is executed; the scripts whose
+         * declarations would change scope that way are run as execute().
+         */
+        void executeCompiled( const QString &script );
 
     private:
         friend class ExecutorKJSPrivate;
@@ -12,6 +12,7 @@
 
 #include <qwidget.h>
 
+#include <kjs/kjsinterpreter.h>
 #include <kjs/kjsobject.h>
 #include <kjs/kjsprototype.h>
 #include <kjs/kjsarguments.h>
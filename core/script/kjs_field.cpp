@@ -215,9 +215,25 @@ void JSField::initType( KJSContext *ctx )
 
 KJSObject JSField::wrapField( KJSContext *ctx, FormField *field, Page *page )
 {
-    // ### cache unique wrapper
+    // the wrapper objects are created only when a field is asked for, and
+    // kept in a single object of the global one, so the garbage collector
+    // of the interpreter marks them
+    KJSObject globalObject = ctx->interpreter().globalObject();
+    KJSObject wrappers = globalObject.property( ctx, "__okular_fields" );
+    if ( wrappers.isUndefined() )
+    {
+        wrappers = KJSObject();
+        globalObject.setProperty( ctx, "__okular_fields", wrappers );
+    }
+
+    const QString key = QString::number( quintptr( field ) );
+    KJSObject cached = wrappers.property( ctx, key );
+    if ( !cached.isUndefined() )
+        return cached;
+
     KJSObject f = g_fieldProto->constructObject( ctx, field );
     f.setProperty( ctx, "page", page->number() );
+    wrappers.setProperty( ctx, key, f );
     return f;
 }
 
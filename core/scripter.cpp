@@ -64,3 +64,19 @@ QString Scripter::execute( ScriptType type, const QString &script )
     }
     return QString();
 }
+
+QString Scripter::executeAction( ScriptType type, const QString &script )
+{
+    kDebug(OkularDebug) << "executing the action script";
+    switch ( type )
+    {
+        case JavaScript:
+            if ( !d->m_kjs )
+            {
+                d->m_kjs = new ExecutorKJS( d->m_doc );
+            }
+            d->m_kjs->executeCompiled( script );
+            break;
+    }
+    return QString();
+}
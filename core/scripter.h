@@ -30,6 +30,7 @@ class Scripter
         ~Scripter();
 
         QString execute( ScriptType type, const QString &script );
+        QString executeAction( ScriptType type, const QString &script );
 
     private:
         friend class ScripterPrivate;
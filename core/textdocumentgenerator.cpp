@@ -10,28 +10,43 @@
 #include "textdocumentgenerator.h"
 #include "textdocumentgenerator_p.h"
 
+#include <QtCore/QBuffer>
 #include <QtCore/QFile>
 #include <QtCore/QMutex>
 #include <QtCore/QStack>
 #include <QtCore/QTextStream>
+#include <QtCore/QTimer>
 #include <QtCore/QVector>
+#include <QtCore/QXmlStreamReader>
+#include <QtGui/QApplication>
 #include <QtGui/QFontDatabase>
+#include <QtGui/QFontMetrics>
 #include <QtGui/QImage>
+#include <QtGui/QImageReader>
 #include <QtGui/QPainter>
 #include <QtGui/QPrinter>
 #if QT_VERSION >= 0x040500
 #include <QtGui/QTextDocumentWriter>
 #endif
+#include <QtXml/QDomElement>
+
+#include <kdebug.h>
+#include <klocale.h>
 
 #include "action.h"
 #include "annotations.h"
+#include "debug_p.h"
 #include "page.h"
+#include "paginationcache.h"
 #include "textpage.h"
 
 #include "document.h"
 
 using namespace Okular;
 
+// to be increased when the layout of the converted documents changes
+static const int s_paginationVersion = 1;
+
 /**
  * Generic Converter Implementation
  */
@@ -55,6 +70,113 @@ TextDocumentGenerator* TextDocumentConverter::generator() const
     return d_ptr->mParent ? d_ptr->mParent->q_func() : 0;
 }
 
+QDomElement TextDocumentConverter::readDomElement( QXmlStreamReader &reader, QDomDocument &document )
+{
+    QDomElement element = document.createElementNS( reader.namespaceUri().toString(), reader.qualifiedName().toString() );
+
+    const QXmlStreamAttributes attributes = reader.attributes();
+    for ( int i = 0; i < attributes.count(); ++i ) {
+        const QXmlStreamAttribute &attribute = attributes.at( i );
+        element.setAttributeNS( attribute.namespaceUri().toString(), attribute.qualifiedName().toString(), attribute.value().toString() );
+    }
+
+    while ( !reader.atEnd() ) {
+        reader.readNext();
+        if ( reader.isEndElement() )
+            break;
+
+        if ( reader.isStartElement() ) {
+            element.appendChild( readDomElement( reader, document ) );
+        } else if ( reader.isCharacters() ) {
+            element.appendChild( document.createTextNode( reader.text().toString() ) );
+        }
+    }
+
+    return element;
+}
+
+bool TextDocumentConverter::needsInteraction( const QString &fileName ) const
+{
+    Q_UNUSED( fileName );
+    return false;
+}
+
+/**
+ * Text Document With Lazily Decoded Images
+ */
+LazyImageTextDocument::LazyImageTextDocument( QObject *parent )
+    : QTextDocument( parent ), d( new LazyImageTextDocumentPrivate )
+{
+}
+
+LazyImageTextDocument::~LazyImageTextDocument()
+{
+    delete d;
+}
+
+QSize LazyImageTextDocument::imageSize( const QString &name ) const
+{
+    const QHash<QString, QSize>::const_iterator it = d->mImageSizes.constFind( name );
+    if ( it != d->mImageSizes.constEnd() )
+        return it.value();
+
+    QByteArray data = imageData( name );
+    QBuffer buffer( &data );
+    QImageReader reader( &buffer );
+    const QSize size = reader.size();
+    d->mImageSizes.insert( name, size );
+
+    return size;
+}
+
+void LazyImageTextDocument::setImageDisplaySize( const QString &name, const QSize &size )
+{
+    const QSize previous = d->mDisplaySizes.value( name );
+    if ( !previous.isValid() || size.width() > previous.width() )
+        d->mDisplaySizes.insert( name, size );
+}
+
+QString LazyImageTextDocument::imageName( const QUrl &url ) const
+{
+    return url.toString();
+}
+
+QVariant LazyImageTextDocument::loadResource( int type, const QUrl &url )
+{
+    if ( type != QTextDocument::ImageResource )
+        return QTextDocument::loadResource( type, url );
+
+    const QString name = imageName( url );
+
+    // the resolution the image is painted at, up to its own one
+    const QSize fullSize = imageSize( name );
+    QSize size = d->mDisplaySizes.value( name );
+    if ( size.isValid() )
+        size = QSize( qRound( size.width() * d->mRenderScale ), qRound( size.height() * d->mRenderScale ) );
+    if ( !size.isValid() || !fullSize.isValid() || size.width() >= fullSize.width() )
+        size = fullSize;
+
+    // the images are not added as resources, which would keep them at the
+    // resolution of the first painting
+    const QImage *cached = d->mImages.object( name );
+    if ( cached && ( !size.isValid() || cached->width() >= size.width() ) )
+        return *cached;
+
+    QByteArray data = imageData( name );
+    QBuffer buffer( &data );
+    QImageReader reader( &buffer );
+    if ( size.isValid() && size != fullSize )
+        reader.setScaledSize( size );
+
+    const QImage image = reader.read();
+    if ( image.isNull() )
+        return QVariant();
+
+    d->mImages.insert( name, new QImage( image ), image.byteCount() );
+
+    return image;
+}
+
 /**
  * Generic Generator Implementation
  */
@@ -137,11 +259,19 @@ void TextDocumentGeneratorPrivate::addTitle( int level, const QString &title, co
 
 void TextDocumentGeneratorPrivate::addMetaData( const QString &key, const QString &value, const QString &title )
 {
+    // a pending document has the information from the cache already, and
+    // it can be read meanwhile
+    if ( mConversionPending )
+        return;
+
     mDocumentInfo.set( key, value, title );
 }
 
 void TextDocumentGeneratorPrivate::addMetaData( DocumentInfo::Key key, const QString &value )
 {
+    if ( mConversionPending )
+        return;
+
     mDocumentInfo.set( key, value );
 }
 
@@ -226,16 +356,18 @@ TextDocumentGenerator::TextDocumentGenerator( TextDocumentConverter *converter,
         setFeature( Threaded );
 #endif
 
+    // direct connections: the converter can run in a thread, and its
+    // results are needed as soon as convert() returns
     connect( converter, SIGNAL(addAction(Action*,int,int)),
-             this, SLOT(addAction(Action*,int,int)) );
+             this, SLOT(addAction(Action*,int,int)), Qt::DirectConnection );
     connect( converter, SIGNAL(addAnnotation(Annotation*,int,int)),
-             this, SLOT(addAnnotation(Annotation*,int,int)) );
+             this, SLOT(addAnnotation(Annotation*,int,int)), Qt::DirectConnection );
     connect( converter, SIGNAL(addTitle(int,QString,QTextBlock)),
-             this, SLOT(addTitle(int,QString,QTextBlock)) );
+             this, SLOT(addTitle(int,QString,QTextBlock)), Qt::DirectConnection );
     connect( converter, SIGNAL(addMetaData(QString,QString,QString)),
-             this, SLOT(addMetaData(QString,QString,QString)) );
+             this, SLOT(addMetaData(QString,QString,QString)), Qt::DirectConnection );
     connect( converter, SIGNAL(addMetaData(DocumentInfo::Key,QString)),
-             this, SLOT(addMetaData(DocumentInfo::Key,QString)) );
+             this, SLOT(addMetaData(DocumentInfo::Key,QString)), Qt::DirectConnection );
 
     connect( converter, SIGNAL(error(QString,int)),
              this, SIGNAL(error(QString,int)) );
@@ -249,40 +381,45 @@ TextDocumentGenerator::~TextDocumentGenerator()
 {
 }
 
-bool TextDocumentGenerator::loadDocument( const QString & fileName, QVector<Okular::Page*> & pagesVector )
+bool TextDocumentGeneratorPrivate::convert( const QString &fileName, bool generateTitles )
 {
-    Q_D( TextDocumentGenerator );
-    d->mDocument = d->mConverter->convert( fileName );
+    mDocument = mConverter->convert( fileName );
 
-    if ( !d->mDocument )
+    if ( !mDocument )
     {
         // loading failed, cleanup all the stuff eventually gathered from the converter
-        d->mTitlePositions.clear();
-        Q_FOREACH ( const TextDocumentGeneratorPrivate::LinkPosition &linkPos, d->mLinkPositions )
+        mTitlePositions.clear();
+        Q_FOREACH ( const TextDocumentGeneratorPrivate::LinkPosition &linkPos, mLinkPositions )
         {
             delete linkPos.link;
         }
-        d->mLinkPositions.clear();
-        Q_FOREACH ( const TextDocumentGeneratorPrivate::AnnotationPosition &annPos, d->mAnnotationPositions )
+        mLinkPositions.clear();
+        Q_FOREACH ( const TextDocumentGeneratorPrivate::AnnotationPosition &annPos, mAnnotationPositions )
         {
             delete annPos.annotation;
         }
-        d->mAnnotationPositions.clear();
+        mAnnotationPositions.clear();
 
         return false;
     }
 
-    d->generateTitleInfos();
-    d->generateLinkInfos();
-    d->generateAnnotationInfos();
+    if ( generateTitles )
+        generateTitleInfos();
+    else
+        mTitlePositions.clear();
+    generateLinkInfos();
+    generateAnnotationInfos();
 
-    pagesVector.resize( d->mDocument->pageCount() );
+    return true;
+}
 
-    const QSize size = d->mDocument->pageSize().toSize();
+QList<int> TextDocumentGeneratorPrivate::addPageObjects( const QVector<Okular::Page*> &pages )
+{
+    const QSize size = mDocument->pageSize().toSize();
 
-    QVector< QLinkedList<Okular::ObjectRect*> > objects( d->mDocument->pageCount() );
-    for ( int i = 0; i < d->mLinkInfos.count(); ++i ) {
-        const TextDocumentGeneratorPrivate::LinkInfo &info = d->mLinkInfos.at( i );
+    QVector< QLinkedList<Okular::ObjectRect*> > objects( pages.count() );
+    for ( int i = 0; i < mLinkInfos.count(); ++i ) {
+        const TextDocumentGeneratorPrivate::LinkInfo &info = mLinkInfos.at( i );
 
         // in case that the converter report bogus link info data, do not assert here
         if ( info.page >= objects.count() )
@@ -293,18 +430,21 @@ bool TextDocumentGenerator::loadDocument( const QString & fileName, QVector<Okul
                                                              Okular::ObjectRect::Action, info.link ) );
     }
 
-    QVector< QLinkedList<Okular::Annotation*> > annots( d->mDocument->pageCount() );
-    for ( int i = 0; i < d->mAnnotationInfos.count(); ++i ) {
-        const TextDocumentGeneratorPrivate::AnnotationInfo &info = d->mAnnotationInfos[ i ];
+    QVector< QLinkedList<Okular::Annotation*> > annots( pages.count() );
+    for ( int i = 0; i < mAnnotationInfos.count(); ++i ) {
+        const TextDocumentGeneratorPrivate::AnnotationInfo &info = mAnnotationInfos[ i ];
+
+        if ( info.page >= annots.count() )
+          continue;
 
         QRect rect( 0, info.page * size.height(), size.width(), size.height() );
         info.annotation->setBoundingRectangle( Okular::NormalizedRect( rect.left(), rect.top(), rect.right(), rect.bottom() ) );
         annots[ info.page ].append( info.annotation );
     }
 
-    for ( int i = 0; i < d->mDocument->pageCount(); ++i ) {
-        Okular::Page * page = new Okular::Page( i, size.width(), size.height(), Okular::Rotation0 );
-        pagesVector[ i ] = page;
+    QList<int> changedPages;
+    for ( int i = 0; i < pages.count(); ++i ) {
+        Okular::Page * page = pages.at( i );
 
         if ( !objects.at( i ).isEmpty() ) {
             page->setObjectRects( objects.at( i ) );
@@ -313,17 +453,225 @@ bool TextDocumentGenerator::loadDocument( const QString & fileName, QVector<Okul
         for ( ; annIt != annEnd; ++annIt ) {
             page->addAnnotation( *annIt );
         }
+
+        if ( !objects.at( i ).isEmpty() || !annots.at( i ).isEmpty() )
+            changedPages.append( i );
+    }
+
+    return changedPages;
+}
+
+QString TextDocumentGeneratorPrivate::paginationSettingsKey() const
+{
+    // the converters lay the documents out with the default font, whose
+    // metrics depend on the resolution of the screen too
+    const QFont font = QApplication::font();
+    return QString( "%1;%2;%3;%4" ).arg( mConverter->metaObject()->className() )
+                                   .arg( s_paginationVersion )
+                                   .arg( font.toString() )
+                                   .arg( QFontMetrics( font ).height() );
+}
+
+bool TextDocumentGeneratorPrivate::restorePagination( const PaginationCache &cache, QVector<Okular::Page*> &pagesVector )
+{
+    const QVector<QSize> sizes = cache.pageSizes();
+
+    QDomDocument synopsis;
+    if ( !synopsis.setContent( cache.value( "synopsis" ) ) )
+        return false;
+    QDomDocument info;
+    if ( !info.setContent( cache.value( "info" ) ) )
+        return false;
+
+    // the top level items of the synopsis are wrapped in a single element
+    for ( QDomNode n = synopsis.documentElement().firstChild(); !n.isNull(); n = n.nextSibling() )
+        mDocumentSynopsis.appendChild( mDocumentSynopsis.importNode( n, true ) );
+    mDocumentInfo.setContent( cache.value( "info" ) );
+
+    pagesVector.resize( sizes.count() );
+    for ( int i = 0; i < sizes.count(); ++i )
+        pagesVector[ i ] = new Okular::Page( i, sizes.at( i ).width(), sizes.at( i ).height(), Okular::Rotation0 );
+
+    return true;
+}
+
+void TextDocumentGeneratorPrivate::storePagination( const QString &fileName )
+{
+    const QSize size = mDocument->pageSize().toSize();
+
+    QDomDocument synopsis;
+    QDomElement root = synopsis.createElement( "DocumentSynopsis" );
+    synopsis.appendChild( root );
+    for ( QDomNode n = mDocumentSynopsis.firstChild(); !n.isNull(); n = n.nextSibling() )
+        root.appendChild( synopsis.importNode( n, true ) );
+
+    PaginationCache cache( fileName, paginationSettingsKey() );
+    cache.setPageSizes( QVector<QSize>( mDocument->pageCount(), size ) );
+    cache.setValue( "synopsis", synopsis.toString( -1 ) );
+    cache.setValue( "info", mDocumentInfo.toString( -1 ) );
+    cache.store();
+}
+
+TextDocumentConversionThread::TextDocumentConversionThread( TextDocumentGeneratorPrivate *generator, const QString &fileName )
+    : QThread(), mGenerator( generator ), mFileName( fileName ), mSucceeded( false )
+{
+}
+
+bool TextDocumentConversionThread::succeeded() const
+{
+    return mSucceeded;
+}
+
+void TextDocumentConversionThread::run()
+{
+    // the synopsis comes from the cache already
+    mSucceeded = mGenerator->convert( mFileName, false );
+
+    // the document is used by the GUI thread from now on
+    if ( mGenerator->mDocument )
+        mGenerator->mDocument->moveToThread( QCoreApplication::instance()->thread() );
+}
+
+void TextDocumentGeneratorPrivate::convertPendingDocument()
+{
+    if ( !mConversionPending )
+        return;
+
+    if ( mConversionThread ) {
+        mConversionThread->wait();
+        conversionThreadFinished();
+        return;
+    }
+
+    // the synopsis comes from the cache already
+    finishPendingConversion( convert( mPendingFileName, false ) );
+}
+
+void TextDocumentGeneratorPrivate::conversionThreadFinished()
+{
+    // already handled by convertPendingDocument()
+    if ( !mConversionThread )
+        return;
+
+    const bool converted = mConversionThread->succeeded();
+    delete mConversionThread;
+    mConversionThread = 0;
+
+    finishPendingConversion( converted );
+}
+
+void TextDocumentGeneratorPrivate::finishPendingConversion( bool converted )
+{
+    Q_Q( TextDocumentGenerator );
+
+    mConversionPending = false;
+    const QString fileName = mPendingFileName;
+    const QVector<Okular::Page*> pages = mPendingPages;
+    mPendingFileName.clear();
+    mPendingPages.clear();
+
+    // the pages are already shown, so close the document: it is not
+    // blank pages the user wants to look at
+    if ( !converted ) {
+        PaginationCache( fileName, paginationSettingsKey() ).discard();
+        emit q->error( i18n( "Could not open the document." ), -1 );
+        q->requestClose();
+        return;
+    }
+
+    // pages cannot be added nor removed after the loading, so load the
+    // document again, with the pagination just stored
+    if ( mDocument->pageCount() != pages.count() ) {
+        kDebug(OkularDebug) << "The cached pagination of" << fileName << "has a different page count";
+        storePagination( fileName );
+        q->requestReload();
+        return;
+    }
+
+    // the observers got the pages without their links and annotations
+    const QList<int> changedPages = addPageObjects( pages );
+    foreach ( int page, changedPages )
+        q->updatePageObjects( page );
+
+    // lay out again the pages whose size changed since the cache was stored
+    const QSize size = mDocument->pageSize().toSize();
+    bool matches = true;
+    for ( int i = 0; i < pages.count(); ++i ) {
+        if ( qRound( pages.at( i )->width() ) != size.width() || qRound( pages.at( i )->height() ) != size.height() ) {
+            q->updatePageSize( i, size.width(), size.height(), Okular::Rotation0 );
+            matches = false;
+        }
     }
 
+    if ( !matches ) {
+        kDebug(OkularDebug) << "The cached pagination of" << fileName << "is out of date";
+        storePagination( fileName );
+    }
+}
+
+void TextDocumentGeneratorPrivate::ensureConverted()
+{
+    if ( mConversionPending )
+        convertPendingDocument();
+}
+
+bool TextDocumentGenerator::loadDocument( const QString & fileName, QVector<Okular::Page*> & pagesVector )
+{
+    Q_D( TextDocumentGenerator );
+
+    // a document laid out in a previous session gets its pages from the
+    // pagination cache at once, and it is converted in a thread, or once
+    // the event loop had the chance to show them if the fonts cannot be
+    // used outside the GUI thread or the converter may ask the user
+    // something; the pixmap requests wait for it
+    const PaginationCache cache( fileName, d->paginationSettingsKey() );
+    if ( cache.isValid() && d->restorePagination( cache, pagesVector ) ) {
+        d->mConversionPending = true;
+        d->mPendingFileName = fileName;
+        d->mPendingPages = pagesVector;
+        bool interactive = false;
+        QMetaObject::invokeMethod( d->mConverter, "needsInteraction", Qt::DirectConnection, Q_RETURN_ARG(bool, interactive), Q_ARG(QString, fileName) );
+        if ( !interactive && QFontDatabase::supportsThreadedFontRendering() ) {
+            d->mConversionThread = new TextDocumentConversionThread( d, fileName );
+            connect( d->mConversionThread, SIGNAL(finished()), this, SLOT(conversionThreadFinished()), Qt::QueuedConnection );
+            d->mConversionThread->start();
+        } else {
+            QTimer::singleShot( 0, this, SLOT(convertPendingDocument()) );
+        }
+        return true;
+    }
+
+    if ( !d->convert( fileName, true ) )
+        return false;
+
+    const QSize size = d->mDocument->pageSize().toSize();
+
+    pagesVector.resize( d->mDocument->pageCount() );
+    for ( int i = 0; i < d->mDocument->pageCount(); ++i )
+        pagesVector[ i ] = new Okular::Page( i, size.width(), size.height(), Okular::Rotation0 );
+
+    d->addPageObjects( pagesVector );
+    d->storePagination( fileName );
+
     return true;
 }
 
 bool TextDocumentGenerator::doCloseDocument()
 {
     Q_D( TextDocumentGenerator );
+    if ( d->mConversionThread ) {
+        d->mConversionThread->wait();
+        delete d->mConversionThread;
+        d->mConversionThread = 0;
+    }
+
     delete d->mDocument;
     d->mDocument = 0;
 
+    d->mConversionPending = false;
+    d->mPendingFileName.clear();
+    d->mPendingPages.clear();
+
     d->mTitlePositions.clear();
     d->mLinkPositions.clear();
     d->mLinkInfos.clear();
@@ -338,6 +686,10 @@ bool TextDocumentGenerator::doCloseDocument()
 
 bool TextDocumentGenerator::canGeneratePixmap() const
 {
+    Q_D( const TextDocumentGenerator );
+    if ( d->mConversionPending )
+        return false;
+
     return Generator::canGeneratePixmap();
 }
 
@@ -374,6 +726,8 @@ QImage TextDocumentGeneratorPrivate::image( PixmapRequest * request )
 #ifdef OKULAR_TEXTDOCUMENT_THREADED_RENDERING
     q->userMutex()->lock();
 #endif
+    if ( LazyImageTextDocument *document = qobject_cast<LazyImageTextDocument*>( mDocument ) )
+        document->d->mRenderScale = width / (qreal)size.width();
     mDocument->drawContents( &p, rect );
 #ifdef OKULAR_TEXTDOCUMENT_THREADED_RENDERING
     q->userMutex()->unlock();
@@ -386,12 +740,17 @@ QImage TextDocumentGeneratorPrivate::image( PixmapRequest * request )
 Okular::TextPage* TextDocumentGenerator::textPage( Okular::Page * page )
 {
     Q_D( TextDocumentGenerator );
+    d->ensureConverted();
+    if ( !d->mDocument )
+        return new Okular::TextPage;
+
     return d->createTextPage( page->number() );
 }
 
 bool TextDocumentGenerator::print( QPrinter& printer )
 {
     Q_D( TextDocumentGenerator );
+    d->ensureConverted();
     if ( !d->mDocument )
         return false;
 
@@ -447,6 +806,7 @@ Okular::ExportFormat::List TextDocumentGenerator::exportFormats(   ) const
 bool TextDocumentGenerator::exportTo( const QString &fileName, const Okular::ExportFormat &format )
 {
     Q_D( TextDocumentGenerator );
+    d->ensureConverted();
     if ( !d->mDocument )
         return false;
 
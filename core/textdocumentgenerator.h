@@ -15,11 +15,16 @@
 #include "document.h"
 #include "generator.h"
 
+#include <QtGui/QTextDocument>
+
+class QDomDocument;
+class QDomElement;
 class QTextBlock;
-class QTextDocument;
+class QXmlStreamReader;
 
 namespace Okular {
 
+class LazyImageTextDocumentPrivate;
 class TextDocumentConverterPrivate;
 class TextDocumentGenerator;
 class TextDocumentGeneratorPrivate;
@@ -44,6 +49,10 @@ class OKULAR_EXPORT TextDocumentConverter : public QObject
 
         /**
          * Returns the generated QTextDocument object.
+         *
+         * @note When the pages of the document come from a previous session,
+         *       this method can be called in a thread other than the GUI
+         *       one, unless needsInteraction() returns true for @p fileName.
          */
         virtual QTextDocument *convert( const QString &fileName ) = 0;
 
@@ -119,12 +128,105 @@ class OKULAR_EXPORT TextDocumentConverter : public QObject
          */
         TextDocumentGenerator* generator() const;
 
+        /**
+         * Reads the current element of the @p reader, and all its children,
+         * into a DOM element of the @p document, for a converter which reads
+         * its document with a QXmlStreamReader and converts parts of it from
+         * a DOM.
+         *
+         * The whitespace-only text is kept, as it is in the text of the
+         * elements.
+         *
+         * @since 0.15 (KDE 4.9)
+         */
+        static QDomElement readDomElement( QXmlStreamReader &reader, QDomDocument &document );
+
+    protected Q_SLOTS:
+        /**
+         * Returns whether the conversion of @p fileName may ask the user
+         * something, like a password; such a conversion is always done in
+         * the GUI thread. The default implementation returns false.
+         *
+         * A converter reimplements it by declaring a slot with the same
+         * signature.
+         *
+         * @since 0.15 (KDE 4.9)
+         */
+        bool needsInteraction( const QString &fileName ) const;
+
     private:
         TextDocumentConverterPrivate *d_ptr;
         Q_DECLARE_PRIVATE( TextDocumentConverter )
         Q_DISABLE_COPY( TextDocumentConverter )
 };
 
+/**
+ * @brief A QTextDocument which decodes its images when they are painted
+ *
+ * The images are read through imageData() and decoded at the resolution
+ * they are painted at: the size set with setImageDisplaySize(), scaled
+ * like the page being rendered, and never more than their own size.
+ * A converter can lay them out with imageSize() without decoding them.
+ *
+ * @since 0.15 (KDE 4.9)
+ */
+class OKULAR_EXPORT LazyImageTextDocument : public QTextDocument
+{
+    /// @cond PRIVATE
+    friend class TextDocumentGeneratorPrivate;
+    /// @endcond
+
+    Q_OBJECT
+
+    public:
+        /**
+         * Creates a new text document.
+         */
+        explicit LazyImageTextDocument( QObject *parent = 0 );
+
+        /**
+         * Destroys the text document.
+         */
+        virtual ~LazyImageTextDocument();
+
+        /**
+         * Returns the size of the image with the given @p name, read from
+         * its header without decoding it, or an invalid size if there is no
+         * such image.
+         */
+        QSize imageSize( const QString &name ) const;
+
+        /**
+         * Sets the @p size the image with the given @p name is shown at in
+         * the layout of the document. An image shown at different sizes is
+         * decoded for the largest one.
+         */
+        void setImageDisplaySize( const QString &name, const QSize &size );
+
+    protected:
+        /**
+         * Returns the encoded data of the image with the given @p name, or
+         * an empty array if there is no such image.
+         */
+        virtual QByteArray imageData( const QString &name ) const = 0;
+
+        /**
+         * Returns the name of the image loaded as the resource @p url.
+         *
+         * The default implementation returns the @p url as a string.
+         */
+        virtual QString imageName( const QUrl &url ) const;
+
+        /**
+         * Reimplemented to decode the images.
+         */
+        virtual QVariant loadResource( int type, const QUrl &url );
+
+    private:
+        LazyImageTextDocumentPrivate * const d;
+        Q_DISABLE_COPY( LazyImageTextDocument )
+};
+
 /**
  * @brief QTextDocument-based Generator
  *
@@ -179,6 +281,8 @@ class OKULAR_EXPORT TextDocumentGenerator : public Generator
         Q_PRIVATE_SLOT( d_func(), void addTitle( int, const QString&, const QTextBlock& ) )
         Q_PRIVATE_SLOT( d_func(), void addMetaData( const QString&, const QString&, const QString& ) )
         Q_PRIVATE_SLOT( d_func(), void addMetaData( DocumentInfo::Key, const QString& ) )
+        Q_PRIVATE_SLOT( d_func(), void convertPendingDocument() )
+        Q_PRIVATE_SLOT( d_func(), void conversionThreadFinished() )
 };
 
 }
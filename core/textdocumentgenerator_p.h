@@ -10,7 +10,11 @@
 #ifndef _OKULAR_TEXTDOCUMENTGENERATOR_P_H_
 #define _OKULAR_TEXTDOCUMENTGENERATOR_P_H_
 
+#include <QtCore/QCache>
+#include <QtCore/QHash>
+#include <QtCore/QThread>
 #include <QtGui/QAbstractTextDocumentLayout>
+#include <QtGui/QImage>
 #include <QtGui/QTextBlock>
 #include <QtGui/QTextDocument>
 
@@ -21,6 +25,9 @@
 
 namespace Okular {
 
+class PaginationCache;
+class TextDocumentGeneratorPrivate;
+
 namespace TextDocumentUtils {
 
         static void calculateBoundingRect( QTextDocument *document, int startPosition, int endPosition,
@@ -92,6 +99,24 @@ namespace TextDocumentUtils {
         }
 }
 
+class LazyImageTextDocumentPrivate
+{
+    public:
+        LazyImageTextDocumentPrivate()
+            : mRenderScale( 1.0 ), mImages( 32 * 1024 * 1024 )
+        {
+        }
+
+        // the scale of the page being painted
+        qreal mRenderScale;
+        QHash<QString, QSize> mDisplaySizes;
+        mutable QHash<QString, QSize> mImageSizes;
+        // the decoded images, at the largest resolution painted so far; the
+        // cost is their size in bytes, so the least recently painted ones are
+        // decoded again when they take more than 32 MB
+        QCache<QString, QImage> mImages;
+};
+
 class TextDocumentConverterPrivate
 {
     public:
@@ -103,18 +128,44 @@ class TextDocumentConverterPrivate
         TextDocumentGeneratorPrivate *mParent;
 };
 
+/**
+ * Converts the document whose pages come from the pagination cache, without
+ * blocking the GUI thread.
+ */
+class TextDocumentConversionThread : public QThread
+{
+    public:
+        TextDocumentConversionThread( TextDocumentGeneratorPrivate *generator, const QString &fileName );
+
+        bool succeeded() const;
+
+    protected:
+        virtual void run();
+
+    private:
+        TextDocumentGeneratorPrivate *mGenerator;
+        QString mFileName;
+        bool mSucceeded;
+};
+
 class TextDocumentGeneratorPrivate : public GeneratorPrivate
 {
     friend class TextDocumentConverter;
 
     public:
         TextDocumentGeneratorPrivate( TextDocumentConverter *converter )
-            : mConverter( converter ), mDocument( 0 )
+            : mConverter( converter ), mDocument( 0 ), mConversionPending( false ),
+              mConversionThread( 0 )
         {
         }
 
         virtual ~TextDocumentGeneratorPrivate()
         {
+            if ( mConversionThread )
+            {
+                mConversionThread->wait();
+                delete mConversionThread;
+            }
             delete mConverter;
             delete mDocument;
         }
@@ -138,9 +189,30 @@ class TextDocumentGeneratorPrivate : public GeneratorPrivate
         void generateAnnotationInfos();
         void generateTitleInfos();
 
+        bool convert( const QString &fileName, bool generateTitles );
+        QList<int> addPageObjects( const QVector<Okular::Page*> &pages );
+        QString paginationSettingsKey() const;
+        bool restorePagination( const PaginationCache &cache, QVector<Okular::Page*> &pagesVector );
+        void storePagination( const QString &fileName );
+        void convertPendingDocument();
+        void conversionThreadFinished();
+        void finishPendingConversion( bool converted );
+        void ensureConverted();
+
         TextDocumentConverter *mConverter;
 
         QTextDocument *mDocument;
+
+        // set while the pages come from the pagination cache, and the
+        // document is not converted yet
+        bool mConversionPending;
+        QString mPendingFileName;
+        QVector<Okular::Page*> mPendingPages;
+        // converts the pending document, when the fonts can be used in
+        // other threads than the GUI one and the converter does not need
+        // to ask the user anything
+        TextDocumentConversionThread *mConversionThread;
+
         Okular::DocumentInfo mDocumentInfo;
         Okular::DocumentSynopsis mDocumentSynopsis;
 
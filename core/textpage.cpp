@@ -13,6 +13,7 @@
 #include <kdebug.h>
 
 #include "area.h"
+#include "area_p.h"
 #include "debug_p.h"
 #include "misc.h"
 #include "page.h"
@@ -1089,11 +1090,13 @@ QString TextPage::text(const RegularAreaRect *area, TextAreaInclusionBehaviour b
     QString ret;
     if ( area )
     {
+        // every word is checked against the area
+        const RegularAreaRectIndex index( *area );
         for ( ; it != itEnd; ++it )
         {
             if (b == AnyPixelTextAreaInclusionBehaviour)
             {
-                if ( area->intersects( (*it)->area ) )
+                if ( index.intersects( (*it)->area ) )
                 {
                     ret += (*it)->text();
                 }
@@ -1101,7 +1104,7 @@ QString TextPage::text(const RegularAreaRect *area, TextAreaInclusionBehaviour b
             else
             {
                 NormalizedPoint center = (*it)->area.center();
-                if ( area->contains( center.x, center.y ) )
+                if ( index.contains( center.x, center.y ) )
                 {
                     ret += (*it)->text();
                 }
@@ -1930,11 +1933,12 @@ TextEntity::List TextPage::words(const RegularAreaRect *area, TextAreaInclusionB
     TextEntity::List ret;
     if ( area )
     {
+        const RegularAreaRectIndex index( *area );
         foreach (TinyTextEntity *te, d->m_words)
         {
             if (b == AnyPixelTextAreaInclusionBehaviour)
             {
-                if ( area->intersects( te->area ) )
+                if ( index.intersects( te->area ) )
                 {
                     ret.append( new TextEntity( te->text(), new Okular::NormalizedRect( te->area) ) );
                 }
@@ -1942,7 +1946,7 @@ TextEntity::List TextPage::words(const RegularAreaRect *area, TextAreaInclusionB
             else
             {
                 const NormalizedPoint center = te->area.center();
-                if ( area->contains( center.x, center.y ) )
+                if ( index.contains( center.x, center.y ) )
                 {
                     ret.append( new TextEntity( te->text(), new Okular::NormalizedRect( te->area) ) );
                 }
@@ -12,11 +12,14 @@
 
 #include <QtCore/QEventLoop>
 #include <QtCore/QMutex>
+#include <QtGui/QApplication>
 #include <QtGui/QPainter>
 #include <QtXml/QDomElement>
 
 #include <kaboutdata.h>
+#include <kdeversion.h>
 #include <khtml_part.h>
+#include <khtml_settings.h>
 #include <khtmlview.h>
 #include <klocale.h>
 #include <kurl.h>
@@ -27,6 +30,7 @@
 #include <core/action.h>
 #include <core/observer.h> //for PAGEVIEW_ID
 #include <core/page.h>
+#include <core/paginationcache.h>
 #include <core/textpage.h>
 #include <core/utils.h>
 
@@ -147,11 +151,34 @@ bool CHMGenerator::loadDocument( const QString & fileName, QVector< Okular::Page
     }
     disconnect( m_syncGen, 0, this, 0 );
 
-    for (int i = 0; i < m_pageUrl.count(); ++i)
+    // laying out every page with KHTML is slow, so the sizes of the pages
+    // are reused from the last time the file was opened with the same
+    // HTML engine and fonts
+    const KHTMLSettings *settings = m_syncGen->settings();
+    const QString settingsKey = QString("chm;%1;%2;%3;%4").arg(KDE_VERSION_STRING)
+        .arg(QApplication::font().toString()).arg(settings->stdFontName()).arg(settings->mediumFontSize());
+    Okular::PaginationCache cache(fileName, settingsKey);
+    const QVector<QSize> cachedSizes = cache.pageSizes();
+    if (cache.isValid() && cachedSizes.count() == m_pageUrl.count())
     {
-        preparePageForSyncOperation(100, m_pageUrl.at(i));
-        pagesVector[ i ] = new Okular::Page (i, m_syncGen->view()->contentsWidth(),
-            m_syncGen->view()->contentsHeight(), Okular::Rotation0 );
+        for (int i = 0; i < m_pageUrl.count(); ++i)
+        {
+            pagesVector[ i ] = new Okular::Page (i, cachedSizes.at(i).width(),
+                cachedSizes.at(i).height(), Okular::Rotation0 );
+        }
+    }
+    else
+    {
+        QVector<QSize> sizes(m_pageUrl.count());
+        for (int i = 0; i < m_pageUrl.count(); ++i)
+        {
+            preparePageForSyncOperation(100, m_pageUrl.at(i));
+            sizes[ i ] = QSize(m_syncGen->view()->contentsWidth(), m_syncGen->view()->contentsHeight());
+            pagesVector[ i ] = new Okular::Page (i, sizes.at(i).width(),
+                sizes.at(i).height(), Okular::Rotation0 );
+        }
+        cache.setPageSizes(sizes);
+        cache.store();
     }
 
     connect( m_syncGen, SIGNAL(completed()), this, SLOT(slotCompleted()) );
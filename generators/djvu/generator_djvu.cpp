@@ -30,6 +30,9 @@
 #include <klocale.h>
 #include <ktemporaryfile.h>
 
+// how long to wait before trying again to get the document, in ms
+#define DJVUPAGELOADER_BACKOFF 10
+
 static void recurseCreateTOC( QDomDocument &maindoc, const QDomNode &parent, QDomNode &parentDestination, KDjVu *djvu )
 {
     QDomNode n = parent.firstChild();
@@ -84,7 +87,7 @@ static KAboutData createAboutData()
 OKULAR_EXPORT_PLUGIN( DjVuGenerator, createAboutData() )
 
 DjVuGenerator::DjVuGenerator( QObject *parent, const QVariantList &args )
-    : Okular::Generator( parent, args ), m_docInfo( 0 ), m_docSyn( 0 )
+    : Okular::Generator( parent, args ), m_pageLoader( 0 ), m_docInfo( 0 ), m_docSyn( 0 )
 {
     setFeature( TextExtraction );
     setFeature( Threaded );
@@ -98,24 +101,34 @@ DjVuGenerator::DjVuGenerator( QObject *parent, const QVariantList &args )
 
 DjVuGenerator::~DjVuGenerator()
 {
+    stopPageLoader();
     delete m_djvu;
 }
 
 bool DjVuGenerator::loadDocument( const QString & fileName, QVector< Okular::Page * > & pagesVector )
 {
     QMutexLocker locker( userMutex() );
-    if ( !m_djvu->openFile( fileName ) )
+    if ( !m_djvu->openFile( fileName, true ) )
         return false;
 
     locker.unlock();
 
     loadPages( pagesVector, 0 );
 
+    m_pages = pagesVector;
+    m_pageLoader = new DjVuPageLoader( this, pagesVector.count() );
+    connect( m_pageLoader, SIGNAL(pagesLoaded()), this, SLOT(applyLoadedPages()) );
+    connect( m_pageLoader, SIGNAL(finished()), this, SLOT(pageLoaderFinished()) );
+    m_pageLoader->start( QThread::LowPriority );
+
     return true;
 }
 
 bool DjVuGenerator::doCloseDocument()
 {
+    stopPageLoader();
+    m_pages.clear();
+
     userMutex()->lock();
     m_djvu->closeFile();
     userMutex()->unlock();
@@ -128,10 +141,22 @@ bool DjVuGenerator::doCloseDocument()
     return true;
 }
 
+void DjVuGenerator::generatePixmap( Okular::PixmapRequest *request )
+{
+    if ( m_pageLoader )
+        m_pageLoader->prioritize( request->pageNumber() );
+    Okular::Generator::generatePixmap( request );
+}
+
+static bool isRequestCancelled( void *request )
+{
+    return static_cast< Okular::PixmapRequest * >( request )->isCancelled();
+}
+
 QImage DjVuGenerator::image( Okular::PixmapRequest *request )
 {
     userMutex()->lock();
-    QImage img = m_djvu->image( request->pageNumber(), request->width(), request->height(), request->page()->rotation() );
+    QImage img = m_djvu->image( request->pageNumber(), request->width(), request->height(), request->page()->rotation(), isRequestCancelled, request );
     userMutex()->unlock();
     return img;
 }
@@ -248,15 +273,18 @@ Okular::TextPage* DjVuGenerator::textPage( Okular::Page *page )
         te = m_djvu->textEntities( page->number(), "word" );
     if ( te.isEmpty() )
         te = m_djvu->textEntities( page->number(), "line" );
+    m_djvu->readPageInfo( page->number() );
+    const KDjVu::Page* djvupage = m_djvu->pages().at( page->number() );
+    const int width = djvupage->width();
+    const int height = djvupage->height();
     userMutex()->unlock();
     QList<KDjVu::TextEntity>::ConstIterator it = te.constBegin();
     QList<KDjVu::TextEntity>::ConstIterator itEnd = te.constEnd();
     QList<Okular::TextEntity*> words;
-    const KDjVu::Page* djvupage = m_djvu->pages().at( page->number() );
     for ( ; it != itEnd; ++it )
     {
         const KDjVu::TextEntity& cur = *it;
-        words.append( new Okular::TextEntity( cur.text(), new Okular::NormalizedRect( cur.rect(), djvupage->width(), djvupage->height() ) ) );
+        words.append( new Okular::TextEntity( cur.text(), new Okular::NormalizedRect( cur.rect(), width, height ) ) );
     }
     Okular::TextPage *textpage = new Okular::TextPage( words );
     return textpage;
@@ -280,44 +308,100 @@ void DjVuGenerator::loadPages( QVector<Okular::Page*> & pagesVector, int rotatio
             qSwap( w, h );
         Okular::Page *page = new Okular::Page( i, w, h, (Okular::Rotation)( p->orientation() + rotation ) );
         pagesVector[i] = page;
+    }
+}
 
-        QList<KDjVu::Annotation*> annots;
-        QList<KDjVu::Link*> links;
-        userMutex()->lock();
-        m_djvu->linksAndAnnotationsForPage( i, &links, &annots );
-        userMutex()->unlock();
-        if ( !links.isEmpty() )
-        {
-            QLinkedList<Okular::ObjectRect *> rects;
-            QList<KDjVu::Link*>::ConstIterator it = links.constBegin();
-            QList<KDjVu::Link*>::ConstIterator itEnd = links.constEnd();
-            for ( ; it != itEnd; ++it )
-            {
-                KDjVu::Link *curlink = (*it);
-                Okular::ObjectRect *newrect = convertKDjVuLink( i, curlink );
-                if ( newrect )
-                    rects.append( newrect );
-                // delete the links as soon as we process them
-                delete curlink;
-            }
-            if ( rects.count() > 0 )
-                page->setObjectRects( rects );
-        }
-        if ( !annots.isEmpty() )
-        {
-            QList<KDjVu::Annotation*>::ConstIterator it = annots.constBegin();
-            QList<KDjVu::Annotation*>::ConstIterator itEnd = annots.constEnd();
-            for ( ; it != itEnd; ++it )
-            {
-                KDjVu::Annotation *ann = (*it);
-                Okular::Annotation *newann = convertKDjVuAnnotation( w, h, ann );
-                if ( newann )
-                    page->addAnnotation( newann );
-                // delete the annotations as soon as we process them
-                delete ann;
-            }
-        }
+bool DjVuGenerator::readPage( DjVuPageLoader *loader, int number, DjVuLoadedPage *loaded )
+{
+    // the document is locked again for each step, so a render waits at
+    // most for one of them
+    if ( !loader->lockDocument() )
+        return false;
+    m_djvu->readPageInfo( number );
+    const KDjVu::Page *p = m_djvu->pages().at( number );
+    const int w = p->width();
+    const int h = p->height();
+    loaded->number = number;
+    loaded->width = w;
+    loaded->height = h;
+    loaded->orientation = p->orientation();
+    userMutex()->unlock();
+
+    if ( !loader->lockDocument() )
+        return false;
+    QList<KDjVu::Annotation*> annots;
+    QList<KDjVu::Link*> links;
+    m_djvu->linksAndAnnotationsForPage( number, &links, &annots );
+
+    QList<KDjVu::Link*>::ConstIterator it = links.constBegin();
+    QList<KDjVu::Link*>::ConstIterator itEnd = links.constEnd();
+    for ( ; it != itEnd; ++it )
+    {
+        KDjVu::Link *curlink = (*it);
+        Okular::ObjectRect *newrect = convertKDjVuLink( number, curlink );
+        if ( newrect )
+            loaded->rects.append( newrect );
+        // delete the links as soon as we process them
+        delete curlink;
     }
+    userMutex()->unlock();
+
+    QList<KDjVu::Annotation*>::ConstIterator annIt = annots.constBegin();
+    QList<KDjVu::Annotation*>::ConstIterator annItEnd = annots.constEnd();
+    for ( ; annIt != annItEnd; ++annIt )
+    {
+        KDjVu::Annotation *ann = (*annIt);
+        Okular::Annotation *newann = convertKDjVuAnnotation( w, h, ann );
+        if ( newann )
+            loaded->annotations.append( newann );
+        // delete the annotations as soon as we process them
+        delete ann;
+    }
+
+    return true;
+}
+
+void DjVuGenerator::applyLoadedPages()
+{
+    if ( !m_pageLoader )
+        return;
+
+    const QList<DjVuLoadedPage> loadedPages = m_pageLoader->takeLoadedPages();
+    foreach ( const DjVuLoadedPage &loaded, loadedPages )
+    {
+        Okular::Page *page = m_pages.at( loaded.number );
+
+        // the page was created with the size of the first one
+        const bool rotated = page->rotation() % 2;
+        const double width = rotated ? page->height() : page->width();
+        const double height = rotated ? page->width() : page->height();
+        if ( width != loaded.width || height != loaded.height || page->orientation() != (Okular::Rotation)loaded.orientation )
+            updatePageSize( loaded.number, loaded.width, loaded.height, (Okular::Rotation)loaded.orientation );
+
+        if ( !loaded.rects.isEmpty() )
+            page->setObjectRects( loaded.rects );
+        foreach ( Okular::Annotation *annotation, loaded.annotations )
+            page->addAnnotation( annotation );
+        if ( !loaded.rects.isEmpty() || !loaded.annotations.isEmpty() )
+            updatePageObjects( loaded.number );
+    }
+}
+
+void DjVuGenerator::pageLoaderFinished()
+{
+    applyLoadedPages();
+    updatePageSizesDone();
+}
+
+void DjVuGenerator::stopPageLoader()
+{
+    if ( !m_pageLoader )
+        return;
+
+    m_pageLoader->stop();
+    m_pageLoader->wait();
+    delete m_pageLoader;
+    m_pageLoader = 0;
 }
 
 Okular::ObjectRect* DjVuGenerator::convertKDjVuLink( int page, KDjVu::Link * link ) const
@@ -469,4 +553,106 @@ Okular::Annotation* DjVuGenerator::convertKDjVuAnnotation( int w, int h, KDjVu::
 }
 
 
+DjVuPageLoader::DjVuPageLoader( DjVuGenerator *generator, int pageCount )
+    : QThread(), m_generator( generator ), m_queuedPages( pageCount, true ), m_nextPage( 0 ), m_stop( false )
+{
+}
+
+DjVuPageLoader::~DjVuPageLoader()
+{
+    foreach ( const DjVuLoadedPage &loaded, m_loadedPages )
+    {
+        qDeleteAll( loaded.rects );
+        qDeleteAll( loaded.annotations );
+    }
+}
+
+void DjVuPageLoader::prioritize( int page )
+{
+    QMutexLocker locker( &m_mutex );
+    if ( page >= 0 && page < m_queuedPages.count() && m_queuedPages.testBit( page ) )
+        m_priorityPages.prepend( page );
+}
+
+void DjVuPageLoader::stop()
+{
+    QMutexLocker locker( &m_mutex );
+    m_stop = true;
+}
+
+bool DjVuPageLoader::isStopped()
+{
+    QMutexLocker locker( &m_mutex );
+    return m_stop;
+}
+
+bool DjVuPageLoader::lockDocument()
+{
+    // never make a render wait for us to get the document
+    while ( !m_generator->userMutex()->tryLock() )
+    {
+        if ( isStopped() )
+            return false;
+        msleep( DJVUPAGELOADER_BACKOFF );
+    }
+    return true;
+}
+
+QList<DjVuLoadedPage> DjVuPageLoader::takeLoadedPages()
+{
+    QMutexLocker locker( &m_mutex );
+    const QList<DjVuLoadedPage> loadedPages = m_loadedPages;
+    m_loadedPages.clear();
+    return loadedPages;
+}
+
+void DjVuPageLoader::run()
+{
+    forever
+    {
+        int number = -1;
+        m_mutex.lock();
+        if ( m_stop )
+        {
+            m_mutex.unlock();
+            return;
+        }
+        while ( number == -1 && !m_priorityPages.isEmpty() )
+        {
+            const int page = m_priorityPages.takeFirst();
+            if ( m_queuedPages.testBit( page ) )
+                number = page;
+        }
+        while ( number == -1 && m_nextPage < m_queuedPages.count() )
+        {
+            const int page = m_nextPage++;
+            if ( m_queuedPages.testBit( page ) )
+                number = page;
+        }
+        if ( number != -1 )
+            m_queuedPages.clearBit( number );
+        m_mutex.unlock();
+
+        if ( number == -1 )
+            return;
+
+        DjVuLoadedPage loaded;
+        if ( !m_generator->readPage( this, number, &loaded ) )
+        {
+            qDeleteAll( loaded.rects );
+            qDeleteAll( loaded.annotations );
+            return;
+        }
+
+        m_mutex.lock();
+        const bool notify = m_loadedPages.isEmpty();
+        m_loadedPages.append( loaded );
+        m_mutex.unlock();
+
+        // once until the GUI thread takes the pages
+        if ( notify )
+            emit pagesLoaded();
+    }
+}
+
 #include "generator_djvu.moc"
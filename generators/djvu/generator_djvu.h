@@ -12,6 +12,10 @@
 
 #include <core/generator.h>
 
+#include <qbitarray.h>
+#include <qlinkedlist.h>
+#include <qmutex.h>
+#include <qthread.h>
 #include <qvector.h>
 
 #include "kdjvu.h"
@@ -21,6 +25,55 @@ class Annotation;
 class ObjectRect;
 }
 
+class DjVuGenerator;
+
+// the info, links and annotations of a page, read by the DjVuPageLoader
+struct DjVuLoadedPage
+{
+    int number;
+    int width;
+    int height;
+    int orientation;
+    QLinkedList<Okular::ObjectRect*> rects;
+    QList<Okular::Annotation*> annotations;
+};
+
+/**
+ * Reads the info, links and annotations of all the pages in a thread, the
+ * pages asked for by prioritize() first.
+ */
+class DjVuPageLoader : public QThread
+{
+    Q_OBJECT
+    public:
+        DjVuPageLoader( DjVuGenerator *generator, int pageCount );
+        ~DjVuPageLoader();
+
+        void prioritize( int page );
+        void stop();
+        QList<DjVuLoadedPage> takeLoadedPages();
+
+    signals:
+        void pagesLoaded();
+
+    protected:
+        void run();
+
+    private:
+        friend class DjVuGenerator;
+
+        bool isStopped();
+        bool lockDocument();
+
+        DjVuGenerator *m_generator;
+        QMutex m_mutex;
+        QBitArray m_queuedPages;
+        QList<int> m_priorityPages;
+        int m_nextPage;
+        bool m_stop;
+        QList<DjVuLoadedPage> m_loadedPages;
+};
+
 class DjVuGenerator : public Okular::Generator
 {
     Q_OBJECT
@@ -29,6 +82,9 @@ class DjVuGenerator : public Okular::Generator
         ~DjVuGenerator();
         bool loadDocument( const QString & fileName, QVector<Okular::Page*> & pagesVector );
 
+        // pixmap generation
+        void generatePixmap( Okular::PixmapRequest *request );
+
         // document information
         const Okular::DocumentInfo * generateDocumentInfo();
         const Okular::DocumentSynopsis * generateDocumentSynopsis();
@@ -44,13 +100,26 @@ class DjVuGenerator : public Okular::Generator
         QImage image( Okular::PixmapRequest *request );
         Okular::TextPage* textPage( Okular::Page *page );
 
+    private slots:
+        void applyLoadedPages();
+        void pageLoaderFinished();
+
     private:
+        friend class DjVuPageLoader;
+
         void loadPages( QVector<Okular::Page*> & pagesVector, int rotation );
+        bool readPage( DjVuPageLoader *loader, int number, DjVuLoadedPage *loaded );
+        void stopPageLoader();
         Okular::ObjectRect* convertKDjVuLink( int page, KDjVu::Link * link ) const;
         Okular::Annotation* convertKDjVuAnnotation( int w, int h, KDjVu::Annotation * ann ) const;
 
         KDjVu *m_djvu;
 
+        // the info, links and annotations of the pages are loaded in a
+        // thread, the requested pages first
+        QVector<Okular::Page*> m_pages;
+        DjVuPageLoader *m_pageLoader;
+
         Okular::DocumentInfo *m_docInfo;
         Okular::DocumentSynopsis *m_docSyn;
 };
@@ -10,12 +10,12 @@
 #include "kdjvu.h"
 
 #include <qbytearray.h>
+#include <qcache.h>
 #include <qdom.h>
 #include <qfile.h>
 #include <qhash.h>
 #include <qlist.h>
 #include <qpainter.h>
-#include <qqueue.h>
 #include <qstring.h>
 
 #include <kdebug.h>
@@ -157,10 +157,26 @@ class ImageCacheItem
         QImage img;
 };
 
+// the zones of the hidden text, from the largest to the smallest
+static const char * const s_textZoneNames[] = { "page", "column", "region", "para", "line", "word", "char" };
+static const int s_textZoneCount = sizeof( s_textZoneNames ) / sizeof( s_textZoneNames[0] );
+
+// the memory budget (in bytes) for the text of the pages
+static const int s_textCacheCost = 16 * 1024 * 1024;
+
+// TextCacheItem
+
+class TextCacheItem
+{
+    public:
+        QList<KDjVu::TextEntity> zones[ s_textZoneCount ];
+};
+
 
 // KdjVu::Page
 
 KDjVu::Page::Page()
+    : m_placeholder( false )
 {
 }
 
@@ -432,6 +448,7 @@ class KDjVu::Private
           : m_djvu_cxt( 0 ), m_djvu_document( 0 ), m_format( 0 ), m_docBookmarks( 0 ),
             m_cacheEnabled( true )
         {
+            m_textCache.setMaxCost( s_textCacheCost );
         }
 
         QImage generateImageTile( ddjvu_page_t *djvupage, int& res,
@@ -443,6 +460,13 @@ class KDjVu::Private
 
         void readMetaData( int page );
 
+        bool readPageInfo( int pageNum, KDjVu::Page *p );
+        bool ensurePageInfo( int pageNum );
+
+        TextCacheItem * readPageText( int page, int *cost );
+        void readTextZones( miniexp_t exp, int height, const miniexp_t *zoneSymbols,
+            TextCacheItem *item, int *cost );
+
         int pageWithName( const QString & name );
 
         ddjvu_context_t *m_djvu_cxt;
@@ -453,6 +477,7 @@ class KDjVu::Private
         QVector<ddjvu_page_t *> m_pages_cache;
 
         QList<ImageCacheItem*> mImgCache;
+        QCache<int, TextCacheItem> m_textCache;
 
         QHash<QString, QVariant> m_metaData;
         QDomDocument * m_docBookmarks;
@@ -610,6 +635,100 @@ void KDjVu::Private::readMetaData( int page )
     }
 }
 
+bool KDjVu::Private::readPageInfo( int pageNum, KDjVu::Page *p )
+{
+    ddjvu_status_t sts;
+    ddjvu_pageinfo_t info;
+    while ( ( sts = ddjvu_document_get_pageinfo( m_djvu_document, pageNum, &info ) ) < DDJVU_JOB_OK )
+        handle_ddjvu_messages( m_djvu_cxt, true );
+    if ( sts >= DDJVU_JOB_FAILED )
+    {
+        kDebug().nospace() << "\t>>> page " << pageNum << " failed: " << sts;
+        return false;
+    }
+
+    p->m_width = info.width;
+    p->m_height = info.height;
+    p->m_dpi = info.dpi;
+#if DDJVUAPI_VERSION >= 18
+    p->m_orientation = flipRotation( info.rotation );
+#else
+    p->m_orientation = 0;
+#endif
+    return true;
+}
+
+bool KDjVu::Private::ensurePageInfo( int pageNum )
+{
+    KDjVu::Page *p = m_pages.at( pageNum );
+    if ( !p->m_placeholder )
+        return true;
+
+    // do not try again if it fails, the page stays with the placeholder info
+    p->m_placeholder = false;
+    return readPageInfo( pageNum, p );
+}
+
+TextCacheItem * KDjVu::Private::readPageText( int page, int *cost )
+{
+    miniexp_t r;
+    while ( ( r = ddjvu_document_get_pagetext( m_djvu_document, page, 0 ) ) == miniexp_dummy )
+        handle_ddjvu_messages( m_djvu_cxt, true );
+
+    TextCacheItem *item = new TextCacheItem;
+    *cost = sizeof( TextCacheItem );
+    if ( r == miniexp_nil )
+        return item;
+
+    // the symbols are unique, so the zone types can be compared by pointer
+    miniexp_t zoneSymbols[ s_textZoneCount ];
+    for ( int i = 0; i < s_textZoneCount; ++i )
+        zoneSymbols[i] = miniexp_symbol( s_textZoneNames[i] );
+
+    ensurePageInfo( page );
+    readTextZones( r, m_pages.at( page )->height(), zoneSymbols, item, cost );
+    ddjvu_miniexp_release( m_djvu_document, r );
+
+    return item;
+}
+
+void KDjVu::Private::readTextZones( miniexp_t exp, int height, const miniexp_t *zoneSymbols,
+    TextCacheItem *item, int *cost )
+{
+    // a zone is ( type xmin ymin xmax ymax text ) or ( type xmin ymin xmax ymax zone... )
+    if ( !miniexp_consp( exp ) || !miniexp_symbolp( miniexp_car( exp ) ) )
+        return;
+
+    const miniexp_t type = miniexp_car( exp );
+    int zone = 0;
+    while ( zone < s_textZoneCount && zoneSymbols[zone] != type )
+        ++zone;
+
+    int coords[4];
+    miniexp_t rest = miniexp_cdr( exp );
+    for ( int i = 0; i < 4; ++i, rest = miniexp_cdr( rest ) )
+    {
+        if ( !miniexp_consp( rest ) )
+            return;
+        coords[i] = miniexp_to_int( miniexp_car( rest ) );
+    }
+
+    if ( !miniexp_consp( rest ) )
+        return;
+
+    if ( zone < s_textZoneCount )
+    {
+        KDjVu::TextEntity entity;
+        entity.m_rect = QRect( coords[0], height - coords[3], coords[2] - coords[0], coords[3] - coords[1] );
+        entity.m_text = QString::fromUtf8( miniexp_to_str( miniexp_car( rest ) ) );
+        item->zones[zone].append( entity );
+        *cost += sizeof( KDjVu::TextEntity ) + entity.m_text.length() * sizeof( QChar );
+    }
+
+    for ( ; miniexp_consp( rest ); rest = miniexp_cdr( rest ) )
+        readTextZones( miniexp_car( rest ), height, zoneSymbols, item, cost );
+}
+
 int KDjVu::Private::pageWithName( const QString & name )
 {
     const int pageNo = m_pageNamesCache.value( name, -1 );
@@ -660,7 +779,7 @@ KDjVu::~KDjVu()
     delete d;
 }
 
-bool KDjVu::openFile( const QString & fileName )
+bool KDjVu::openFile( const QString & fileName, bool lazy )
 {
     // first, close the old file
     if ( d->m_djvu_document )
@@ -716,25 +835,18 @@ bool KDjVu::openFile( const QString & fileName )
     // read the pages
     for ( int i = 0; i < numofpages; ++i )
     {
-        ddjvu_status_t sts;
-        ddjvu_pageinfo_t info;
-        while ( ( sts = ddjvu_document_get_pageinfo( d->m_djvu_document, i, &info ) ) < DDJVU_JOB_OK )
-            handle_ddjvu_messages( d->m_djvu_cxt, true );
-        if ( sts >= DDJVU_JOB_FAILED )
+        KDjVu::Page *p = new KDjVu::Page();
+        if ( lazy && i > 0 )
+        {
+            // most of the pages of a document have the same size
+            *p = *d->m_pages.at( 0 );
+            p->m_placeholder = true;
+        }
+        else if ( !d->readPageInfo( i, p ) )
         {
-            kDebug().nospace() << "\t>>> page " << i << " failed: " << sts;
+            delete p;
             return false;
         }
-
-        KDjVu::Page *p = new KDjVu::Page();
-        p->m_width = info.width;
-        p->m_height = info.height;
-        p->m_dpi = info.dpi;
-#if DDJVUAPI_VERSION >= 18
-        p->m_orientation = flipRotation( info.rotation );
-#else
-        p->m_orientation = 0;
-#endif
         d->m_pages[i] = p;
     }
 
@@ -761,6 +873,8 @@ void KDjVu::closeFile()
     // clearing the image cache
     qDeleteAll( d->mImgCache );
     d->mImgCache.clear();
+    // clearing the text cache
+    d->m_textCache.clear();
     // clearing the old metadata
     d->m_metaData.clear();
     // cleaing the page names mapping
@@ -905,7 +1019,15 @@ const QVector<KDjVu::Page*> &KDjVu::pages() const
     return d->m_pages;
 }
 
-QImage KDjVu::image( int page, int width, int height, int rotation )
+bool KDjVu::readPageInfo( int pageNum )
+{
+    if ( ( pageNum < 0 ) || ( pageNum >= d->m_pages.count() ) )
+        return false;
+
+    return d->ensurePageInfo( pageNum );
+}
+
+QImage KDjVu::image( int page, int width, int height, int rotation, CancelledCallback cancelled, void *data )
 {
     if ( d->m_cacheEnabled )
     {
@@ -977,6 +1099,12 @@ QImage KDjVu::image( int page, int width, int height, int rotation )
         int parts = xparts * yparts;
         for ( int i = 0; i < parts; ++i )
         {
+            if ( cancelled && cancelled( data ) )
+            {
+                p.end();
+                return QImage();
+            }
+
             int row = i % xparts;
             int col = i / xparts;
             int tmpres = 0;
@@ -1081,52 +1209,21 @@ QList<KDjVu::TextEntity> KDjVu::textEntities( int page, const QString & granular
     if ( ( page < 0 ) || ( page >= d->m_pages.count() ) )
         return QList<KDjVu::TextEntity>();
 
-    miniexp_t r;
-    while ( ( r = ddjvu_document_get_pagetext( d->m_djvu_document, page, 0 ) ) == miniexp_dummy )
-        handle_ddjvu_messages( d->m_djvu_cxt, true );
-
-    if ( r == miniexp_nil )
+    int zone = 0;
+    while ( zone < s_textZoneCount && granularity != QLatin1String( s_textZoneNames[zone] ) )
+        ++zone;
+    if ( zone == s_textZoneCount )
         return QList<KDjVu::TextEntity>();
 
-    QList<KDjVu::TextEntity> ret;
-
-    int height = d->m_pages.at( page )->height();
-
-    QQueue<miniexp_t> queue;
-    queue.enqueue( r );
-
-    while ( !queue.isEmpty() )
-    {
-        miniexp_t cur = queue.dequeue();
+    TextCacheItem *item = d->m_textCache.object( page );
+    if ( item )
+        return item->zones[zone];
 
-        if ( miniexp_listp( cur )
-             && ( miniexp_length( cur ) > 0 )
-             && miniexp_symbolp( miniexp_nth( 0, cur ) ) )
-        {
-            int size = miniexp_length( cur );
-            QString sym = QString::fromUtf8( miniexp_to_name( miniexp_nth( 0, cur ) ) );
-            if ( sym == granularity )
-            {
-                if ( size >= 6 )
-                {
-                    int xmin = miniexp_to_int( miniexp_nth( 1, cur ) );
-                    int ymin = miniexp_to_int( miniexp_nth( 2, cur ) );
-                    int xmax = miniexp_to_int( miniexp_nth( 3, cur ) );
-                    int ymax = miniexp_to_int( miniexp_nth( 4, cur ) );
-                    QRect rect( xmin, height - ymax, xmax - xmin, ymax - ymin );
-                    KDjVu::TextEntity entity;
-                    entity.m_rect = rect;
-                    entity.m_text = QString::fromUtf8( miniexp_to_str( miniexp_nth( 5, cur ) ) );
-                    ret.append( entity );
-                }
-            }
-            else
-            {
-                for ( int i = 5; i < size; ++i )
-                    queue.enqueue( miniexp_nth( i, cur ) );
-            }
-        }
-    }
+    int cost = 0;
+    item = d->readPageText( page, &cost );
+    const QList<KDjVu::TextEntity> ret = item->zones[zone];
+    // the cache deletes the item right away if it is bigger than the budget
+    d->m_textCache.insert( page, item, cost );
 
     return ret;
 }
@@ -56,6 +56,8 @@ class KDjVu
                 int m_height;
                 int m_dpi;
                 int m_orientation;
+                // the info was not read yet, see readPageInfo()
+                bool m_placeholder;
         };
 
 
@@ -208,8 +210,13 @@ class KDjVu
 
         /**
          * Opens the file \p fileName, closing the old one if necessary.
+         *
+         * If \p lazy is true, only the info of the first page is read, and the
+         * other pages are placeholders until readPageInfo() is called for them:
+         * reading the info of all the pages can mean decoding (or fetching, for
+         * indirect documents) all the component files.
          */
-        bool openFile( const QString & fileName );
+        bool openFile( const QString & fileName, bool lazy = false );
         /**
          * Close the file currently opened, if any.
          */
@@ -222,6 +229,13 @@ class KDjVu
          */
         const QVector<KDjVu::Page*> &pages() const;
 
+        /**
+         * Reads the info of the page \p pageNum, if it is a placeholder, waiting
+         * for it to be available.
+         * \returns whether the page has its own info
+         */
+        bool readPageInfo( int pageNum );
+
         /**
          * Get the metadata for the specified \p key, or a null variant otherwise.
          */
@@ -250,12 +264,22 @@ class KDjVu
          */
         void linksAndAnnotationsForPage( int pageNum, QList<KDjVu::Link*> *links, QList<KDjVu::Annotation*> *annotations ) const;
 
+        /**
+         * Callback telling whether the rendering of an image is not needed
+         * anymore; \p data is the pointer passed to image().
+         */
+        typedef bool (*CancelledCallback)( void *data );
+
         /**
          * Check if the image for the specified \p page with the specified
          * \p width, \p height and \p rotation is already in cache, and returns
          * it. If not, a null image is returned.
+         *
+         * If \p cancelled is specified, it is checked between the tiles of a
+         * big image, and when it returns true the rendering is stopped and a
+         * null image is returned.
          */
-        QImage image( int page, int width, int height, int rotation );
+        QImage image( int page, int width, int height, int rotation, CancelledCallback cancelled = 0, void *data = 0 );
 
         /**
          * Export the currently open document as PostScript file \p fileName.
@@ -272,6 +296,9 @@ class KDjVu
         /**
          * Return the list of the text entities for the specified \p page, that matches the
          * specified \p granularity.
+         *
+         * The text of a page is read once for all the granularities, and kept
+         * in a cache of the recently used pages.
          */
         QList<KDjVu::TextEntity> textEntities( int page, const QString & granularity ) const;
 
@@ -101,6 +101,77 @@ void Converter::_handle_anchors(const QTextBlock &start, const QString &name) {
   }
 }
 
+// Give the images from start on the size they are shown at, so that the
+// layout does not need to decode them, and the path of their data in the
+// epub, so that they can be loaded out of the conversion (when painted)
+void Converter::_handle_images(const QTextBlock &start)
+{
+  QList<QPair<int, int> > ranges;
+  QList<QTextImageFormat> formats;
+
+  for (QTextBlock bit = start; bit != mTextDocument->end(); bit = bit.next()) {
+    for (QTextBlock::iterator fit = bit.begin(); !(fit.atEnd()); ++fit) {
+      QTextFragment frag = fit.fragment();
+
+      if (frag.isValid() && frag.charFormat().isImageFormat()) {
+        ranges.append(QPair<int, int>(frag.position(), frag.position() + frag.length()));
+        formats.append(frag.charFormat().toImageFormat());
+      }
+    }
+  }
+
+  const qreal maxWidth = mTextDocument->pageSize().width()
+                         - 2 * mTextDocument->rootFrame()->frameFormat().margin();
+
+  QTextCursor cursor(mTextDocument);
+  for (int i = 0; i < formats.count(); ++i) {
+    QTextImageFormat format = formats.at(i);
+    const QString path = mTextDocument->resolveUrl(format.name());
+    const bool hasWidth = format.hasProperty(QTextFormat::ImageWidth);
+    const bool hasHeight = format.hasProperty(QTextFormat::ImageHeight);
+
+    QSizeF size(format.width(), format.height());
+    if (!hasWidth || !hasHeight) {
+      const QSize imageSize = mTextDocument->imageSize(path);
+      if (!imageSize.isEmpty()) {
+        if (hasWidth) {
+          size.setHeight(size.width() * imageSize.height() / imageSize.width());
+        } else if (hasHeight) {
+          size.setWidth(size.height() * imageSize.width() / imageSize.height());
+        } else {
+          size = imageSize;
+          // shrink the big images to the page, as they are shown
+          if (size.width() > maxWidth) {
+            size.setHeight(size.height() * maxWidth / size.width());
+            size.setWidth(maxWidth);
+          }
+        }
+        format.setWidth(size.width());
+        format.setHeight(size.height());
+      } else {
+        size = QSizeF();
+      }
+    }
+
+    if (size.isValid())
+      mTextDocument->setImageDisplaySize(path, size.toSize());
+    // rooted, so that it resolves to the same path from any sub document
+    format.setName("/" + path);
+
+    cursor.setPosition(ranges.at(i).first);
+    cursor.setPosition(ranges.at(i).second, QTextCursor::KeepAnchor);
+    cursor.setCharFormat(format);
+  }
+}
+
+// Start what comes next in a new page
+void Converter::_insertPageBreak(QTextCursor *cursor)
+{
+  QTextBlockFormat format;
+  format.setPageBreakPolicy(QTextFormat::PageBreak_AlwaysAfter);
+  cursor->insertBlock(format);
+}
+
 QTextDocument* Converter::convert( const QString &fileName )
 {
   EpubDocument *newDocument = new EpubDocument(fileName);
@@ -146,7 +217,7 @@ QTextDocument* Converter::convert( const QString &fileName )
     if (epub_it_get_curr(it)) {
 
       // insert block for links
-      _cursor->insertBlock();
+      _cursor->insertBlock(QTextBlockFormat());
 
       QString link = QString::fromUtf8(epub_it_get_curr_url(it));
       mTextDocument->setCurrentSubDocument(link);
@@ -158,11 +229,10 @@ QTextDocument* Converter::convert( const QString &fileName )
 
       // Add anchors to hashes
       _handle_anchors(before, link);
+      _handle_images(before);
 
       // Start new file in a new page
-      int page = mTextDocument->pageCount();
-      while(mTextDocument->pageCount() == page)
-        _cursor->insertText("\n");
+      _insertPageBreak(_cursor);
     }
   } while (epub_it_get_next(it));
 
@@ -191,7 +261,7 @@ QTextDocument* Converter::convert( const QString &fileName )
           char *data = 0;
           int size = epub_get_data(mTextDocument->getEpub(), clink, &data);
           if (data) {
-            _cursor->insertBlock();
+            _cursor->insertBlock(QTextBlockFormat());
 
             // try to load as image and if not load as html
             block = _cursor->block();
@@ -208,9 +278,7 @@ QTextDocument* Converter::convert( const QString &fileName )
             }
 
             // Start new file in a new page
-            int page = mTextDocument->pageCount();
-            while(mTextDocument->pageCount() == page)
-              _cursor->insertText("\n");
+            _insertPageBreak(_cursor);
           }
 
           free(data);
@@ -30,6 +30,8 @@ namespace Epub {
 
       void _emitData(Okular::DocumentInfo::Key key, enum epub_metadata type); 
       void _handle_anchors(const QTextBlock &start, const QString &name);
+      void _handle_images(const QTextBlock &start);
+      void _insertPageBreak(QTextCursor *cursor);
       EpubDocument *mTextDocument;
 
       QHash<QString, QTextBlock> mSectionMap;
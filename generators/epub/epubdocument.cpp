@@ -23,7 +23,7 @@ QString resourceUrl(const KUrl &baseUrl, const QString &u)
 
 }
 
-EpubDocument::EpubDocument(const QString &fileName) : QTextDocument()
+EpubDocument::EpubDocument(const QString &fileName) : Okular::LazyImageTextDocument()
 {
   mEpub = epub_open(qPrintable(fileName), 3);
 }
@@ -51,10 +51,37 @@ void EpubDocument::setCurrentSubDocument(const QString &doc)
   mCurrentSubDocument = KUrl::fromPath("/" + doc);
 }
 
+QString EpubDocument::resolveUrl(const QString &url) const
+{
+  return resourceUrl(mCurrentSubDocument, url);
+}
+
+QByteArray EpubDocument::imageData(const QString &path) const
+{
+  char *data = 0;
+  const int size = epub_get_data(mEpub, path.toUtf8(), &data);
+
+  QByteArray bytes;
+  if (data) {
+    bytes = QByteArray(data, size);
+    free(data);
+  }
+
+  return bytes;
+}
+
+QString EpubDocument::imageName(const QUrl &url) const
+{
+  return resolveUrl(url.toString());
+}
+
 QVariant EpubDocument::loadResource(int type, const QUrl &name)
 {
+  if (type == QTextDocument::ImageResource)
+    return Okular::LazyImageTextDocument::loadResource(type, name);
+
   int size;
-  char *data;
+  char *data = 0;
 
   // Get the data from the epub file
   size = epub_get_data(mEpub, resourceUrl(mCurrentSubDocument, name.toString()).toUtf8(), &data);
@@ -62,16 +89,7 @@ QVariant EpubDocument::loadResource(int type, const QUrl &name)
   QVariant resource;
 
   if (data) {
-    switch(type) {
-    case QTextDocument::ImageResource:
-      resource.setValue(QImage::fromData((unsigned char *)data, size));
-      break;
-
-    default:
-      resource.setValue(QString::fromUtf8(data));
-      break;
-    }
-
+    resource.setValue(QString::fromUtf8(data));
     free(data);
   }
 
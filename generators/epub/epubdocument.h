@@ -10,16 +10,16 @@
 #ifndef EPUB_DOCUMENT_H
 #define EPUB_DOCUMENT_H
 
-#include <QTextDocument>
 #include <QUrl>
 #include <QVariant>
 #include <QImage>
 #include <kurl.h>
+#include <core/textdocumentgenerator.h>
 #include <epub.h>
 
 namespace Epub {
 
-  class EpubDocument : public QTextDocument {
+  class EpubDocument : public Okular::LazyImageTextDocument {
 
   public:
     EpubDocument(const QString &fileName);
@@ -28,7 +28,12 @@ namespace Epub {
     struct epub *getEpub();
     void setCurrentSubDocument(const QString &doc);
 
+    // the path in the epub of the url, relative to the current sub document
+    QString resolveUrl(const QString &url) const;
+
   protected:
+    virtual QByteArray imageData(const QString &path) const;
+    virtual QString imageName(const QUrl &url) const;
     virtual QVariant loadResource(int type, const QUrl &name);
 
   private:
@@ -10,6 +10,7 @@
 #include <stdlib.h>
 
 #include <QtCore/QFile>
+#include <QtCore/QVector>
 
 #include "faxexpand.h"
 #include "faxdocument.h"
@@ -62,7 +63,7 @@ static bool new_image( pagenode *pn, int width, int height )
     pn->image.setColor( 1, qRgb( 0, 0, 0 ) );
     pn->bytes_per_line = pn->image.bytesPerLine();
     pn->dpi = FAX_DPI_FINE;
-    pn->imageData = new uchar[ width * height ];
+    pn->imageData = new uchar[ pn->bytes_per_line * height ];
 
     return !pn->image.isNull();
 }
@@ -205,18 +206,24 @@ static void draw_line( pixnum *run, int lineNum, pagenode *pn )
     }
 }
 
-static bool get_image( struct pagenode *pn )
-{
-    unsigned char *data = getstrip( pn, 0 );
-    if ( !data )
-        return false;
+/* bit reversed value of each byte */
+static uchar reversed_bits[ 256 ];
 
-    if ( !new_image( pn, pn->size.width(), (pn->vres ? 1 : 2) * pn->size.height() ) )
-        return false;
-
-    (*pn->expander)( pn, draw_line );
+static void init_reversed_bits()
+{
+    static bool initialized = false;
+    if ( initialized )
+        return;
 
-    return true;
+    for ( int i = 0; i < 256; ++i )
+    {
+        uchar r = 0;
+        for ( int bit = 0; bit < 8; ++bit )
+            if ( i & ( 1 << bit ) )
+                r |= 0x80 >> bit;
+        reversed_bits[ i ] = r;
+    }
+    initialized = true;
 }
 
 class FaxDocument::Private
@@ -228,9 +235,16 @@ class FaxDocument::Private
             mPageNode.size = QSize( 1728, 0 );
         }
 
+        struct Page
+        {
+            size_t offset;  // in t16bits from the start of the data
+            int lines;
+        };
+
         FaxDocument *mParent;
         struct pagenode mPageNode;
         FaxDocument::DocumentType mType;
+        QVector< Page > mPages;
 };
 
 FaxDocument::FaxDocument( const QString &fileName, DocumentType type )
@@ -256,54 +270,109 @@ FaxDocument::FaxDocument( const QString &fileName, DocumentType type )
 FaxDocument::~FaxDocument()
 {
     delete [] d->mPageNode.dataOrig;
-    delete [] d->mPageNode.imageData;
     delete d;
 }
 
 bool FaxDocument::load()
 {
     fax_init_tables();
+    init_reversed_bits();
 
-    bool ok = get_image( &(d->mPageNode) );
-    if ( !ok )
+    // only the compressed data is kept in memory, the pages are decoded
+    // when asked for
+    pagenode *pn = &d->mPageNode;
+    if ( !getstrip( pn, 0 ) )
         return false;
 
-    // byte-swapping the image
-    int height = d->mPageNode.size.height();
-    int bytes_per_line = d->mPageNode.size.width()/8;
-
-    QByteArray bytes( height * bytes_per_line, 0 );
-    for ( int y= height - 1; y >= 0; --y )
+    // the pages of raw G3 files follow each other, each one ending with a
+    // RTC; G4 ones have only one page
+    if ( d->mType == G3 )
     {
-        quint32 offset  = y * bytes_per_line;
-        quint32 *source = (quint32 *) (d->mPageNode.imageData + offset);
-        quint32 *dest   = (quint32 *) (bytes.data() + offset);
-        for ( int x= (bytes_per_line/4) - 1; x >= 0; --x )
+        const int twoD = pn->expander == g32expand;
+        size_t offset = 0;
+        while ( offset * sizeof( t16bits ) < pn->length )
         {
-            quint32 dv = 0, sv = *source;
-            for ( int bit = 32; bit > 0; --bit )
-            {
-                dv <<= 1;
-                dv |= sv&1;
-                sv >>= 1;
-            }
-            *dest = dv;
-            ++dest;
-            ++source;
+            pagenode page = *pn;
+            page.data = pn->data + offset;
+            page.length = pn->length - offset * sizeof( t16bits );
+            size_t used = 0;
+            const int lines = G3countPage( &page, twoD, &used );
+            if ( lines <= 0 )
+                break;
+
+            Private::Page p;
+            p.offset = offset;
+            p.lines = lines;
+            d->mPages.append( p );
+
+            // the next page starts in the last word of the RTC
+            offset += qMax( size_t( 1 ), used / sizeof( t16bits ) - 1 );
         }
     }
 
-    // convert it into a QImage
-    QImage img( (uchar*)bytes.data(), d->mPageNode.size.width(), d->mPageNode.size.height(), QImage::Format_MonoLSB );
-    img.setColor( 0, qRgb( 255, 255, 255 ) );
-    img.setColor( 1, qRgb( 0, 0, 0 ) );
-
-    d->mPageNode.image = img.copy().scaled( img.width(), img.height() * 1.5 );
+    if ( d->mPages.isEmpty() )
+    {
+        Private::Page p;
+        p.offset = 0;
+        p.lines = pn->size.height();
+        d->mPages.append( p );
+    }
 
     return true;
 }
 
-QImage FaxDocument::image() const
+int FaxDocument::pageCount() const
+{
+    return d->mPages.count();
+}
+
+QSize FaxDocument::pageSize( int page ) const
 {
-    return d->mPageNode.image;
+    const int rows = ( d->mPageNode.vres ? 1 : 2 ) * d->mPages.at( page ).lines;
+    return QSize( d->mPageNode.size.width(), qRound( rows * 1.5 ) );
+}
+
+QImage FaxDocument::image( int page ) const
+{
+    if ( page < 0 || page >= d->mPages.count() )
+        return QImage();
+
+    // decode in a copy of the descriptor, so pages can be decoded at the same time
+    const Private::Page &p = d->mPages.at( page );
+    pagenode pn = d->mPageNode;
+    pn.data = d->mPageNode.data + p.offset;
+    pn.length = d->mPageNode.length - p.offset * sizeof( t16bits );
+    pn.size.setHeight( p.lines );
+    pn.rowsperstrip = p.lines;
+    pn.stripnum = 0;
+
+    const int rows = ( pn.vres ? 1 : 2 ) * p.lines;
+    if ( !new_image( &pn, pn.size.width(), rows ) )
+    {
+        delete [] pn.imageData;
+        return QImage();
+    }
+    memset( pn.imageData, 0, pn.bytes_per_line * rows );
+
+    (*pn.expander)( &pn, draw_line );
+
+    // the expander writes the pixels of each 32 bits word from the most
+    // significant bit, reverse them to get the LSB bit order of the image
+    const int words = pn.bytes_per_line / 4;
+    for ( int y = 0; y < rows; ++y )
+    {
+        const quint32 *source = (const quint32 *) ( pn.imageData + y * pn.bytes_per_line );
+        quint32 *dest = (quint32 *) pn.image.scanLine( y );
+        for ( int x = 0; x < words; ++x )
+        {
+            const quint32 sv = source[ x ];
+            dest[ x ] = ( (quint32)reversed_bits[ sv & 0xff ] << 24 )
+                      | ( (quint32)reversed_bits[ ( sv >> 8 ) & 0xff ] << 16 )
+                      | ( (quint32)reversed_bits[ ( sv >> 16 ) & 0xff ] << 8 )
+                      | (quint32)reversed_bits[ sv >> 24 ];
+        }
+    }
+    delete [] pn.imageData;
+
+    return pn.image;
 }
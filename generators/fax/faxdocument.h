@@ -48,9 +48,21 @@ class FaxDocument
     bool load();
 
     /**
-     * Returns the document as an image.
+     * Returns the number of pages of the document.
      */
-    QImage image() const;
+    int pageCount() const;
+
+    /**
+     * Returns the size of the @p page, with its aspect corrected.
+     */
+    QSize pageSize( int page ) const;
+
+    /**
+     * Decodes the @p page as an image.
+     *
+     * The image is not aspect corrected: it has to be scaled to pageSize().
+     */
+    QImage image( int page ) const;
 
   private:
     class Private;
@@ -742,3 +742,61 @@ G3count(struct pagenode *pn, int twoD)
     }
     return lines - EOLcnt;	/* don't count trailing EOLs */
 }
+
+#undef check
+#define check(v) do {							\
+    prezeros = zerotab[v];						\
+    postzeros = prezeros & 15;						\
+    prezeros >>= 4;							\
+    if (prezeros == 8) {						\
+	zeros += 8;							\
+	continue;							\
+    }									\
+    if (zeros + prezeros < 11) {					\
+	empty = 0;							\
+	zeros = postzeros;						\
+	continue;							\
+    }									\
+    zeros = postzeros;							\
+    if (empty)								\
+	EOLcnt++;							\
+    else {								\
+	if (lines)							\
+	    lines += EOLcnt;						\
+	lines++;							\
+	EOLcnt = 0;							\
+    }									\
+    empty = 1;								\
+} while (0)
+
+/* count the lines of the page starting at pn->data, up to its RTC (the
+   EOL ending its last line followed by 5 more EOLs); unlike G3count, any
+   EOL before the first line is skipped, so the data can start at the end
+   of the previous page.  *used is set to the bytes used up to the RTC */
+int
+G3countPage(struct pagenode *pn, int twoD, size_t *used)
+{
+    t16bits *p = pn->data;
+    t16bits *end = p + pn->length/sizeof(*p);
+    int lines = 0;		/* lines seen so far, up to the last non empty one */
+    int zeros = 0;		/* number of consecutive zero bits seen */
+    int EOLcnt = 0;		/* number of consecutive EOLs seen */
+    int empty = 1;		/* empty line */
+    int prezeros, postzeros;
+
+    while (p < end && (EOLcnt < 5 || !lines)) {
+	t16bits bits = *p++;
+	check(bits&255);
+	if (twoD && (prezeros + postzeros == 7)) {
+	    if (postzeros || ((bits & 0x100) == 0))
+		zeros--;
+	}
+	check(bits>>8);
+	if (twoD && (prezeros + postzeros == 7)) {
+	    if (postzeros || ((p < end) && ((*p & 1) == 0)))
+		zeros--;
+	}
+    }
+    *used = (p - pn->data) * sizeof(*p);
+    return lines;
+}
@@ -117,4 +117,7 @@ extern void fax_init_tables(void);
 /* count lines in image */
 extern int G3count(class pagenode *pn, int twoD);
 
+/* count lines in the page at the start of the data, and its size */
+extern int G3countPage(class pagenode *pn, int twoD, size_t *used);
+
 #endif
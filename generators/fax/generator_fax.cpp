@@ -18,6 +18,7 @@
 #include <klocale.h>
 
 #include <core/document.h>
+#include <core/fileprinter.h>
 #include <core/page.h>
 
 static KAboutData createAboutData()
@@ -39,7 +40,7 @@ static KAboutData createAboutData()
 OKULAR_EXPORT_PLUGIN( FaxGenerator, createAboutData() )
 
 FaxGenerator::FaxGenerator( QObject *parent, const QVariantList &args )
-    : Generator( parent, args )
+    : Generator( parent, args ), m_faxDocument( 0 ), m_lastPage( -1 ), m_docInfo( 0 )
 {
     setFeature( Threaded );
     setFeature( PrintNative );
@@ -58,20 +59,24 @@ bool FaxGenerator::loadDocument( const QString & fileName, QVector<Okular::Page*
     else
         type = FaxDocument::G4;
 
-    FaxDocument faxDocument( fileName, type );
+    m_faxDocument = new FaxDocument( fileName, type );
 
-    if ( !faxDocument.load() )
+    if ( !m_faxDocument->load() )
     {
+        delete m_faxDocument;
+        m_faxDocument = 0;
         emit error( i18n( "Unable to load document" ), -1 );
         return false;
     }
 
-    m_img = faxDocument.image();
+    const int pages = m_faxDocument->pageCount();
+    pagesVector.resize( pages );
 
-    pagesVector.resize( 1 );
-
-    Okular::Page * page = new Okular::Page( 0, m_img.width(), m_img.height(), Okular::Rotation0 );
-    pagesVector[0] = page;
+    for ( int i = 0; i < pages; ++i )
+    {
+        const QSize size = m_faxDocument->pageSize( i );
+        pagesVector[i] = new Okular::Page( i, size.width(), size.height(), Okular::Rotation0 );
+    }
 
     m_docInfo = new Okular::DocumentInfo();
     if ( type == FaxDocument::G3 )
@@ -84,22 +89,39 @@ bool FaxGenerator::loadDocument( const QString & fileName, QVector<Okular::Page*
 
 bool FaxGenerator::doCloseDocument()
 {
-    m_img = QImage();
+    m_lastImageMutex.lock();
+    m_lastImage = QImage();
+    m_lastPage = -1;
+    m_lastImageMutex.unlock();
+    delete m_faxDocument;
+    m_faxDocument = 0;
     delete m_docInfo;
     m_docInfo = 0;
 
     return true;
 }
 
+QImage FaxGenerator::pageImage( int page )
+{
+    QMutexLocker locker( &m_lastImageMutex );
+    if ( m_lastPage != page )
+    {
+        m_lastImage = m_faxDocument->image( page );
+        m_lastPage = page;
+    }
+    return m_lastImage;
+}
+
 QImage FaxGenerator::image( Okular::PixmapRequest * request )
 {
-    // perform a smooth scaled generation
+    // perform a smooth scaled generation, which corrects the aspect of the
+    // decoded image too
     int width = request->width();
     int height = request->height();
     if ( request->page()->rotation() % 2 == 1 )
         qSwap( width, height );
 
-    return m_img.scaled( width, height, Qt::IgnoreAspectRatio, Qt::SmoothTransformation );
+    return pageImage( request->pageNumber() ).scaled( width, height, Qt::IgnoreAspectRatio, Qt::SmoothTransformation );
 }
 
 const Okular::DocumentInfo * FaxGenerator::generateDocumentInfo()
@@ -111,14 +133,22 @@ bool FaxGenerator::print( QPrinter& printer )
 {
     QPainter p( &printer );
 
-    QImage image( m_img );
+    QList<int> pageList = Okular::FilePrinter::pageList( printer, document()->pages(),
+                                                         document()->currentPage() + 1,
+                                                         document()->bookmarkedPageList() );
 
-    if ( ( image.width() > printer.width() ) || ( image.height() > printer.height() ) )
+    for ( int i = 0; i < pageList.count(); ++i )
+    {
+        const int page = pageList.at( i ) - 1;
+        QSize size = m_faxDocument->pageSize( page );
+        if ( ( size.width() > printer.width() ) || ( size.height() > printer.height() ) )
+            size.scale( printer.width(), printer.height(), Qt::KeepAspectRatio );
 
-        image = image.scaled( printer.width(), printer.height(),
-                              Qt::KeepAspectRatio, Qt::SmoothTransformation );
+        if ( i != 0 )
+            printer.newPage();
 
-    p.drawImage( 0, 0, image );
+        p.drawImage( 0, 0, pageImage( page ).scaled( size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation ) );
+    }
 
     return true;
 }
@@ -12,8 +12,11 @@
 
 #include <core/generator.h>
 
+#include <QtCore/QMutex>
 #include <QtGui/QImage>
 
+class FaxDocument;
+
 class FaxGenerator : public Okular::Generator
 {
     Q_OBJECT
@@ -33,7 +36,13 @@ class FaxGenerator : public Okular::Generator
         QImage image( Okular::PixmapRequest * request );
 
     private:
-        QImage m_img;
+        QImage pageImage( int page );
+
+        FaxDocument *m_faxDocument;
+        // the last decoded page, usually requested again for the thumbnail
+        QImage m_lastImage;
+        int m_lastPage;
+        QMutex m_lastImageMutex;
         Okular::DocumentInfo *m_docInfo;
 };
 
@@ -11,10 +11,12 @@
 
 #include <QtCore/QDate>
 #include <QtCore/QUrl>
+#include <QtCore/QXmlStreamReader>
 #include <QtGui/QAbstractTextDocumentLayout>
 #include <QtGui/QTextCursor>
 #include <QtGui/QTextDocument>
 #include <QtGui/QTextFrame>
+#include <QtXml/QDomDocument>
 #include <QtXml/QDomElement>
 #include <QtXml/QDomText>
 
@@ -70,13 +72,12 @@ QTextDocument* Converter::convert( const QString &fileName )
         return false;
     }
 
-    mTextDocument = new QTextDocument;
+    mTextDocument = new TextDocument;
     mCursor = new QTextCursor( mTextDocument );
     mSectionCounter = 0;
     mLocalLinks.clear();
     mSectionMap.clear();
-
-    const QDomDocument document = fbDocument.content();
+    mImagePositions.clear();
 
     /**
      * Set the correct page size
@@ -92,34 +93,37 @@ QTextDocument* Converter::convert( const QString &fileName )
     /**
      * Parse the content of the document
      */
-    const QDomElement documentElement = document.documentElement();
+    QXmlStreamReader reader( fbDocument.content() );
 
-    if ( documentElement.tagName() != QLatin1String( "FictionBook" ) ) {
-        emit error( i18n( "Document is not a valid FictionBook" ), -1 );
+    if ( !reader.readNextStartElement() || reader.name() != QLatin1String( "FictionBook" ) ) {
+        if ( reader.hasError() )
+            emit error( i18n( "Invalid XML document: %1", reader.errorString() ), -1 );
+        else
+            emit error( i18n( "Document is not a valid FictionBook" ), -1 );
         delete mCursor;
         return false;
     }
 
     /**
-     * First we read all images, so we can calculate the size later.
+     * Read the elements one by one; the images get their size once all
+     * the binaries, which usually follow the bodies, are known.
      */
-    QDomElement element = documentElement.firstChildElement();
-    while ( !element.isNull() ) {
-        if ( element.tagName() == QLatin1String( "binary" ) ) {
-            if ( !convertBinary( element ) ) {
+    QDomDocument document;
+    while ( reader.readNextStartElement() ) {
+        if ( reader.name() == QLatin1String( "binary" ) ) {
+            if ( !convertBinary( reader ) ) {
                 delete mCursor;
                 return false;
             }
+            continue;
         }
 
-        element = element.nextSiblingElement();
-    }
+        if ( reader.name() != QLatin1String( "description" ) && reader.name() != QLatin1String( "body" ) ) {
+            reader.skipCurrentElement();
+            continue;
+        }
 
-    /**
-     * Read the rest...
-     */
-    element = documentElement.firstChildElement();
-    while ( !element.isNull() ) {
+        const QDomElement element = readDomElement( reader, document );
         if ( element.tagName() == QLatin1String( "description" ) ) {
             if ( !convertDescription( element ) ) {
                 delete mCursor;
@@ -168,10 +172,16 @@ QTextDocument* Converter::convert( const QString &fileName )
                 return false;
             }
         }
+    }
 
-        element = element.nextSiblingElement();
+    if ( reader.hasError() ) {
+        emit error( i18n( "Invalid XML document: %1", reader.errorString() ), -1 );
+        delete mCursor;
+        return false;
     }
 
+    setImageSizes();
+
     /**
      * Add document info.
      */
@@ -575,15 +585,12 @@ bool Converter::convertStyle( const QDomElement &element )
     return true;
 }
 
-bool Converter::convertBinary( const QDomElement &element )
+bool Converter::convertBinary( QXmlStreamReader &reader )
 {
-    const QString id = element.attribute( "id" );
+    const QString id = reader.attributes().value( "id" ).toString();
 
-    const QDomText textNode = element.firstChild().toText();
-    QByteArray data = textNode.data().toLatin1();
-    data = QByteArray::fromBase64( data );
-
-    mTextDocument->addResource( QTextDocument::ImageResource, QUrl( id ), QImage::fromData( data ) );
+    // the image is decoded only when it is painted
+    mTextDocument->addBinary( id, reader.readElementText().toLatin1() );
 
     return true;
 }
@@ -610,21 +617,43 @@ bool Converter::convertImage( const QDomElement &element )
     if ( href.startsWith( '#' ) )
         href = href.mid( 1 );
 
-    const QImage img = qVariantValue<QImage>( mTextDocument->resource( QTextDocument::ImageResource, QUrl( href ) ) );
-
     QTextImageFormat format;
     format.setName( href );
 
-    if ( img.width() > 560 )
-        format.setWidth( 560 );
-
-    format.setHeight( img.height() );
-
+    // the size is set by setImageSizes()
+    mImagePositions.append( mCursor->position() );
     mCursor->insertImage( format );
 
     return true;
 }
 
+void Converter::setImageSizes()
+{
+    QTextCursor cursor( mTextDocument );
+    foreach ( int position, mImagePositions ) {
+        cursor.setPosition( position );
+        cursor.setPosition( position + 1, QTextCursor::KeepAnchor );
+        QTextImageFormat format = cursor.charFormat().toImageFormat();
+
+        // with a size set the layout does not need to decode the image
+        QSize size = mTextDocument->imageSize( format.name() );
+        if ( size.isValid() ) {
+            if ( size.width() > 560 ) {
+                size.setHeight( size.height() * 560 / size.width() );
+                size.setWidth( 560 );
+            }
+
+            mTextDocument->setImageDisplaySize( format.name(), size );
+            format.setWidth( size.width() );
+            format.setHeight( size.height() );
+        } else {
+            format.setHeight( 0 );
+        }
+
+        cursor.setCharFormat( format );
+    }
+}
+
 bool Converter::convertEpigraph( const QDomElement &element )
 {
     QDomElement child = element.firstChildElement();
@@ -14,9 +14,18 @@
 
 class QDomElement;
 class QTextCursor;
+class QXmlStreamReader;
 
 namespace FictionBook {
 
+class TextDocument;
+
+/**
+ * The converter reads the book with a QXmlStreamReader: only one of the
+ * description and body elements at a time is turned into a DOM, while the
+ * binaries are kept as base64 data in the TextDocument, which decodes the
+ * images when they are painted.
+ */
 class Converter : public Okular::TextDocumentConverter
 {
     public:
@@ -31,7 +40,7 @@ class Converter : public Okular::TextDocumentConverter
         bool convertSection( const QDomElement &element );
         bool convertTitle( const QDomElement &element );
         bool convertParagraph( const QDomElement &element );
-        bool convertBinary( const QDomElement &element );
+        bool convertBinary( QXmlStreamReader &reader );
         bool convertCover( const QDomElement &element );
         bool convertImage( const QDomElement &element );
         bool convertEpigraph( const QDomElement &element );
@@ -55,7 +64,9 @@ class Converter : public Okular::TextDocumentConverter
         bool convertDate( const QDomElement &element, QDate &date );
         bool convertTextNode( const QDomElement &element, QString &data );
 
-        QTextDocument *mTextDocument;
+        void setImageSizes();
+
+        TextDocument *mTextDocument;
         QTextCursor *mCursor;
 
         class TitleInfo;
@@ -68,6 +79,7 @@ class Converter : public Okular::TextDocumentConverter
 
         QMap<QString, QTextBlock> mSectionMap;
         QMap<QString, QPair<int, int> > mLocalLinks;
+        QList<int> mImagePositions;
 };
 
 }
@@ -23,8 +23,6 @@ Document::Document( const QString &fileName )
 
 bool Document::open()
 {
-    QIODevice *device;
-
     QFile file( mFileName );
     KZip zip( mFileName );
     if ( mFileName.endsWith( ".fb" ) || mFileName.endsWith( ".fb2" ) ) {
@@ -33,7 +31,7 @@ bool Document::open()
             return false;
         }
 
-        device = &file;
+        mContent = file.readAll();
     } else {
         if ( !zip.open( QIODevice::ReadOnly ) ) {
             setError( i18n( "Document is not a valid ZIP archive" ) );
@@ -62,22 +60,15 @@ bool Document::open()
         }
 
         const KArchiveFile *entry = static_cast<const KArchiveFile*>( directory->entry( documentFile ) );
-        // FIXME delete 'deviceì somewhen
-        device = entry->createDevice();
-    }
-
-    QString errorMsg;
-    if ( !mDocument.setContent( device, true, &errorMsg ) ) {
-        setError( i18n( "Invalid XML document: %1", errorMsg ) );
-        return false;
+        mContent = entry->data();
     }
 
     return true;
 }
 
-QDomDocument Document::content() const
+QByteArray Document::content() const
 {
-    return mDocument;
+    return mContent;
 }
 
 QString Document::lastErrorString() const
@@ -89,3 +80,13 @@ void Document::setError( const QString &error )
 {
     mErrorString = error;
 }
+
+void TextDocument::addBinary( const QString &id, const QByteArray &base64Data )
+{
+    mBinaries.insert( id, base64Data );
+}
+
+QByteArray TextDocument::imageData( const QString &id ) const
+{
+    return QByteArray::fromBase64( mBinaries.value( id ) );
+}
@@ -11,9 +11,10 @@
 #define FICTIONBOOK_DOCUMENT_H
 
 #include <QtCore/QByteArray>
-#include <QtCore/QMap>
+#include <QtCore/QHash>
 #include <QtCore/QString>
-#include <QtXml/QDomDocument>
+
+#include <core/textdocumentgenerator.h>
 
 namespace FictionBook {
 
@@ -24,7 +25,7 @@ class Document
 
         bool open();
 
-        QDomDocument content() const;
+        QByteArray content() const;
 
         QString lastErrorString() const;
 
@@ -32,10 +33,28 @@ class Document
         void setError( const QString& );
 
         QString mFileName;
-        QDomDocument mDocument;
+        QByteArray mContent;
         QString mErrorString;
 };
 
+/**
+ * The text document a FictionBook is converted to.
+ *
+ * It keeps the base64 data of the binaries of the book, the images being
+ * named by the id of their binary.
+ */
+class TextDocument : public Okular::LazyImageTextDocument
+{
+    public:
+        void addBinary( const QString &id, const QByteArray &base64Data );
+
+    protected:
+        virtual QByteArray imageData( const QString &id ) const;
+
+    private:
+        QHash<QString, QByteArray> mBinaries;
+};
+
 }
 
 #endif
@@ -12,6 +12,7 @@
 #include "generator_kimgio.h"
 
 #include <QtCore/QBuffer>
+#include <QtGui/QImageIOHandler>
 #include <QtGui/QImageReader>
 #include <QtGui/QPainter>
 #include <QtGui/QPrinter>
@@ -19,12 +20,18 @@
 #include <kaboutdata.h>
 #include <kaction.h>
 #include <kactioncollection.h>
+#include <kdebug.h>
 #include <kicon.h>
 #include <kimageio.h>
 #include <klocale.h>
 
 #include <core/page.h>
 
+static const int KIMGIODebug = 4700;
+
+// the memory the levels of the image can use, besides the one being used
+static const int MaxLevelsBytes = 64 * 1024 * 1024;
+
 static KAboutData createAboutData()
 {
     KAboutData aboutData(
@@ -47,7 +54,7 @@ static KAboutData createAboutData()
 OKULAR_EXPORT_PLUGIN( KIMGIOGenerator, createAboutData() )
 
 KIMGIOGenerator::KIMGIOGenerator( QObject *parent, const QVariantList &args )
-    : Generator( parent, args )
+    : Generator( parent, args ), m_scaledDecode( false )
 {
     setFeature( ReadRawData );
     setFeature( Threaded );
@@ -74,18 +81,15 @@ bool KIMGIOGenerator::loadDocument( const QString & fileName, QVector<Okular::Pa
 {
     const QString mime = KMimeType::findByFileContent(fileName)->name();
     const QStringList types = KImageIO::typeForMime(mime);
-    const QByteArray type = !types.isEmpty() ? types[0].toAscii() : QByteArray();
-    QImageReader reader( fileName, type );
-    if ( !reader.read( &m_img ) ) {
-        emit error( i18n( "Unable to load document: %1", reader.errorString() ), -1 );
+    m_type = !types.isEmpty() ? types[0].toAscii() : QByteArray();
+    QImageReader reader( fileName, m_type );
+    // the image is decoded again when a level was dropped
+    m_fileName = fileName;
+    if ( !loadImage( reader, mime, pagesVector ) )
+    {
+        m_fileName.clear();
         return false;
     }
-    docInfo.set( Okular::DocumentInfo::MimeType, mime );
-
-    pagesVector.resize( 1 );
-
-    Okular::Page * page = new Okular::Page( 0, m_img.width(), m_img.height(), Okular::Rotation0 );
-    pagesVector[0] = page;
 
     return true;
 }
@@ -94,22 +98,61 @@ bool KIMGIOGenerator::loadDocumentFromData( const QByteArray & fileData, QVector
 {
     const QString mime = KMimeType::findByContent(fileData)->name();
     const QStringList types = KImageIO::typeForMime(mime);
-    const QByteArray type = !types.isEmpty() ? types[0].toAscii() : QByteArray();
+    m_type = !types.isEmpty() ? types[0].toAscii() : QByteArray();
     
     QBuffer buffer;
     buffer.setData( fileData );
     buffer.open( QIODevice::ReadOnly );
 
-    QImageReader reader( &buffer, type );
-    if ( !reader.read( &m_img ) ) {
-        emit error( i18n( "Unable to load document: %1", reader.errorString() ), -1 );
+    QImageReader reader( &buffer, m_type );
+    m_data = fileData;
+    if ( !loadImage( reader, mime, pagesVector ) )
+    {
+        m_data.clear();
         return false;
     }
+
+    return true;
+}
+
+bool KIMGIOGenerator::loadImage( QImageReader &reader, const QString &mime, QVector<Okular::Page*> & pagesVector )
+{
+    // formats like JPEG can be decoded directly at a smaller size, much
+    // faster than decoding them whole: only read their size for now
+    m_size = reader.size();
+    m_scaledDecode = m_size.isValid() && reader.supportsOption( QImageIOHandler::ScaledSize );
+    if ( m_scaledDecode )
+    {
+        // still make sure the image can be decoded, with its smallest level
+        int level = 0;
+        while ( qMax( m_size.width(), m_size.height() ) >> ( level + 1 ) >= 32 )
+            ++level;
+        QString errorString;
+        const QImage img = decode( QSize( qMax( 1, m_size.width() >> level ), qMax( 1, m_size.height() >> level ) ), &errorString );
+        if ( img.isNull() ) {
+            emit error( i18n( "Unable to load document: %1", errorString ), -1 );
+            m_scaledDecode = false;
+            m_size = QSize();
+            return false;
+        }
+        m_levels.resize( level + 1 );
+        m_levels[ level ] = img;
+    }
+    else
+    {
+        QImage img;
+        if ( !reader.read( &img ) ) {
+            emit error( i18n( "Unable to load document: %1", reader.errorString() ), -1 );
+            return false;
+        }
+        m_size = img.size();
+        m_levels.append( img );
+    }
     docInfo.set( Okular::DocumentInfo::MimeType, mime );
 
     pagesVector.resize( 1 );
 
-    Okular::Page * page = new Okular::Page( 0, m_img.width(), m_img.height(), Okular::Rotation0 );
+    Okular::Page * page = new Okular::Page( 0, m_size.width(), m_size.height(), Okular::Rotation0 );
     pagesVector[0] = page;
 
     return true;
@@ -117,11 +160,105 @@ bool KIMGIOGenerator::loadDocumentFromData( const QByteArray & fileData, QVector
 
 bool KIMGIOGenerator::doCloseDocument()
 {
-    m_img = QImage();
+    QMutexLocker locker( &m_levelsMutex );
+    m_levels.clear();
+    m_fileName.clear();
+    m_data.clear();
+    m_type.clear();
+    m_scaledDecode = false;
+    m_size = QSize();
 
     return true;
 }
 
+QImage KIMGIOGenerator::decode( const QSize &size, QString *errorString ) const
+{
+    QImage img;
+    QBuffer buffer;
+    QImageReader reader;
+    if ( !m_fileName.isEmpty() )
+    {
+        reader.setFileName( m_fileName );
+    }
+    else
+    {
+        buffer.setData( m_data );
+        buffer.open( QIODevice::ReadOnly );
+        reader.setDevice( &buffer );
+    }
+    reader.setFormat( m_type );
+    if ( size != m_size )
+        reader.setScaledSize( size );
+    if ( !reader.read( &img ) )
+    {
+        kDebug(KIMGIODebug) << "Unable to decode the image:" << reader.errorString();
+        if ( errorString )
+            *errorString = reader.errorString();
+    }
+    return img;
+}
+
+QImage KIMGIOGenerator::pyramidLevel( int level )
+{
+    if ( level < m_levels.count() && !m_levels.at( level ).isNull() )
+        return m_levels.at( level );
+
+    if ( m_levels.count() <= level )
+        m_levels.resize( level + 1 );
+
+    const QSize size( qMax( 1, m_size.width() >> level ), qMax( 1, m_size.height() >> level ) );
+    QImage img;
+    if ( m_scaledDecode || level == 0 )
+    {
+        img = decode( size );
+    }
+    else
+    {
+        // halving a level at a time keeps the smooth scaling cheap, and
+        // leaves all the intermediate levels for the next requests
+        img = pyramidLevel( level - 1 ).scaled( size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation );
+    }
+    m_levels[ level ] = img;
+    return img;
+}
+
+void KIMGIOGenerator::trimLevels( int keep )
+{
+    // drop the biggest levels first, they use most of the memory
+    qint64 bytes = 0;
+    for ( int i = 0; i < m_levels.count(); ++i )
+        if ( i != keep )
+            bytes += m_levels.at( i ).byteCount();
+
+    for ( int i = 0; i < m_levels.count() && bytes > MaxLevelsBytes; ++i )
+    {
+        if ( i == keep || m_levels.at( i ).isNull() )
+            continue;
+        bytes -= m_levels.at( i ).byteCount();
+        m_levels[ i ] = QImage();
+    }
+}
+
+QImage KIMGIOGenerator::scaledImage( int width, int height )
+{
+    // start from the smallest level still not smaller than the request
+    int level = 0;
+    while ( ( m_size.width() >> ( level + 1 ) ) >= width && ( m_size.height() >> ( level + 1 ) ) >= height )
+        ++level;
+
+    QImage img;
+    {
+        QMutexLocker locker( &m_levelsMutex );
+        img = pyramidLevel( level );
+        trimLevels( level );
+    }
+
+    if ( img.isNull() || ( img.width() == width && img.height() == height ) )
+        return img;
+
+    return img.scaled( width, height, Qt::IgnoreAspectRatio, Qt::SmoothTransformation );
+}
+
 QImage KIMGIOGenerator::image( Okular::PixmapRequest * request )
 {
     // perform a smooth scaled generation
@@ -130,19 +267,18 @@ QImage KIMGIOGenerator::image( Okular::PixmapRequest * request )
     if ( request->page()->rotation() % 2 == 1 )
         qSwap( width, height );
 
-    return m_img.scaled( width, height, Qt::IgnoreAspectRatio, Qt::SmoothTransformation );
+    return scaledImage( width, height );
 }
 
 bool KIMGIOGenerator::print( QPrinter& printer )
 {
     QPainter p( &printer );
 
-    QImage image( m_img );
-
-    if ( ( image.width() > printer.width() ) || ( image.height() > printer.height() ) )
+    QSize size = m_size;
+    if ( ( size.width() > printer.width() ) || ( size.height() > printer.height() ) )
+        size.scale( printer.width(), printer.height(), Qt::KeepAspectRatio );
 
-        image = image.scaled( printer.width(), printer.height(),
-                              Qt::KeepAspectRatio, Qt::SmoothTransformation );
+    const QImage image = scaledImage( size.width(), size.height() );
 
     p.drawImage( 0, 0, image );
 
@@ -13,8 +13,12 @@
 #include <core/generator.h>
 #include <core/document.h>
 
+#include <QtCore/QMutex>
+#include <QtCore/QVector>
 #include <QtGui/QImage>
 
+class QImageReader;
+
 class KIMGIOGenerator : public Okular::Generator
 {
     Q_OBJECT
@@ -40,7 +44,22 @@ class KIMGIOGenerator : public Okular::Generator
         void slotTest();
 
     private:
-        QImage m_img;
+        bool loadImage( QImageReader &reader, const QString &mime, QVector<Okular::Page*> & pagesVector );
+        QImage scaledImage( int width, int height );
+        QImage pyramidLevel( int level );
+        void trimLevels( int keep );
+        QImage decode( const QSize &size, QString *errorString = 0 ) const;
+
+        // source of the image, decoded again for the dropped levels
+        QString m_fileName;
+        QByteArray m_data;
+        QByteArray m_type;
+        bool m_scaledDecode;
+        QSize m_size;
+        // level i is the image at 1/2^i of its size, built when needed and
+        // dropped, biggest first, past MaxLevelsBytes
+        QVector< QImage > m_levels;
+        QMutex m_levelsMutex;
         Okular::DocumentInfo docInfo;
 };
 
@@ -9,16 +9,15 @@
 
 #include "converter.h"
 
-#include <QtCore/QQueue>
 #include <QtCore/QUrl>
+#include <QtCore/QXmlStreamReader>
 #include <QtGui/QTextCursor>
 #include <QtGui/QTextDocument>
 #include <QtGui/QTextFrame>
 #include <QtGui/QTextList>
-#include <QtGui/QTextTableCell>
+#include <QtGui/QTextTable>
+#include <QtXml/QDomDocument>
 #include <QtXml/QDomElement>
-#include <QtXml/QDomText>
-#include <QtXml/QXmlSimpleReader>
 
 #include <core/action.h>
 #include <core/annotations.h>
@@ -62,8 +61,23 @@ QTextCharFormat Style::textFormat() const
   return mTextFormat;
 }
 
+/**
+ * Returns the attribute of the current element of the @p reader with the
+ * local @p name, whatever its namespace (like the DOM did).
+ */
+static QString attribute( const QXmlStreamReader &reader, const QString &name, const QString &defaultValue = QString() )
+{
+  const QXmlStreamAttributes attributes = reader.attributes();
+  for ( int i = 0; i < attributes.count(); ++i ) {
+    if ( attributes.at( i ).name() == name )
+      return attributes.at( i ).value().toString();
+  }
+
+  return defaultValue;
+}
+
 Converter::Converter()
-  : mTextDocument( 0 ), mCursor( 0 ),
+  : mTextDocument( 0 ), mCursor( 0 ), mReader( 0 ),
     mStyleInformation( 0 )
 {
 }
@@ -72,6 +86,12 @@ Converter::~Converter()
 {
 }
 
+bool Converter::needsInteraction( const QString &fileName ) const
+{
+  // the password of an encrypted document is asked with a dialog
+  return Document( fileName ).isEncrypted();
+}
+
 QTextDocument* Converter::convert( const QString &fileName )
 {
   Document oooDocument( fileName );
@@ -82,46 +102,105 @@ QTextDocument* Converter::convert( const QString &fileName )
 
   mTextDocument = new QTextDocument;
   mCursor = new QTextCursor( mTextDocument );
+  mStyleInformation = new StyleInformation();
+  mImages = oooDocument.images();
 
-  /**
-   * Create the dom of the content
-   */
-  QXmlSimpleReader reader;
+  QXmlStreamReader reader( oooDocument.content() );
+  mReader = &reader;
 
-  QXmlInputSource source;
-  source.setData( oooDocument.content() );
+  const bool converted = convertContent( &oooDocument );
 
-  QString errorMsg;
-  QDomDocument document;
-  if ( !document.setContent( &source, &reader, &errorMsg ) ) {
-    emit error( i18n( "Invalid XML document: %1", errorMsg ), -1 );
-    delete mCursor;
-    return false;
+  mReader = 0;
+  mImages.clear();
+  delete mCursor;
+  mCursor = 0;
+
+  if ( converted ) {
+    MetaInformation::List metaInformation = mStyleInformation->metaInformation();
+    for ( int i = 0; i < metaInformation.count(); ++i ) {
+      emit addMetaData( metaInformation[ i ].key(),
+                        metaInformation[ i ].value(),
+                        metaInformation[ i ].title() );
+    }
   }
 
-  mStyleInformation = new StyleInformation();
+  delete mStyleInformation;
+  mStyleInformation = 0;
+
+  if ( !converted ) {
+    delete mTextDocument;
+    mTextDocument = 0;
+  }
+
+  return mTextDocument;
+}
 
+bool Converter::convertContent( Document *document )
+{
   /**
-   * Read the style properties, so the are available when
-   * parsing the content.
+   * The style elements come before the body in the content, so they are
+   * read (into a small DOM each) and parsed as they come; the body is then
+   * converted while it is read.
    */
-  StyleParser styleParser( &oooDocument, document, mStyleInformation );
-  if ( !styleParser.parse() ) {
+  StyleParser styleParser( document, mStyleInformation );
+  QDomDocument styleDocument;
+  bool stylesDone = false;
+
+  while ( !mReader->atEnd() && !mReader->isStartElement() )
+    mReader->readNext();
+
+  while ( !mReader->atEnd() ) {
+    mReader->readNext();
+    if ( mReader->isEndElement() )
+      break;
+    if ( !mReader->isStartElement() )
+      continue;
+
+    if ( mReader->name() == QLatin1String( "body" ) ) {
+      if ( !stylesDone ) {
+        if ( !setupStyles( &styleParser ) ) {
+          emit error( i18n( "Unable to read style information" ), -1 );
+          return false;
+        }
+        stylesDone = true;
+      }
+
+      if ( !convertBody() ) {
+        emit error( i18n( "Unable to convert document content" ), -1 );
+        return false;
+      }
+    } else if ( !stylesDone ) {
+      QDomElement element = readDomElement( *mReader, styleDocument );
+      if ( !styleParser.parseContentElement( element ) ) {
+        emit error( i18n( "Unable to read style information" ), -1 );
+        return false;
+      }
+    } else {
+      mReader->skipCurrentElement();
+    }
+  }
+
+  if ( mReader->hasError() ) {
+    emit error( i18n( "Invalid XML document: %1", mReader->errorString() ), -1 );
+    return false;
+  }
+
+  if ( !stylesDone && !setupStyles( &styleParser ) ) {
     emit error( i18n( "Unable to read style information" ), -1 );
-    delete mCursor;
     return false;
   }
 
+  return true;
+}
+
+bool Converter::setupStyles( StyleParser *styleParser )
+{
   /**
-   * Add all images of the document to resource framework
+   * Read the style properties, so the are available when
+   * parsing the content.
    */
-  const QMap<QString, QByteArray> images = oooDocument.images();
-  QMapIterator<QString, QByteArray> it( images );
-  while ( it.hasNext() ) {
-    it.next();
-
-    mTextDocument->addResource( QTextDocument::ImageResource, QUrl( it.key() ), QImage::fromData( it.value() ) );
-  }
+  if ( !styleParser->parse() )
+    return false;
 
   /**
    * Set the correct page size
@@ -145,82 +224,64 @@ QTextDocument* Converter::convert( const QString &fileName )
   QTextFrame *rootFrame = mTextDocument->rootFrame();
   rootFrame->setFrameFormat( frameFormat );
 
-  /**
-   * Parse the content of the document
-   */
-  const QDomElement documentElement = document.documentElement();
-
-  QDomElement element = documentElement.firstChildElement();
-  while ( !element.isNull() ) {
-    if ( element.tagName() == QLatin1String( "body" ) ) {
-      if ( !convertBody( element ) ) {
-        emit error( i18n( "Unable to convert document content" ), -1 );
-        delete mCursor;
-        return false;
-      }
-    }
-
-    element = element.nextSiblingElement();
-  }
-
-  MetaInformation::List metaInformation = mStyleInformation->metaInformation();
-  for ( int i = 0; i < metaInformation.count(); ++i ) {
-    emit addMetaData( metaInformation[ i ].key(),
-                      metaInformation[ i ].value(),
-                      metaInformation[ i ].title() );
-  }
-
-  delete mCursor;
-  delete mStyleInformation;
-  mStyleInformation = 0;
-
-  return mTextDocument;
+  return true;
 }
 
-bool Converter::convertBody( const QDomElement &element )
+bool Converter::convertBody()
 {
-  QDomElement child = element.firstChildElement();
-  while ( !child.isNull() ) {
-    if ( child.tagName() == QLatin1String( "text" ) ) {
-      if ( !convertText( child ) )
+  while ( !mReader->atEnd() ) {
+    mReader->readNext();
+    if ( mReader->isEndElement() )
+      break;
+    if ( !mReader->isStartElement() )
+      continue;
+
+    if ( mReader->name() == QLatin1String( "text" ) ) {
+      if ( !convertText() )
         return false;
+    } else {
+      mReader->skipCurrentElement();
     }
-
-    child = child.nextSiblingElement();
   }
 
-  return true;
+  return !mReader->hasError();
 }
 
-bool Converter::convertText( const QDomElement &element )
+bool Converter::convertText()
 {
-  QDomElement child = element.firstChildElement();
-  while ( !child.isNull() ) {
-    if ( child.tagName() == QLatin1String( "p" ) ) {
+  while ( !mReader->atEnd() ) {
+    mReader->readNext();
+    if ( mReader->isEndElement() )
+      break;
+    if ( !mReader->isStartElement() )
+      continue;
+
+    if ( mReader->name() == QLatin1String( "p" ) ) {
       mCursor->insertBlock();
-      if ( !convertParagraph( mCursor, child ) )
+      if ( !convertParagraph( mCursor ) )
         return false;
-    } else if ( child.tagName() == QLatin1String( "h" ) ) {
+    } else if ( mReader->name() == QLatin1String( "h" ) ) {
       mCursor->insertBlock();
-      if ( !convertHeader( mCursor, child ) )
+      if ( !convertHeader( mCursor ) )
         return false;
-    } else if ( child.tagName() == QLatin1String( "list" ) ) {
-      if ( !convertList( mCursor, child ) )
+    } else if ( mReader->name() == QLatin1String( "list" ) ) {
+      if ( !convertList( mCursor ) )
         return false;
-    } else if ( child.tagName() == QLatin1String( "table" ) ) {
-      if ( !convertTable( child ) )
+    } else if ( mReader->name() == QLatin1String( "table" ) ) {
+      if ( !convertTable() )
         return false;
+    } else {
+      mReader->skipCurrentElement();
     }
-
-    child = child.nextSiblingElement();
   }
 
-  return true;
+  return !mReader->hasError();
 }
 
-bool Converter::convertHeader( QTextCursor *cursor, const QDomElement &element )
+bool Converter::convertHeader( QTextCursor *cursor )
 {
-  const QString styleName = element.attribute( "style-name" );
+  const QString styleName = attribute( *mReader, "style-name" );
+  const int outlineLevel = attribute( *mReader, "outline-level", "0" ).toInt();
   const StyleFormatProperty property = mStyleInformation->styleProperty( styleName );
 
   QTextBlockFormat blockFormat;
@@ -230,31 +291,37 @@ bool Converter::convertHeader( QTextCursor *cursor, const QDomElement &element )
 
   cursor->setBlockFormat( blockFormat );
 
-  QDomNode child = element.firstChild();
-  while ( !child.isNull() ) {
-    if ( child.isElement() ) {
-      const QDomElement childElement = child.toElement();
-      if ( childElement.tagName() == QLatin1String( "span" ) ) {
-        if ( !convertSpan( cursor, childElement, textFormat ) )
+  QString title;
+  while ( !mReader->atEnd() ) {
+    mReader->readNext();
+    if ( mReader->isEndElement() )
+      break;
+
+    if ( mReader->isStartElement() ) {
+      if ( mReader->name() == QLatin1String( "span" ) ) {
+        const int position = cursor->position();
+        if ( !convertSpan( cursor, textFormat ) )
           return false;
+        title += cursor->block().text().mid( position - cursor->block().position() );
+      } else {
+        title += mReader->readElementText( QXmlStreamReader::IncludeChildElements );
       }
-    } else if ( child.isText() ) {
-      const QDomText childText = child.toText();
-      if ( !convertTextNode( cursor, childText, textFormat ) )
+    } else if ( mReader->isCharacters() ) {
+      const QString text = mReader->text().toString();
+      if ( !convertTextNode( cursor, text, textFormat ) )
         return false;
+      title += text;
     }
-
-    child = child.nextSibling();
   }
 
-  emit addTitle( element.attribute( "outline-level", 0 ).toInt(), element.text(), cursor->block() );
+  emit addTitle( outlineLevel, title, cursor->block() );
 
-  return true;
+  return !mReader->hasError();
 }
 
-bool Converter::convertParagraph( QTextCursor *cursor, const QDomElement &element, const QTextBlockFormat &parentFormat, bool merge )
+bool Converter::convertParagraph( QTextCursor *cursor, const QTextBlockFormat &parentFormat, bool merge )
 {
-  const QString styleName = element.attribute( "style-name" );
+  const QString styleName = attribute( *mReader, "style-name" );
   const StyleFormatProperty property = mStyleInformation->styleProperty( styleName );
 
   QTextBlockFormat blockFormat( parentFormat );
@@ -267,73 +334,78 @@ bool Converter::convertParagraph( QTextCursor *cursor, const QDomElement &elemen
   else
     cursor->setBlockFormat( blockFormat );
 
-  QDomNode child = element.firstChild();
-  while ( !child.isNull() ) {
-    if ( child.isElement() ) {
-      const QDomElement childElement = child.toElement();
-      if ( childElement.tagName() == QLatin1String( "span" ) ) {
-        if ( !convertSpan( cursor, childElement, textFormat ) )
+  while ( !mReader->atEnd() ) {
+    mReader->readNext();
+    if ( mReader->isEndElement() )
+      break;
+
+    if ( mReader->isStartElement() ) {
+      if ( mReader->name() == QLatin1String( "span" ) ) {
+        if ( !convertSpan( cursor, textFormat ) )
           return false;
-      } else if ( childElement.tagName() == QLatin1String( "tab" ) ) {
+      } else if ( mReader->name() == QLatin1String( "tab" ) ) {
         mCursor->insertText( "    " );
-      } else if ( childElement.tagName() == QLatin1String( "s" ) ) {
+        mReader->skipCurrentElement();
+      } else if ( mReader->name() == QLatin1String( "s" ) ) {
         QString spaces;
-        spaces.fill( ' ', childElement.attribute( "c" ).toInt() );
+        spaces.fill( ' ', attribute( *mReader, "c" ).toInt() );
         mCursor->insertText( spaces );
-      } else if ( childElement.tagName() == QLatin1String( "frame" ) ) {
-        if ( !convertFrame( childElement ) )
+        mReader->skipCurrentElement();
+      } else if ( mReader->name() == QLatin1String( "frame" ) ) {
+        if ( !convertFrame() )
           return false;
-      } else if ( childElement.tagName() == QLatin1String( "a" ) ) {
-        if ( !convertLink( cursor, childElement, textFormat ) )
+      } else if ( mReader->name() == QLatin1String( "a" ) ) {
+        if ( !convertLink( cursor, textFormat ) )
           return false;
-      } else if ( childElement.tagName() == QLatin1String( "annotation" ) ) {
-        if ( !convertAnnotation( cursor, childElement ) )
+      } else if ( mReader->name() == QLatin1String( "annotation" ) ) {
+        if ( !convertAnnotation( cursor ) )
           return false;
+      } else {
+        mReader->skipCurrentElement();
       }
-    } else if ( child.isText() ) {
-      const QDomText childText = child.toText();
-      if ( !convertTextNode( cursor, childText, textFormat ) )
+    } else if ( mReader->isCharacters() ) {
+      if ( !convertTextNode( cursor, mReader->text().toString(), textFormat ) )
         return false;
     }
-
-    child = child.nextSibling();
   }
 
-  return true;
+  return !mReader->hasError();
 }
 
-bool Converter::convertTextNode( QTextCursor *cursor, const QDomText &element, const QTextCharFormat &format )
+bool Converter::convertTextNode( QTextCursor *cursor, const QString &text, const QTextCharFormat &format )
 {
-  cursor->insertText( element.data(), format );
+  cursor->insertText( text, format );
 
   return true;
 }
 
-bool Converter::convertSpan( QTextCursor *cursor, const QDomElement &element, const QTextCharFormat &format )
+bool Converter::convertSpan( QTextCursor *cursor, const QTextCharFormat &format )
 {
-  const QString styleName = element.attribute( "style-name" );
+  const QString styleName = attribute( *mReader, "style-name" );
   const StyleFormatProperty property = mStyleInformation->styleProperty( styleName );
 
   QTextCharFormat textFormat( format );
   property.applyText( &textFormat );
 
-  QDomNode child = element.firstChild();
-  while ( !child.isNull() ) {
-    if ( child.isText() ) {
-      const QDomText childText = child.toText();
-      if ( !convertTextNode( cursor, childText, textFormat ) )
+  while ( !mReader->atEnd() ) {
+    mReader->readNext();
+    if ( mReader->isEndElement() )
+      break;
+
+    if ( mReader->isStartElement() ) {
+      mReader->skipCurrentElement();
+    } else if ( mReader->isCharacters() ) {
+      if ( !convertTextNode( cursor, mReader->text().toString(), textFormat ) )
         return false;
     }
-
-    child = child.nextSibling();
   }
 
-  return true;
+  return !mReader->hasError();
 }
 
-bool Converter::convertList( QTextCursor *cursor, const QDomElement &element )
+bool Converter::convertList( QTextCursor *cursor )
 {
-  const QString styleName = element.attribute( "style-name" );
+  const QString styleName = attribute( *mReader, "style-name" );
   const ListFormatProperty property = mStyleInformation->listProperty( styleName );
 
   QTextListFormat format;
@@ -347,214 +419,254 @@ bool Converter::convertList( QTextCursor *cursor, const QDomElement &element )
 
   QTextList *list = cursor->insertList( format );
 
-  QDomElement itemChild = element.firstChildElement();
   int loop = 0;
-  while ( !itemChild.isNull() ) {
-    if ( itemChild.tagName() == QLatin1String( "list-item" ) ) {
-      loop++;
+  while ( !mReader->atEnd() ) {
+    mReader->readNext();
+    if ( mReader->isEndElement() )
+      break;
+    if ( !mReader->isStartElement() )
+      continue;
 
-      QDomElement childElement = itemChild.firstChildElement();
-      while ( !childElement.isNull() ) {
+    if ( mReader->name() != QLatin1String( "list-item" ) ) {
+      mReader->skipCurrentElement();
+      continue;
+    }
 
-        QTextBlock prevBlock;
+    loop++;
 
-        if ( childElement.tagName() == QLatin1String( "p" ) ) {
-          if ( loop > 1 )
-            cursor->insertBlock();
+    while ( !mReader->atEnd() ) {
+      mReader->readNext();
+      if ( mReader->isEndElement() )
+        break;
+      if ( !mReader->isStartElement() )
+        continue;
 
-          prevBlock = cursor->block();
+      QTextBlock prevBlock;
 
-          if ( !convertParagraph( cursor, childElement, QTextBlockFormat(), true ) )
-            return false;
+      if ( mReader->name() == QLatin1String( "p" ) ) {
+        if ( loop > 1 )
+          cursor->insertBlock();
 
-        } else if ( childElement.tagName() == QLatin1String( "list" ) ) {
-          prevBlock = cursor->block();
+        prevBlock = cursor->block();
 
-          if ( !convertList( cursor, childElement ) )
-            return false;
-        }
+        if ( !convertParagraph( cursor, QTextBlockFormat(), true ) )
+          return false;
 
-        if( prevBlock.isValid() )
-            list->add( prevBlock );
+      } else if ( mReader->name() == QLatin1String( "list" ) ) {
+        prevBlock = cursor->block();
 
-        childElement = childElement.nextSiblingElement();
+        if ( !convertList( cursor ) )
+          return false;
+      } else {
+        mReader->skipCurrentElement();
       }
-    }
 
-    itemChild = itemChild.nextSiblingElement();
+      if( prevBlock.isValid() )
+          list->add( prevBlock );
+    }
   }
 
-  return true;
-}
-
-static void enqueueNodeList( QQueue<QDomNode> &queue, const QDomNodeList &list )
-{
-  for ( int i = 0; i < list.count(); ++i ) {
-    queue.enqueue( list.at( i ) );
-  }
+  return !mReader->hasError();
 }
 
-bool Converter::convertTable( const QDomElement &element )
+bool Converter::convertTable()
 {
   /**
-   * Find out dimension of the table
+   * Create the table with a single cell, and let it grow while the rows
+   * and the cells are read
    */
-  int rowCounter = 0;
-  int columnCounter = 0;
+  QTextTable *table = mCursor->insertTable( 1, 1 );
+  mCursor->movePosition( QTextCursor::End );
+
+  QTextTableFormat tableFormat;
 
-  QQueue<QDomNode> nodeQueue;
-  enqueueNodeList( nodeQueue, element.childNodes() );
-  while ( !nodeQueue.isEmpty() ) {
-    QDomElement el = nodeQueue.dequeue().toElement();
-    if ( el.isNull() )
+  int rowCounter = 0;
+  while ( !mReader->atEnd() ) {
+    mReader->readNext();
+    if ( mReader->isEndElement() )
+      break;
+    if ( !mReader->isStartElement() )
       continue;
 
-    if ( el.tagName() == QLatin1String( "table-row" ) ) {
+    if ( mReader->name() == QLatin1String( "table-row" ) ) {
+      if ( !convertTableRow( table, rowCounter ) )
+        return false;
       rowCounter++;
-
-      int counter = 0;
-      QDomElement columnElement = el.firstChildElement();
-      while ( !columnElement.isNull() ) {
-        if ( columnElement.tagName() == QLatin1String( "table-cell" ) ) {
-          counter++;
+    } else if ( mReader->name() == QLatin1String( "table-header-rows" ) ) {
+      while ( !mReader->atEnd() ) {
+        mReader->readNext();
+        if ( mReader->isEndElement() )
+          break;
+        if ( !mReader->isStartElement() )
+          continue;
+
+        if ( mReader->name() == QLatin1String( "table-row" ) ) {
+          if ( !convertTableRow( table, rowCounter ) )
+            return false;
+          rowCounter++;
+        } else {
+          mReader->skipCurrentElement();
         }
-        columnElement = columnElement.nextSiblingElement();
       }
-
-      columnCounter = qMax( columnCounter, counter );
-    } else if ( el.tagName() == QLatin1String( "table-header-rows" ) ) {
-      enqueueNodeList( nodeQueue, el.childNodes() );
+    } else if ( mReader->name() == QLatin1String( "table-column" ) ) {
+      const StyleFormatProperty property = mStyleInformation->styleProperty( attribute( *mReader, "style-name" ) );
+      const QString tableColumnNumColumnsRepeated = attribute( *mReader, "number-columns-repeated", "1" );
+      int numColumnsToApplyTo = tableColumnNumColumnsRepeated.toInt();
+      for (int i = 0; i < numColumnsToApplyTo; ++i) {
+        property.applyTableColumn( &tableFormat );
+      }
+      mReader->skipCurrentElement();
+    } else {
+      mReader->skipCurrentElement();
     }
   }
 
-  /**
-   * Create table
-   */
-  QTextTable *table = mCursor->insertTable( rowCounter, columnCounter );
-  mCursor->movePosition( QTextCursor::End );
+  if ( mReader->hasError() )
+    return false;
 
-  /**
-   * Fill table
-   */
-  nodeQueue.clear();
-  enqueueNodeList( nodeQueue, element.childNodes() );
+  // a table without rows: drop it
+  if ( rowCounter == 0 ) {
+    table->removeRows( 0, table->rows() );
+    return true;
+  }
 
-  QTextTableFormat tableFormat;
+  table->setFormat( tableFormat );
+
+  return true;
+}
 
-  rowCounter = 0;
-  while ( !nodeQueue.isEmpty() ) {
-    QDomElement el = nodeQueue.dequeue().toElement();
-    if ( el.isNull() )
+bool Converter::convertTableRow( QTextTable *table, int row )
+{
+  if ( row >= table->rows() )
+    table->appendRows( 1 );
+
+  int columnCounter = 0;
+  while ( !mReader->atEnd() ) {
+    mReader->readNext();
+    if ( mReader->isEndElement() )
+      break;
+    if ( !mReader->isStartElement() )
       continue;
 
-    if ( el.tagName() == QLatin1String( "table-row" ) ) {
-
-      int columnCounter = 0;
-      QDomElement columnElement = el.firstChildElement();
-      while ( !columnElement.isNull() ) {
-        if ( columnElement.tagName() == QLatin1String( "table-cell" ) ) {
-          const StyleFormatProperty property = mStyleInformation->styleProperty( columnElement.attribute( "style-name" ) );
-
-          QTextBlockFormat format;
-          property.applyTableCell( &format );
-
-          QDomElement paragraphElement = columnElement.firstChildElement();
-          while ( !paragraphElement.isNull() ) {
-            if ( paragraphElement.tagName() == QLatin1String( "p" ) ) {
-              QTextTableCell cell = table->cellAt( rowCounter, columnCounter );
-              // Insert a frame into the cell and work on that, so we can handle
-              // different parts of the cell having different block formatting
-              QTextCursor cellCursor = cell.lastCursorPosition();
-              QTextFrameFormat frameFormat;
-              frameFormat.setMargin( 1 ); // TODO: this shouldn't be hard coded
-              QTextFrame *frame = cellCursor.insertFrame( frameFormat );
-              QTextCursor frameCursor = frame->firstCursorPosition();
-              frameCursor.setBlockFormat( format );
-
-              if ( !convertParagraph( &frameCursor, paragraphElement, format ) )
-                return false;
-            } else if ( paragraphElement.tagName() == QLatin1String( "list" ) ) {
-              QTextTableCell cell = table->cellAt( rowCounter, columnCounter );
-              // insert a list into the cell
-              QTextCursor cellCursor = cell.lastCursorPosition();
-              if ( !convertList( &cellCursor, paragraphElement ) ) {
-                return false;
-              }
-            }
-
-            paragraphElement = paragraphElement.nextSiblingElement();
-          }
-          columnCounter++;
-        }
-        columnElement = columnElement.nextSiblingElement();
-      }
+    if ( mReader->name() != QLatin1String( "table-cell" ) ) {
+      mReader->skipCurrentElement();
+      continue;
+    }
 
-      rowCounter++;
-    } else if ( el.tagName() == QLatin1String( "table-column" ) ) {
-      const StyleFormatProperty property = mStyleInformation->styleProperty( el.attribute( "style-name" ) );
-      const QString tableColumnNumColumnsRepeated = el.attribute( "number-columns-repeated", "1" );
-      int numColumnsToApplyTo = tableColumnNumColumnsRepeated.toInt();
-      for (int i = 0; i < numColumnsToApplyTo; ++i) {
-        property.applyTableColumn( &tableFormat );
+    if ( columnCounter >= table->columns() )
+      table->appendColumns( 1 );
+
+    const StyleFormatProperty property = mStyleInformation->styleProperty( attribute( *mReader, "style-name" ) );
+
+    QTextBlockFormat format;
+    property.applyTableCell( &format );
+
+    while ( !mReader->atEnd() ) {
+      mReader->readNext();
+      if ( mReader->isEndElement() )
+        break;
+      if ( !mReader->isStartElement() )
+        continue;
+
+      if ( mReader->name() == QLatin1String( "p" ) ) {
+        QTextTableCell cell = table->cellAt( row, columnCounter );
+        // Insert a frame into the cell and work on that, so we can handle
+        // different parts of the cell having different block formatting
+        QTextCursor cellCursor = cell.lastCursorPosition();
+        QTextFrameFormat frameFormat;
+        frameFormat.setMargin( 1 ); // TODO: this shouldn't be hard coded
+        QTextFrame *frame = cellCursor.insertFrame( frameFormat );
+        QTextCursor frameCursor = frame->firstCursorPosition();
+        frameCursor.setBlockFormat( format );
+
+        if ( !convertParagraph( &frameCursor, format ) )
+          return false;
+      } else if ( mReader->name() == QLatin1String( "list" ) ) {
+        QTextTableCell cell = table->cellAt( row, columnCounter );
+        // insert a list into the cell
+        QTextCursor cellCursor = cell.lastCursorPosition();
+        if ( !convertList( &cellCursor ) ) {
+          return false;
+        }
+      } else {
+        mReader->skipCurrentElement();
       }
     }
-  }
 
-  table->setFormat( tableFormat );
+    columnCounter++;
+  }
 
-  return true;
+  return !mReader->hasError();
 }
 
-bool Converter::convertFrame( const QDomElement &element )
+bool Converter::convertFrame()
 {
-  QDomElement child = element.firstChildElement();
-  while ( !child.isNull() ) {
-    if ( child.tagName() == QLatin1String( "image" ) ) {
-      const QString href = child.attribute( "href" );
+  const QString width = attribute( *mReader, "width" );
+  const QString height = attribute( *mReader, "height" );
+
+  while ( !mReader->atEnd() ) {
+    mReader->readNext();
+    if ( mReader->isEndElement() )
+      break;
+    if ( !mReader->isStartElement() )
+      continue;
+
+    if ( mReader->name() == QLatin1String( "image" ) ) {
+      const QString href = attribute( *mReader, "href" );
+
+      // decode the images only when they are used
+      if ( mImages.contains( href ) )
+        mTextDocument->addResource( QTextDocument::ImageResource, QUrl( href ), QImage::fromData( mImages.take( href ) ) );
+
       QTextImageFormat format;
-      format.setWidth( StyleParser::convertUnit( element.attribute( "width" ) ) );
-      format.setHeight( StyleParser::convertUnit( element.attribute( "height" ) ) );
+      format.setWidth( StyleParser::convertUnit( width ) );
+      format.setHeight( StyleParser::convertUnit( height ) );
       format.setName( href );
 
       mCursor->insertImage( format );
     }
 
-    child = child.nextSiblingElement();
+    mReader->skipCurrentElement();
   }
 
-  return true;
+  return !mReader->hasError();
 }
 
-bool Converter::convertLink( QTextCursor *cursor, const QDomElement &element, const QTextCharFormat &format )
+bool Converter::convertLink( QTextCursor *cursor, const QTextCharFormat &format )
 {
+  const QString href = attribute( *mReader, "href" );
   int startPosition = cursor->position();
 
-  QDomNode child = element.firstChild();
-  while ( !child.isNull() ) {
-    if ( child.isElement() ) {
-      const QDomElement childElement = child.toElement();
-      if ( childElement.tagName() == QLatin1String( "span" ) ) {
-        if ( !convertSpan( cursor, childElement, format ) )
+  while ( !mReader->atEnd() ) {
+    mReader->readNext();
+    if ( mReader->isEndElement() )
+      break;
+
+    if ( mReader->isStartElement() ) {
+      if ( mReader->name() == QLatin1String( "span" ) ) {
+        if ( !convertSpan( cursor, format ) )
           return false;
+      } else {
+        mReader->skipCurrentElement();
       }
-    } else if ( child.isText() ) {
-      const QDomText childText = child.toText();
-      if ( !convertTextNode( cursor, childText, format ) )
+    } else if ( mReader->isCharacters() ) {
+      if ( !convertTextNode( cursor, mReader->text().toString(), format ) )
         return false;
     }
-
-    child = child.nextSibling();
   }
 
+  if ( mReader->hasError() )
+    return false;
+
   int endPosition = cursor->position();
 
-  Okular::Action *action = new Okular::BrowseAction( element.attribute( "href" ) );
+  Okular::Action *action = new Okular::BrowseAction( href );
   emit addAction( action, startPosition, endPosition );
 
   return true;
 }
 
-bool Converter::convertAnnotation( QTextCursor *cursor, const QDomElement &element )
+bool Converter::convertAnnotation( QTextCursor *cursor )
 {
   QStringList contents;
   QString creator;
@@ -562,19 +674,27 @@ bool Converter::convertAnnotation( QTextCursor *cursor, const QDomElement &eleme
 
   int position = cursor->position();
 
-  QDomElement child = element.firstChildElement();
-  while ( !child.isNull() ) {
-    if ( child.tagName() == QLatin1String( "creator" ) ) {
-      creator = child.text();
-    } else if ( child.tagName() == QLatin1String( "date" ) ) {
-      dateTime = QDateTime::fromString( child.text(), Qt::ISODate );
-    } else if ( child.tagName() == QLatin1String( "p" ) ) {
-        contents.append( child.text() );
-    }
+  while ( !mReader->atEnd() ) {
+    mReader->readNext();
+    if ( mReader->isEndElement() )
+      break;
+    if ( !mReader->isStartElement() )
+      continue;
 
-    child = child.nextSiblingElement();
+    if ( mReader->name() == QLatin1String( "creator" ) ) {
+      creator = mReader->readElementText( QXmlStreamReader::IncludeChildElements );
+    } else if ( mReader->name() == QLatin1String( "date" ) ) {
+      dateTime = QDateTime::fromString( mReader->readElementText( QXmlStreamReader::IncludeChildElements ), Qt::ISODate );
+    } else if ( mReader->name() == QLatin1String( "p" ) ) {
+      contents.append( mReader->readElementText( QXmlStreamReader::IncludeChildElements ) );
+    } else {
+      mReader->skipCurrentElement();
+    }
   }
 
+  if ( mReader->hasError() )
+    return false;
+
   Okular::TextAnnotation *annotation = new Okular::TextAnnotation;
   annotation->setAuthor( creator );
   annotation->setContents( contents.join( "\n" ) );
@@ -586,3 +706,5 @@ bool Converter::convertAnnotation( QTextCursor *cursor, const QDomElement &eleme
 
   return true;
 }
+
+#include "converter.moc"
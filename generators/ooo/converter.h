@@ -10,45 +10,67 @@
 #ifndef OOO_CONVERTER_H
 #define OOO_CONVERTER_H
 
+#include <QtCore/QMap>
 #include <QtGui/QTextCharFormat>
-#include <QtXml/QDomDocument>
 
 #include <core/textdocumentgenerator.h>
 
 #include "styleinformation.h"
 
-class QDomElement;
-class QDomText;
+class QTextTable;
+class QXmlStreamReader;
 
 namespace OOO {
 
 class Document;
+class StyleParser;
 
+/**
+ * Converts the content of an OpenDocument text while reading it: the
+ * elements of the body are written to the QTextDocument as soon as they are
+ * read, without building a DOM of the content first.
+ *
+ * All the convert methods are called with the reader on the start of the
+ * element to convert, and return with the reader on its end.
+ */
 class Converter : public Okular::TextDocumentConverter
 {
+  Q_OBJECT
+
   public:
     Converter();
     ~Converter();
 
     virtual QTextDocument *convert( const QString &fileName );
 
+  protected slots:
+    bool needsInteraction( const QString &fileName ) const;
+
   private:
-    bool convertBody( const QDomElement &element );
-    bool convertText( const QDomElement &element );
-    bool convertHeader( QTextCursor *cursor, const QDomElement &element );
-    bool convertParagraph( QTextCursor *cursor, const QDomElement &element, const QTextBlockFormat &format = QTextBlockFormat(), bool merge = false );
-    bool convertTextNode( QTextCursor *cursor, const QDomText &element, const QTextCharFormat &format );
-    bool convertSpan( QTextCursor *cursor, const QDomElement &element, const QTextCharFormat &format );
-    bool convertLink( QTextCursor *cursor, const QDomElement &element, const QTextCharFormat &format );
-    bool convertList( QTextCursor *cursor, const QDomElement &element );
-    bool convertTable( const QDomElement &element );
-    bool convertFrame( const QDomElement &element );
-    bool convertAnnotation( QTextCursor *cursor, const QDomElement &element );
+    bool convertContent( Document *document );
+    bool setupStyles( StyleParser *styleParser );
+    bool convertBody();
+    bool convertText();
+    bool convertHeader( QTextCursor *cursor );
+    bool convertParagraph( QTextCursor *cursor, const QTextBlockFormat &format = QTextBlockFormat(), bool merge = false );
+    bool convertTextNode( QTextCursor *cursor, const QString &text, const QTextCharFormat &format );
+    bool convertSpan( QTextCursor *cursor, const QTextCharFormat &format );
+    bool convertLink( QTextCursor *cursor, const QTextCharFormat &format );
+    bool convertList( QTextCursor *cursor );
+    bool convertTable();
+    bool convertTableRow( QTextTable *table, int row );
+    bool convertFrame();
+    bool convertAnnotation( QTextCursor *cursor );
 
     QTextDocument *mTextDocument;
     QTextCursor *mCursor;
+    QXmlStreamReader *mReader;
 
     StyleInformation *mStyleInformation;
+
+    // the images of the document not used yet, added as resources when
+    // first used
+    QMap<QString, QByteArray> mImages;
 };
 
 }
@@ -109,6 +109,25 @@ bool Document::open()
   return true;
 }
 
+bool Document::isEncrypted() const
+{
+  KZip zip( mFileName );
+  if ( !zip.open( QIODevice::ReadOnly ) )
+    return false;
+
+  const KArchiveDirectory *directory = zip.directory();
+  const KArchiveEntry *metaInf = directory ? directory->entry( "META-INF" ) : 0;
+  if ( !metaInf || !metaInf->isDirectory() )
+    return false;
+
+  const KArchiveEntry *entry = static_cast<const KArchiveDirectory*>( metaInf )->entry( "manifest.xml" );
+  if ( !entry || !entry->isFile() )
+    return false;
+
+  const Manifest manifest( mFileName, static_cast<const KArchiveFile*>( entry )->data() );
+  return manifest.isEncrypted();
+}
+
 Document::~Document()
 {
   delete mManifest;
@@ -26,6 +26,12 @@ class Document
 
     bool open();
 
+    /**
+       Returns whether some files of the document are encrypted, without
+       reading them; opening such a document asks the user for the password.
+    */
+    bool isEncrypted() const;
+
     QString lastErrorString() const;
 
     QByteArray content() const;
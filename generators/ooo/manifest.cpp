@@ -233,6 +233,18 @@ bool Manifest::testIfEncrypted( const QString &filename )
   return false;
 }
 
+bool Manifest::isEncrypted() const
+{
+  QMap<QString, ManifestEntry*>::const_iterator it = mEntries.constBegin(), end = mEntries.constEnd();
+  for ( ; it != end; ++it ) {
+    if ( it.value()->salt().length() > 0 ) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
 void Manifest::getPasswordFromUser()
 {
   // TODO: This should have a proper parent
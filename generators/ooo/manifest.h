@@ -215,6 +215,11 @@ class Manifest
     */
     bool testIfEncrypted( const QString &filename );
 
+    /**
+       Check if the manifest indicates that any file is encrypted
+    */
+    bool isEncrypted() const;
+
     /**
        Decrypt data associated with a specific file
     */
@@ -23,17 +23,14 @@
 
 using namespace OOO;
 
-StyleParser::StyleParser( const Document *document, const QDomDocument &domDocument, StyleInformation *styleInformation )
-  : mDocument( document ), mDomDocument( domDocument ),
+StyleParser::StyleParser( const Document *document, StyleInformation *styleInformation )
+  : mDocument( document ),
     mStyleInformation( styleInformation ), mMasterPageNameSet( false )
 {
 }
 
 bool StyleParser::parse()
 {
-  if ( !parseContentFile() )
-    return false;
-
   if ( !parseStyleFile() )
     return false;
 
@@ -43,26 +40,20 @@ bool StyleParser::parse()
   return true;
 }
 
-bool StyleParser::parseContentFile()
+bool StyleParser::parseContentElement( QDomElement &element )
 {
-  const QDomElement documentElement = mDomDocument.documentElement();
-  QDomElement element = documentElement.firstChildElement();
-  while ( !element.isNull() ) {
-    if ( element.tagName() == QLatin1String( "document-common-attrs" ) ) {
-      if ( !parseDocumentCommonAttrs( element ) )
-        return false;
-    } else if ( element.tagName() == QLatin1String( "font-face-decls" ) ) {
-      if ( !parseFontFaceDecls( element ) )
-        return false;
-    } else if ( element.tagName() == QLatin1String( "styles" ) ) {
-      if ( !parseStyles( element ) )
-        return false;
-    } else if ( element.tagName() == QLatin1String( "automatic-styles" ) ) {
-      if ( !parseAutomaticStyles( element ) )
-        return false;
-    }
-
-    element = element.nextSiblingElement();
+  if ( element.tagName() == QLatin1String( "document-common-attrs" ) ) {
+    if ( !parseDocumentCommonAttrs( element ) )
+      return false;
+  } else if ( element.tagName() == QLatin1String( "font-face-decls" ) ) {
+    if ( !parseFontFaceDecls( element ) )
+      return false;
+  } else if ( element.tagName() == QLatin1String( "styles" ) ) {
+    if ( !parseStyles( element ) )
+      return false;
+  } else if ( element.tagName() == QLatin1String( "automatic-styles" ) ) {
+    if ( !parseAutomaticStyles( element ) )
+      return false;
   }
 
   return true;
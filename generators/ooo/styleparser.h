@@ -12,7 +12,6 @@
 
 #include "formatproperty.h"
 
-class QDomDocument;
 class QDomElement;
 
 namespace OOO {
@@ -23,14 +22,24 @@ class StyleInformation;
 class StyleParser
 {
   public:
-    StyleParser( const Document *document, const QDomDocument &domDocument, StyleInformation *styleInformation );
+    StyleParser( const Document *document, StyleInformation *styleInformation );
 
+    /**
+     * Parses one of the style elements (font-face-decls, styles,
+     * automatic-styles) found before the body of the content file; they are
+     * handed out one by one as the content is read.
+     */
+    bool parseContentElement( QDomElement &element );
+
+    /**
+     * Parses the style and the meta files; must be called after the style
+     * elements of the content file.
+     */
     bool parse();
 
     static double convertUnit( const QString& );
 
   private:
-    bool parseContentFile();
     bool parseStyleFile();
     bool parseMetaFile();
 
@@ -49,7 +58,6 @@ class StyleParser
     ListFormatProperty parseListProperty( QDomElement& );
 
     const Document *mDocument;
-    const QDomDocument &mDomDocument;
     StyleInformation *mStyleInformation;
     bool mMasterPageNameSet;
 };
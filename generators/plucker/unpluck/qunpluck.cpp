@@ -69,7 +69,7 @@ class Context
 {
     public:
         int recordId;
-        QTextDocument *document;
+        QUnpluckDocument *document;
         QTextCursor *cursor;
         QStack<QTextCharFormat> stack;
         QList<int> images;
@@ -79,14 +79,6 @@ class Context
         int linkPage;
 };
 
-class RecordNode
-{
-  public:
-    int index;
-    int page_id;
-    bool done;
-};
-
 static Okular::DocumentViewport calculateViewport( QTextDocument *document, const QTextBlock &block )
 {
     if ( !block.isValid() )
@@ -106,8 +98,38 @@ static Okular::DocumentViewport calculateViewport( QTextDocument *document, cons
     return viewport;
 }
 
+QUnpluckDocument::QUnpluckDocument()
+    : QTextDocument()
+{
+}
+
+void QUnpluckDocument::addImageRecord( const QString &name, const QByteArray &record )
+{
+    mImageRecords.insert( name, record );
+}
+
+QVariant QUnpluckDocument::loadResource( int type, const QUrl &name )
+{
+    if ( type != QTextDocument::ImageResource )
+        return QTextDocument::loadResource( type, name );
+
+    // the images are decoded only once some page showing them is drawn
+    const QString imageName = name.toString();
+    QMap<QString, QByteArray>::iterator it = mImageRecords.find( imageName );
+    if ( it == mImageRecords.end() )
+        return QTextDocument::loadResource( type, name );
+
+    QImage image;
+    TranscribePalmImageToJPEG( (unsigned char *)it->constData() + 8, image );
+    mImageRecords.erase( it );
+
+    addResource( type, name, image );
+
+    return image;
+}
+
 QUnpluck::QUnpluck()
-    : mDocument( 0 )
+    : mDocument( 0 ), mNextRecord( 0 )
 {
 }
 
@@ -155,10 +177,9 @@ bool QUnpluck::open( const QString &fileName )
         number = GetNextRecordNumber ();
     }
 
-    for ( int i = 0; i < mRecords.count(); ++i )
-        delete mRecords[ i ];
-
     mRecords.clear();
+    mRecordOrder.clear();
+    mNextRecord = 0;
 
     plkr_CloseDoc( mDocument );
 
@@ -176,9 +197,12 @@ bool QUnpluck::open( const QString &fileName )
         Context *context = mContext[ i ];
         for ( int j = 0; j < context->images.count(); ++j ) {
             int imgNumber = context->images[ j ];
-            context->document->addResource( QTextDocument::ImageResource,
-                                            QUrl( QString( "%1.jpg" ).arg( imgNumber ) ),
-                                            mImages[ imgNumber ] );
+            const QString name = QString( "%1.jpg" ).arg( imgNumber );
+            if ( mImageRecords.contains( imgNumber ) )
+                context->document->addImageRecord( name, mImageRecords[ imgNumber ] );
+            else
+                context->document->addResource( QTextDocument::ImageResource,
+                                                QUrl( name ), mImages[ imgNumber ] );
         }
 
         mPages.append( context->document );
@@ -215,69 +239,49 @@ bool QUnpluck::open( const QString &fileName )
 
 int QUnpluck::GetNextRecordNumber()
 {
-    int index = 0;
-
-    for ( int pos = 0; pos < mRecords.count(); ++pos ) {
-        if ( !mRecords[ pos ]->done ) {
-            index = mRecords[ pos ]->index;
-            break;
-        }
+    // records are never marked as not done again, so all the ones before
+    // mNextRecord are done already
+    for ( ; mNextRecord < mRecordOrder.count(); ++mNextRecord ) {
+        const int index = mRecordOrder[ mNextRecord ];
+        if ( !mRecords[ index ].done )
+            return index;
     }
 
-    return index;
+    return 0;
 }
 
 int QUnpluck::GetPageID( int index )
 {
-    for ( int pos = 0; pos < mRecords.count(); ++pos ) {
-        if ( mRecords[ pos ]->index == index ) {
-            return mRecords[ pos ]->page_id;
-        }
-    }
+    QHash<int, RecordNode>::const_iterator it = mRecords.constFind( index );
+    if ( it != mRecords.constEnd() )
+        return it->page_id;
 
     return 0;
 }
 
-void QUnpluck::AddRecord( int index )
+RecordNode& QUnpluck::AddRecord( int index )
 {
-    for ( int pos = 0; pos < mRecords.count(); ++pos ) {
-        if ( mRecords[ pos ]->index == index ) {
-            return;
-        }
-    }
+    QHash<int, RecordNode>::iterator it = mRecords.find( index );
+    if ( it != mRecords.end() )
+        return *it;
 
-    RecordNode *node = new RecordNode;
-    node->done = false;
-    node->index = index;
-    node->page_id = index;
+    RecordNode node;
+    node.done = false;
+    node.index = index;
+    node.page_id = index;
 
-    mRecords.append( node );
+    mRecordOrder.append( index );
+    return *mRecords.insert( index, node );
 }
 
 void QUnpluck::MarkRecordDone( int index )
 {
-    for ( int pos = 0; pos < mRecords.count(); ++pos ) {
-        if ( mRecords[ pos ]->index == index ) {
-            mRecords[ pos ]->done = true;
-            return;
-        }
-    }
-
-    AddRecord( index );
-    MarkRecordDone( index );
+    AddRecord( index ).done = true;
 }
 
 void QUnpluck::SetPageID( int index, int page_id )
 {
-    for ( int pos = 0; pos < mRecords.count(); ++pos ) {
-        if ( mRecords[ pos ]->index == index ) {
-            mRecords[ pos ]->page_id = page_id;
-            return;
-        }
-    }
-
-    AddRecord( index );
-    SetPageID( index, page_id );
+    AddRecord( index ).page_id = page_id;
 }
 
 QString QUnpluck::MailtoURLFromBytes( unsigned char* record_data )
@@ -308,15 +312,6 @@ QString QUnpluck::MailtoURLFromBytes( unsigned char* record_data )
     return url;
 }
 
-QImage QUnpluck::TranscribeImageRecord( unsigned char* bytes )
-{
-    QImage image;
-
-    TranscribePalmImageToJPEG( bytes + 8, image );
-
-    return image;
-}
-
 void QUnpluck::DoStyle( Context* context, int style, bool start )
 {
     if ( start ) {
@@ -583,11 +578,7 @@ bool QUnpluck::TranscribeTableRecord
 //                                     border_color);
 */
                             if ( (record_id = READ_BIGENDIAN_SHORT (&ptr[3])) ) {
-                                QTextCharFormat format = context->cursor->charFormat();
-                                context->cursor->insertImage( QString( "%1.jpg" ).arg(record_id) );
-                                context->cursor->setCharFormat( format );
-                                context->images.append( record_id );
-                                AddRecord (record_id);
+                                InsertImage( context, record_id );
                             }
                             DoStyle (context, style, true);
                             text_len = READ_BIGENDIAN_SHORT (&ptr[7]);
@@ -778,6 +769,7 @@ bool QUnpluck::TranscribeTextRecord
                     plkr_DataRecordType   type = (plkr_DataRecordType)0;
                     unsigned char        *bytes = NULL;
                     char                 *url = NULL;
+                    bool                  exists;
 
                     if (fclen == 0) {
                         if (current_link) {
@@ -797,13 +789,20 @@ bool QUnpluck::TranscribeTextRecord
                     }
                     else {
                         record_id = (ptr[0] << 8) + ptr[1];
-                        bytes =
-                            plkr_GetRecordBytes (doc, record_id, &datalen,
-                                                 &type);
-                        if (!bytes) {
+                        /* only the mailto records need to be read, for the
+                           others their type is enough */
+                        type = (plkr_DataRecordType) plkr_GetRecordType (doc, record_id);
+                        exists = (type != PLKR_DRTYPE_NONE);
+                        if (type == PLKR_DRTYPE_MAILTO) {
+                            bytes =
+                                plkr_GetRecordBytes (doc, record_id, &datalen,
+                                                     &type);
+                            exists = (bytes != NULL);
+                        }
+                        if (!exists) {
                             url = plkr_GetRecordURL (doc, record_id);
                         }
-                        if (bytes && (type == PLKR_DRTYPE_MAILTO)) {
+                        if (exists && (type == PLKR_DRTYPE_MAILTO)) {
                             context->linkUrl = MailtoURLFromBytes( bytes );
                             context->linkStart = context->cursor->position();
 
@@ -814,7 +813,7 @@ bool QUnpluck::TranscribeTextRecord
                             context->cursor->setCharFormat( format );
                             current_link = true;
                         }
-                        else if (!bytes && url) {
+                        else if (!exists && url) {
                             context->linkUrl = QString::fromLatin1( url );
                             context->linkStart = context->cursor->position();
 
@@ -825,7 +824,7 @@ bool QUnpluck::TranscribeTextRecord
                             context->cursor->setCharFormat( format );
                             current_link = true;
                         }
-                        else if (bytes && (fclen == 2)) {
+                        else if (exists && (fclen == 2)) {
                             AddRecord (record_id);
                             real_record_id = GetPageID (record_id);
                             if (type == PLKR_DRTYPE_IMAGE
@@ -845,7 +844,7 @@ bool QUnpluck::TranscribeTextRecord
                             context->cursor->setCharFormat( format );
                             current_link = true;
                         }
-                        else if (bytes && (fclen == 4)) {
+                        else if (exists && (fclen == 4)) {
                             AddRecord (record_id);
 
                             context->linkUrl = QString( "para:%1-%2" ).arg( record_id ).arg( (ptr[2] << 8) + ptr[3] );
@@ -1058,11 +1057,7 @@ bool QUnpluck::TranscribeTextRecord
                         (ptr[0] << 16) + (ptr[1] << 8) + ptr[2];
 
                 } else if (fctype == PLKR_TFC_IMAGE || fctype == PLKR_TFC_IMAGE2) {
-                    QTextCharFormat format = context->cursor->charFormat();
-                    context->cursor->insertImage( QString( "%1.jpg" ).arg( (ptr[0] << 8) + ptr[1] ) );
-                    context->images.append( (ptr[0] << 8) + ptr[1] );
-                    context->cursor->setCharFormat( format );
-                    AddRecord ((ptr[0] << 8) + ptr[1]);
+                    InsertImage( context, (ptr[0] << 8) + ptr[1] );
 
                 }
                 else if (fctype == PLKR_TFC_TABLE) {
@@ -1153,12 +1148,72 @@ bool QUnpluck::TranscribeTextRecord
     return true;
 }
 
+QSize QUnpluck::ReadImageRecord( int index )
+{
+    if ( mImageRecords.contains( index ) ) {
+        const unsigned char *data = (const unsigned char *)mImageRecords[ index ].constData();
+        return QSize( READ_BIGENDIAN_SHORT( data + 8 ), READ_BIGENDIAN_SHORT( data + 10 ) );
+    }
+    if ( mImages.contains( index ) )
+        return mImages[ index ].size();
+
+    plkr_DataRecordType type;
+    int data_len;
+
+    unsigned char *data = plkr_GetRecordBytes( mDocument, index, &data_len, &type );
+    if ( !data )
+        return QSize();
+
+    if ( (type == PLKR_DRTYPE_IMAGE_COMPRESSED || type == PLKR_DRTYPE_IMAGE) && data_len >= 12 ) {
+        // keep the Palm bitmap to decode it when shown; its header, after
+        // the one of the record, starts with its size
+        mImageRecords.insert( index, QByteArray( (const char *)data, data_len ) );
+        return QSize( READ_BIGENDIAN_SHORT( data + 8 ), READ_BIGENDIAN_SHORT( data + 10 ) );
+    } else if (type == PLKR_DRTYPE_MULTIIMAGE) {
+        // the multi-images are put together from other records, which are
+        // not available anymore after the loading
+        QImage image;
+        TranscribeMultiImageRecord( mDocument, image, data );
+        mImages.insert( index, image );
+        return image.size();
+    }
+
+    return QSize();
+}
+
+void QUnpluck::InsertImage( Context *context, int index )
+{
+    // the size of the image is given explicitly, so the layout of the page
+    // does not need to decode it
+    QTextImageFormat imageFormat;
+    imageFormat.setName( QString( "%1.jpg" ).arg( index ) );
+    const QSize size = ReadImageRecord( index );
+    if ( size.isValid() ) {
+        imageFormat.setWidth( size.width() );
+        imageFormat.setHeight( size.height() );
+    }
+
+    QTextCharFormat format = context->cursor->charFormat();
+    context->cursor->insertImage( imageFormat );
+    context->cursor->setCharFormat( format );
+    context->images.append( index );
+    AddRecord( index );
+}
+
 bool QUnpluck::TranscribeRecord( int index )
 {
     plkr_DataRecordType type;
     int data_len;
     bool status = true;
 
+    // the images shown in the pages were read while transcribing them
+    const int recordType = plkr_GetRecordType( mDocument, index );
+    if ( recordType == PLKR_DRTYPE_IMAGE_COMPRESSED || recordType == PLKR_DRTYPE_IMAGE ||
+         recordType == PLKR_DRTYPE_MULTIIMAGE ) {
+        MarkRecordDone( index );
+        return true;
+    }
+
     unsigned char *data = plkr_GetRecordBytes( mDocument, index, &data_len, &type);
     if ( !data ) {
         MarkRecordDone( index );
@@ -1166,7 +1221,7 @@ bool QUnpluck::TranscribeRecord( int index )
     }
 
     if (type == PLKR_DRTYPE_TEXT_COMPRESSED || type == PLKR_DRTYPE_TEXT) {
-        QTextDocument *document = new QTextDocument;
+        QUnpluckDocument *document = new QUnpluckDocument;
 
         QTextFrameFormat format( document->rootFrame()->frameFormat() );
         format.setMargin( 20 );
@@ -1187,13 +1242,6 @@ bool QUnpluck::TranscribeRecord( int index )
 
         delete context->cursor;
         mContext.append( context );
-    } else if (type == PLKR_DRTYPE_IMAGE_COMPRESSED || type == PLKR_DRTYPE_IMAGE) {
-        QImage image = TranscribeImageRecord( data );
-        mImages.insert( index, image );
-    } else if (type == PLKR_DRTYPE_MULTIIMAGE) {
-        QImage image;
-        if ( TranscribeMultiImageRecord( mDocument, image, data ) )
-            mImages.insert( index, image );
     } else {
         status = false;
     }
@@ -12,15 +12,23 @@
 #ifndef QUNPLUCK_H
 #define QUNPLUCK_H
 
+#include <QtCore/QHash>
 #include <QtCore/QList>
 #include <QtCore/QMap>
 #include <QtGui/QImage>
+#include <QtGui/QTextDocument>
 
 #include "unpluck.h"
 
 class Context;
-class RecordNode;
-class QTextDocument;
+
+class RecordNode
+{
+  public:
+    int index;
+    int page_id;
+    bool done;
+};
 
 namespace Okular {
 class Action;
@@ -43,6 +51,24 @@ class Link
         int end;
 };
 
+/**
+ * A page of the document, decoding its images only when they are drawn.
+ */
+class QUnpluckDocument : public QTextDocument
+{
+    public:
+        QUnpluckDocument();
+
+        void addImageRecord( const QString &name, const QByteArray &record );
+
+    protected:
+        virtual QVariant loadResource( int type, const QUrl &name );
+
+    private:
+        // the Palm bitmap records of the images not decoded yet
+        QMap<QString, QByteArray> mImageRecords;
+};
+
 class QUnpluck
 {
     public:
@@ -58,24 +84,31 @@ class QUnpluck
     private:
         int GetNextRecordNumber();
         int GetPageID( int index );
-        void AddRecord( int index );
+        RecordNode& AddRecord( int index );
         void MarkRecordDone( int index );
         void SetPageID( int index, int page_id );
         QString MailtoURLFromBytes( unsigned char* record_data );
         void DoStyle( Context* context, int style, bool start );
         bool TranscribeRecord( int index );
-        QImage TranscribeImageRecord( unsigned char* bytes );
+        QSize ReadImageRecord( int index );
+        void InsertImage( Context* context, int index );
         bool TranscribeTableRecord( plkr_Document* doc, Context* context, unsigned char* bytes );
         bool TranscribeTextRecord( plkr_Document* doc, int id, Context* context,
                                    unsigned char* bytes, plkr_DataRecordType type );
         void ParseText( plkr_Document*  doc, unsigned char* ptr, int text_len, int* font, int* style, Context* context );
 
         plkr_Document* mDocument;
-        QList<RecordNode*> mRecords;
+        // the records by number, and their numbers in the order they were found
+        QHash<int, RecordNode> mRecords;
+        QList<int> mRecordOrder;
+        int mNextRecord;
 
         QList<Context*> mContext;
         QList<QTextDocument*> mPages;
         QMap<QString, QPair<int, QTextBlock> > mNamedTargets;
+        // the images shown in the pages: the records of the Palm bitmaps,
+        // or the decoded images for the multi-images
+        QMap<int, QByteArray> mImageRecords;
         QMap<int, QImage> mImages;
         QMap<QString, QString> mInfo;
         QString mErrorString;
@@ -18,8 +18,6 @@
 #include <qimage.h>
 #include <qlayout.h>
 #include <qmutex.h>
-#include <qregexp.h>
-#include <qstack.h>
 #include <qtextstream.h>
 #include <QtGui/QPrinter>
 #include <QtGui/QPainter>
@@ -54,7 +52,9 @@
 
 #include "annots.h"
 #include "formfields.h"
+#include "linkextractor.h"
 #include "popplerembeddedfile.h"
+#include "sourcesync.h"
 
 Q_DECLARE_METATYPE(Poppler::Annotation*)
 Q_DECLARE_METATYPE(Poppler::FontInfo)
@@ -319,7 +319,7 @@ Okular::Action* createLinkFromPopplerLink(const Poppler::Link *popplerLink)
 /**
  * Note: the function will take ownership of the popplerLink objects.
  */
-static QLinkedList<Okular::ObjectRect*> generateLinks( const QList<Poppler::Link*> &popplerLinks )
+QLinkedList<Okular::ObjectRect*> generateLinks( const QList<Poppler::Link*> &popplerLinks )
 {
     QLinkedList<Okular::ObjectRect*> links;
     foreach(const Poppler::Link *popplerLink, popplerLinks)
@@ -382,7 +382,7 @@ PDFGenerator::PDFGenerator( QObject *parent, const QVariantList &args )
     docInfoDirty( true ), docSynopsisDirty( true ),
     docEmbeddedFilesDirty( true ), nextFontPage( 0 ),
     dpiX( 72.0 /*Okular::Utils::dpiX()*/ ), dpiY( 72.0 /*Okular::Utils::dpiY()*/ ),
-    annotProxy( 0 ), synctex_scanner( 0 )
+    annotProxy( 0 ), linkExtractor( 0 ), syncIndex( 0 ), syncLoader( 0 )
 {
     setFeature( Threaded );
     setFeature( TextExtraction );
@@ -423,13 +423,7 @@ bool PDFGenerator::loadDocument( const QString & filePath, QVector<Okular::Page*
     bool success = init(pagesVector, filePath.section('/', -1, -1));
     if (success)
     {
-        // no need to check for the existence of a synctex file, no parser will be
-        // created if none exists
-        initSynctexParser(filePath);
-        if ( !synctex_scanner && QFile::exists(filePath + QLatin1String( "sync" ) ) )
-        {
-            loadPdfSync(filePath, pagesVector);
-        }
+        startSourceSyncLoading(filePath, pagesVector.count());
     }
     return success;
 }
@@ -522,12 +516,16 @@ bool PDFGenerator::init(QVector<Okular::Page*> & pagesVector, const QString &wal
     // build Pages (currentPage was set -1 by deletePages)
     uint pageCount = pdfdoc->numPages();
     pagesVector.resize(pageCount);
-    rectsGenerated.fill(false, pageCount);
-
     annotationsHash.clear();
 
     loadPages(pagesVector, 0, false);
 
+    // extract the links of the pages in the background
+    docPages = pagesVector;
+    linkExtractor = new PDFLinkExtractor( pdfdoc, userMutex(), pageCount, this );
+    connect( linkExtractor, SIGNAL(linksExtracted()), this, SLOT(linksExtracted()), Qt::QueuedConnection );
+    linkExtractor->start( QThread::LowPriority );
+
     // update the configuration
     reparseConfig();
 
@@ -540,6 +538,15 @@ bool PDFGenerator::init(QVector<Okular::Page*> & pagesVector, const QString &wal
 
 bool PDFGenerator::doCloseDocument()
 {
+    // stop the link extraction before the document goes away
+    if ( linkExtractor )
+    {
+        disconnect( linkExtractor, 0, this, 0 );
+        delete linkExtractor;
+        linkExtractor = 0;
+    }
+    docPages.clear();
+
     // remove internal objects
     userMutex()->lock();
     delete annotProxy;
@@ -554,12 +561,14 @@ bool PDFGenerator::doCloseDocument()
     qDeleteAll(docEmbeddedFiles);
     docEmbeddedFiles.clear();
     nextFontPage = 0;
-    rectsGenerated.clear();
-    if ( synctex_scanner )
+    if ( syncLoader )
     {
-        synctex_scanner_free( synctex_scanner );
-        synctex_scanner = 0;
+        disconnect( syncLoader, 0, this, 0 );
+        delete syncLoader;
+        syncLoader = 0;
     }
+    delete syncIndex;
+    syncIndex = 0;
 
     return true;
 }
@@ -842,6 +851,32 @@ bool PDFGenerator::isAllowed( Okular::Permission permission ) const
     return b;
 }
 
+void PDFGenerator::generatePixmap( Okular::PixmapRequest * request )
+{
+    // the pages being rendered are the ones shown, get their links first
+    if ( linkExtractor )
+        linkExtractor->prioritize( request->pageNumber() );
+
+    Okular::Generator::generatePixmap( request );
+}
+
+void PDFGenerator::linksExtracted()
+{
+    if ( !linkExtractor )
+        return;
+
+    // TODO previously we extracted Image type rects too, but that needed porting to poppler
+    // and as we are not doing anything with Image type rects i did not port it, have a look at
+    // dead gp_outputdev.cpp on image extraction
+    foreach ( const PDFLinkExtractor::PageLinks &links, linkExtractor->takeExtractedLinks() )
+    {
+        Okular::Page *page = docPages.at( links.page );
+        page->setObjectRects( links.rects );
+
+        resolveMovieLinkReferences( page );
+    }
+}
+
 QImage PDFGenerator::image( Okular::PixmapRequest * request )
 {
     // debug requests to this (xpdf) generator
@@ -859,9 +894,6 @@ QImage PDFGenerator::image( Okular::PixmapRequest * request )
     double fakeDpiX = request->width() * dpiX / pageWidth,
            fakeDpiY = request->height() * dpiY / pageHeight;
 
-    // generate links rects only the first time
-    bool genObjectRects = !rectsGenerated.at( page->number() );
-
     // 0. LOCK [waits for the thread end]
     userMutex()->lock();
 
@@ -870,8 +902,14 @@ QImage PDFGenerator::image( Okular::PixmapRequest * request )
     Poppler::Page *p = pdfdoc->page(page->number());
 
     // 2. Take data from outputdev and attach it to the Page
+    // poppler can not stop a page half-rendered, but the request could have
+    // been cancelled while waiting for the lock
     QImage img;
-    if (p)
+    if (request->isCancelled())
+    {
+        kDebug(PDFDebug) << "Skipping the cancelled request for page" << page->number();
+    }
+    else if (p)
     {
         img = p->renderToImage(fakeDpiX, fakeDpiY, -1, -1, -1, -1, Poppler::Page::Rotate0 );
     }
@@ -881,17 +919,6 @@ QImage PDFGenerator::image( Okular::PixmapRequest * request )
         img.fill( Qt::white );
     }
 
-    if ( p && genObjectRects )
-    {
-        // TODO previously we extracted Image type rects too, but that needed porting to poppler
-        // and as we are not doing anything with Image type rects i did not port it, have a look at
-        // dead gp_outputdev.cpp on image extraction
-        page->setObjectRects( generateLinks(p->links()) );
-        rectsGenerated[ request->page()->number() ] = true;
-
-        resolveMovieLinkReferences( page );
-    }
-
     // 3. UNLOCK [re-enables shared access]
     userMutex()->unlock();
 
@@ -977,6 +1004,32 @@ Okular::TextPage* PDFGenerator::textPage( Okular::Page *page )
 
 void PDFGenerator::requestFontData(const Okular::FontInfo &font, QByteArray *data)
 {
+    if ( font.nativeId().type() == QVariant::Int )
+    {
+        // the font was restored from the document data: look it up among
+        // the fonts of the page where it was found
+        const int page = font.nativeId().toInt();
+        if ( page < 0 || page >= pdfdoc->numPages() )
+            return;
+
+        userMutex()->lock();
+        Poppler::FontIterator *it = pdfdoc->newFontIterator( page );
+        if ( it->hasNext() )
+        {
+            foreach (const Poppler::FontInfo &fi, it->next())
+            {
+                if ( fi.name() == font.name() && fi.file() == font.file() )
+                {
+                    *data = pdfdoc->fontData(fi);
+                    break;
+                }
+            }
+        }
+        delete it;
+        userMutex()->unlock();
+        return;
+    }
+
     Poppler::FontInfo fi = font.nativeId().value<Poppler::FontInfo>();
     *data = pdfdoc->fontData(fi);
 }
@@ -1483,160 +1536,75 @@ void PDFGenerator::addFormFields( Poppler::Page * popplerPage, Okular::Page * pa
         page->setFormFields( okularFormFields );
 }
 
-struct pdfsyncpoint
+void PDFGenerator::startSourceSyncLoading( const QString & filePath, int pages )
 {
-    QString file;
-    qlonglong x;
-    qlonglong y;
-    int row;
-    int column;
-    int page;
-};
+    // parsing the synctex or pdfsync file can take several seconds for big
+    // documents, so do it in a thread and not delay the opening
+    syncLoader = new SourceSyncLoader( filePath, pages, dpiX, dpiY, this );
+    connect( syncLoader, SIGNAL(finished()), this, SLOT(sourceSyncLoadingFinished()), Qt::QueuedConnection );
+    syncLoader->start( QThread::LowPriority );
+}
 
-void PDFGenerator::loadPdfSync( const QString & filePath, QVector<Okular::Page*> & pagesVector )
+void PDFGenerator::waitSourceSyncLoading() const
 {
-    QFile f( filePath + QLatin1String( "sync" ) );
-    if ( !f.open( QIODevice::ReadOnly ) )
+    if ( !syncLoader || syncIndex )
         return;
 
-    QTextStream ts( &f );
-    // first row: core name of the pdf output
-    const QString coreName = ts.readLine();
-    // second row: version string, in the form 'Version %u'
-    QString versionstr = ts.readLine();
-    QRegExp versionre( "Version (\\d+)" );
-    versionre.setCaseSensitivity( Qt::CaseInsensitive );
-    if ( !versionre.exactMatch( versionstr ) )
-        return;
+    syncLoader->wait();
+    syncIndex = syncLoader->takeIndex();
+}
 
-    QHash<int, pdfsyncpoint> points;
-    QStack<QString> fileStack;
-    int currentpage = -1;
-    const QLatin1String texStr( ".tex" );
-    const QChar spaceChar = QChar::fromLatin1( ' ' );
+void PDFGenerator::sourceSyncLoadingFinished()
+{
+    if ( !syncLoader )
+        return;
 
-    fileStack.push( coreName + texStr );
+    // a forward search may have already taken the index
+    if ( !syncIndex )
+        syncIndex = syncLoader->takeIndex();
+    if ( !syncIndex || !syncLoader->isPdfSync() )
+        return;
 
-    QString line;
-    while ( !ts.atEnd() )
+    // unlike the synctex ones, which are looked up on demand, the pdfsync
+    // positions are attached to the pages as source references
+    for ( int i = 0; i < docPages.count(); ++i )
     {
-        line = ts.readLine();
-        const QStringList tokens = line.split( spaceChar, QString::SkipEmptyParts );
-        const int tokenSize = tokens.count();
-        if ( tokenSize < 1 )
+        const int count = syncIndex->pointCount( i );
+        if ( count == 0 )
             continue;
-        if ( tokens.first() == QLatin1String( "l" ) && tokenSize >= 3 )
-        {
-            int id = tokens.at( 1 ).toInt();
-            QHash<int, pdfsyncpoint>::const_iterator it = points.constFind( id );
-            if ( it == points.constEnd() )
-            {
-                pdfsyncpoint pt;
-                pt.x = 0;
-                pt.y = 0;
-                pt.row = tokens.at( 2 ).toInt();
-                pt.column = 0; // TODO
-                pt.page = -1;
-                pt.file = fileStack.top();
-                points[ id ] = pt;
-            }
-        }
-        else if ( tokens.first() == QLatin1String( "s" ) && tokenSize >= 2 )
-        {
-            currentpage = tokens.at( 1 ).toInt() - 1;
-        }
-        else if ( tokens.first() == QLatin1String( "p*" ) && tokenSize >= 4 )
-        {
-            // TODO
-            kDebug(PDFDebug) << "PdfSync: 'p*' line ignored";
-        }
-        else if ( tokens.first() == QLatin1String( "p" ) && tokenSize >= 4 )
-        {
-            int id = tokens.at( 1 ).toInt();
-            QHash<int, pdfsyncpoint>::iterator it = points.find( id );
-            if ( it != points.end() )
-            {
-                it->x = tokens.at( 2 ).toInt();
-                it->y = tokens.at( 3 ).toInt();
-                it->page = currentpage;
-            }
-        }
-        else if ( line.startsWith( QLatin1Char( '(' ) ) && tokenSize == 1 )
-        {
-            QString newfile = line;
-            // chop the leading '('
-            newfile.remove( 0, 1 );
-            if ( !newfile.endsWith( texStr ) )
-            {
-                newfile += texStr;
-            }
-            fileStack.push( newfile );
-        }
-        else if ( line == QLatin1String( ")" ) )
+
+        Okular::Page *page = docPages.at( i );
+        const bool rotated = page->rotation() % 2;
+        const double width = rotated ? page->height() : page->width();
+        const double height = rotated ? page->width() : page->height();
+        QLinkedList< Okular::SourceRefObjectRect * > refRects;
+        for ( int j = 0; j < count; ++j )
         {
-            if ( !fileStack.isEmpty() )
-            {
-                fileStack.pop();
-            }
-            else
-                kDebug(PDFDebug) << "PdfSync: going one level down too much";
+            double x, y;
+            QString file;
+            int line, column;
+            syncIndex->pointAt( i, j, &x, &y, &file, &line, &column );
+            Okular::SourceReference * sourceRef = new Okular::SourceReference( file, line, column );
+            refRects.append( new Okular::SourceRefObjectRect( Okular::NormalizedPoint( x / width, y / height ), sourceRef ) );
         }
-        else
-            kDebug(PDFDebug).nospace() << "PdfSync: unknown line format: '" << line << "'";
-
+        page->setSourceReferences( refRects );
+        updatePageObjects( i );
     }
-
-    QVector< QLinkedList< Okular::SourceRefObjectRect * > > refRects( pagesVector.size() );
-    foreach ( const pdfsyncpoint& pt, points )
-    {
-        // drop pdfsync points not completely valid
-        if ( pt.page < 0 || pt.page >= pagesVector.size() )
-            continue;
-
-        // magic numbers for TeX's RSU's (Ridiculously Small Units) conversion to pixels
-        Okular::NormalizedPoint p(
-            ( pt.x * dpiX ) / ( 72.27 * 65536.0 * pagesVector[pt.page]->width() ),
-            ( pt.y * dpiY ) / ( 72.27 * 65536.0 * pagesVector[pt.page]->height() )
-            );
-        QString file = pt.file;
-        Okular::SourceReference * sourceRef = new Okular::SourceReference( file, pt.row, pt.column );
-        refRects[ pt.page ].append( new Okular::SourceRefObjectRect( p, sourceRef ) );
-    }
-    for ( int i = 0; i < refRects.size(); ++i )
-        if ( !refRects.at(i).isEmpty() )
-            pagesVector[i]->setSourceReferences( refRects.at(i) );
-}
-
-void PDFGenerator::initSynctexParser( const QString& filePath )
-{
-    synctex_scanner = synctex_scanner_new_with_output_file( QFile::encodeName( filePath ), 0, 1);
 }
 
 const Okular::SourceReference * PDFGenerator::dynamicSourceReference( int pageNr, double absX, double absY )
 {
-    if  ( !synctex_scanner )
+    // while the source references are still loading there are none to offer,
+    // the user is not kept waiting for them
+    if ( !syncIndex || syncIndex->isEmpty() )
         return 0;
 
-    if (synctex_edit_query(synctex_scanner, pageNr + 1, absX * 72. / dpiX, absY * 72. / dpiY) > 0)
-    {
-        synctex_node_t node;
-        // TODO what should we do if there is really more than one node?
-        while (( node = synctex_next_result( synctex_scanner ) ))
-        {
-            int line = synctex_node_line(node);
-            int col = synctex_node_column(node);
-            // column extraction does not seem to be implemented in synctex so far. set the SourceReference default value.
-            if ( col == -1 )
-            {
-                col = 0;
-            }
-            const char *name = synctex_scanner_get_name( synctex_scanner, synctex_node_tag( node ) );
+    QString file;
+    int line, column;
+    if ( !syncIndex->inverseLookup( pageNr, absX, absY, &file, &line, &column ) )
+        return 0;
 
-            Okular::SourceReference * sourceRef = new Okular::SourceReference( name, line, col );
-            return sourceRef;
-        }
-    }
-    return 0;
+    return new Okular::SourceReference( file, line, column );
 }
 
 PDFGenerator::PrintError PDFGenerator::printError() const
@@ -1646,7 +1614,9 @@ PDFGenerator::PrintError PDFGenerator::printError() const
 
 void PDFGenerator::fillViewportFromSourceReference( Okular::DocumentViewport & viewport, const QString & reference ) const
 {
-    if ( !synctex_scanner )
+    // a forward search was explicitly asked for, so it is worth waiting
+    waitSourceSyncLoading();
+    if ( !syncIndex || syncIndex->isEmpty() )
         return;
 
     // The reference is of form "src:1111Filename", where "1111"
@@ -1674,30 +1644,18 @@ void PDFGenerator::fillViewportFromSourceReference( Okular::DocumentViewport & v
     int line = lineString.toInt( &ok );
     if (!ok) line = -1;
 
-    // Use column == -1 for now.
-    if( synctex_display_query( synctex_scanner, name.toLatin1(), line, -1 ) > 0 )
-    {
-        synctex_node_t node;
-        // For now use the first hit. Could possibly be made smarter
-        // in case there are multiple hits.
-        while( ( node = synctex_next_result( synctex_scanner ) ) )
-        {
-            // TeX pages start at 1.
-            viewport.pageNumber = synctex_node_page( node ) - 1;
-
-            if ( !viewport.isValid() ) return;
+    int page;
+    double px, py;
+    if ( !syncIndex->forwardLookup( name, line, &page, &px, &py ) )
+        return;
 
-            // TeX small points ...
-            double px = (synctex_node_visible_h( node ) * dpiX) / 72.27;
-            double py = (synctex_node_visible_v( node ) * dpiY) / 72.27;
-            viewport.rePos.normalizedX = px / document()->page(viewport.pageNumber)->width();
-            viewport.rePos.normalizedY = ( py + 0.5 ) / document()->page(viewport.pageNumber)->height();
-            viewport.rePos.enabled = true;
-            viewport.rePos.pos = Okular::DocumentViewport::Center;
+    viewport.pageNumber = page;
+    if ( !viewport.isValid() ) return;
 
-            return;
-        }
-    }
+    viewport.rePos.normalizedX = px / document()->page(viewport.pageNumber)->width();
+    viewport.rePos.normalizedY = ( py + 0.5 ) / document()->page(viewport.pageNumber)->height();
+    viewport.rePos.enabled = true;
+    viewport.rePos.pos = Okular::DocumentViewport::Center;
 }
 
 QWidget* PDFGenerator::printConfigurationWidget() const
@@ -13,12 +13,11 @@
 
 #define UNSTABLE_POPPLER_QT4
 
-#include "synctex/synctex_parser.h"
-
 #include <poppler-qt4.h>
 
-#include <qbitarray.h>
+#include <qlinkedlist.h>
 #include <qpointer.h>
+#include <qvector.h>
 
 #include <core/document.h>
 #include <core/generator.h>
@@ -31,8 +30,16 @@ class ObjectRect;
 class SourceReference;
 }
 
+class PDFLinkExtractor;
 class PDFOptionsPage;
 class PopplerAnnotationProxy;
+class SourceSyncIndex;
+class SourceSyncLoader;
+
+/**
+ * Converts the @p popplerLinks to object rects, taking their ownership.
+ */
+QLinkedList<Okular::ObjectRect*> generateLinks( const QList<Poppler::Link*> &popplerLinks );
 
 /**
  * @short A generator that builds contents from a PDF document.
@@ -74,6 +81,7 @@ class PDFGenerator : public Okular::Generator, public Okular::ConfigInterface, p
         bool isAllowed( Okular::Permission permission ) const;
 
         // [INHERITED] perform actions on document / pages
+        void generatePixmap( Okular::PixmapRequest *request );
         QImage image( Okular::PixmapRequest *page );
 
         // [INHERITED] print page using an already configured kprinter
@@ -107,6 +115,10 @@ class PDFGenerator : public Okular::Generator, public Okular::ConfigInterface, p
         const Okular::SourceReference * dynamicSourceReference( int pageNr, double absX, double absY );
         Okular::Generator::PrintError printError() const;
 
+    private slots:
+        void sourceSyncLoadingFinished();
+        void linksExtracted();
+
     private:
         bool init(QVector<Okular::Page*> & pagesVector, const QString &walletKey);
 
@@ -118,10 +130,10 @@ class PDFGenerator : public Okular::Generator, public Okular::ConfigInterface, p
         void addTransition( Poppler::Page * popplerPage, Okular::Page * page );
         // fetch the form fields and add them to the page
         void addFormFields( Poppler::Page * popplerPage, Okular::Page * page );
-        // load the source references from a pdfsync file
-        void loadPdfSync( const QString & fileName, QVector<Okular::Page*> & pagesVector );
-        // init the synctex parser if a synctex file exists
-        void initSynctexParser( const QString& filePath );
+        // start loading the source references of a synctex or pdfsync file
+        void startSourceSyncLoading( const QString & filePath, int pages );
+        // wait for the source references loading to end, if running
+        void waitSourceSyncLoading() const;
         // search document for source reference
         void fillViewportFromSourceReference( Okular::DocumentViewport & viewport, const QString & reference ) const;
 
@@ -149,12 +161,15 @@ class PDFGenerator : public Okular::Generator, public Okular::ConfigInterface, p
         PopplerAnnotationProxy *annotProxy;
         QHash<Okular::Annotation*, Poppler::Annotation*> annotationsHash;
 
-        QBitArray rectsGenerated;
+        // the pages whose links and source references are loaded in the background
+        QVector<Okular::Page*> docPages;
+        PDFLinkExtractor *linkExtractor;
 
         QPointer<PDFOptionsPage> pdfOptionsPage;
-        
-        synctex_scanner_t synctex_scanner;
-        
+
+        mutable SourceSyncIndex *syncIndex;
+        SourceSyncLoader *syncLoader;
+
         PrintError lastPrintError;
 };
 
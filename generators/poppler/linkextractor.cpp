@@ -0,0 +1,126 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by the Okular developers <okular-devel@kde.org>    *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include "linkextractor.h"
+
+#include <core/area.h>
+
+#include "generator_pdf.h"
+
+// how long to wait before trying again to get the document, in ms
+#define LINKEXTRACTOR_BACKOFF 10
+// how many pages before and after a prioritized one to extract too
+#define LINKEXTRACTOR_MARGIN 2
+
+PDFLinkExtractor::PDFLinkExtractor( Poppler::Document *document, QMutex *documentMutex, int pages, QObject *parent )
+    : QThread( parent ), m_document( document ), m_documentMutex( documentMutex ), m_queued( pages ), m_stopped( false )
+{
+}
+
+PDFLinkExtractor::~PDFLinkExtractor()
+{
+    stop();
+    wait();
+
+    foreach ( const PageLinks &links, m_extracted )
+        qDeleteAll( links.rects );
+}
+
+void PDFLinkExtractor::prioritize( int page )
+{
+    // the page first, then the ones around it, the closest first
+    QList< int > pages;
+    pages.append( page );
+    for ( int i = 1; i <= LINKEXTRACTOR_MARGIN; ++i )
+        pages << page + i << page - i;
+
+    QMutexLocker locker( &m_mutex );
+    int position = 0;
+    foreach ( int p, pages )
+    {
+        if ( p < 0 || p >= m_queued.count() )
+            continue;
+        // already extracted
+        if ( m_queued.testBit( p ) && !m_pages.removeOne( p ) )
+            continue;
+
+        m_queued.setBit( p );
+        m_pages.insert( position++, p );
+    }
+    m_pagesQueued.wakeOne();
+}
+
+void PDFLinkExtractor::stop()
+{
+    QMutexLocker locker( &m_mutex );
+    m_stopped = true;
+    m_pagesQueued.wakeOne();
+}
+
+QList< PDFLinkExtractor::PageLinks > PDFLinkExtractor::takeExtractedLinks()
+{
+    QMutexLocker locker( &m_mutex );
+    QList< PageLinks > extracted = m_extracted;
+    m_extracted.clear();
+    return extracted;
+}
+
+bool PDFLinkExtractor::isStopped()
+{
+    QMutexLocker locker( &m_mutex );
+    return m_stopped;
+}
+
+void PDFLinkExtractor::run()
+{
+    forever
+    {
+        PageLinks links;
+        {
+            QMutexLocker locker( &m_mutex );
+            while ( !m_stopped && m_pages.isEmpty() )
+                m_pagesQueued.wait( &m_mutex );
+            if ( m_stopped )
+                return;
+            links.page = m_pages.takeFirst();
+        }
+
+        // never make a render wait for us to get the document
+        while ( !m_documentMutex->tryLock() )
+        {
+            if ( isStopped() )
+                return;
+            msleep( LINKEXTRACTOR_BACKOFF );
+        }
+
+        Poppler::Page *p = m_document->page( links.page );
+        if ( p )
+            links.rects = generateLinks( p->links() );
+        m_documentMutex->unlock();
+        delete p;
+
+        bool notify = false;
+        {
+            QMutexLocker locker( &m_mutex );
+            if ( m_stopped )
+            {
+                qDeleteAll( links.rects );
+                return;
+            }
+            // one notification is enough for all the links extracted
+            // before they are taken
+            notify = m_extracted.isEmpty();
+            m_extracted.append( links );
+        }
+        if ( notify )
+            emit linksExtracted();
+    }
+}
+
+#include "linkextractor.moc"
@@ -0,0 +1,97 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by the Okular developers <okular-devel@kde.org>    *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef _OKULAR_LINKEXTRACTOR_H_
+#define _OKULAR_LINKEXTRACTOR_H_
+
+#include <qbitarray.h>
+#include <qlinkedlist.h>
+#include <qlist.h>
+#include <qmutex.h>
+#include <qthread.h>
+#include <qwaitcondition.h>
+
+namespace Poppler {
+class Document;
+}
+
+namespace Okular {
+class ObjectRect;
+}
+
+/**
+ * Extracts the links of the pages of a document in a low priority thread,
+ * so the render of a page does not have to wait for them.
+ *
+ * Only the pages passed to prioritize(), the ones being shown, and a few
+ * pages around them are extracted, the latest first; the thread waits for
+ * more pages otherwise.
+ *
+ * The document is shared with the renderer: the extractor takes its mutex
+ * only to read one page, and only when nobody else is using it, backing
+ * off otherwise.
+ */
+class PDFLinkExtractor : public QThread
+{
+    Q_OBJECT
+
+    public:
+        struct PageLinks
+        {
+            int page;
+            QLinkedList< Okular::ObjectRect * > rects;
+        };
+
+        PDFLinkExtractor( Poppler::Document *document, QMutex *documentMutex, int pages, QObject *parent = 0 );
+        ~PDFLinkExtractor();
+
+        /**
+         * Puts the @p page, and the pages around it, at the front of the
+         * pages to extract, if they were not extracted yet.
+         */
+        void prioritize( int page );
+
+        /**
+         * Stops the extraction; to be followed by a wait() before deleting
+         * the document.
+         */
+        void stop();
+
+        /**
+         * Returns the links extracted since the last call, passing their
+         * ownership to the caller.
+         */
+        QList< PageLinks > takeExtractedLinks();
+
+    signals:
+        /**
+         * Emitted when some links are ready to be taken.
+         */
+        void linksExtracted();
+
+    protected:
+        virtual void run();
+
+    private:
+        bool isStopped();
+
+        Poppler::Document *m_document;
+        QMutex *m_documentMutex;
+
+        // protects the members below
+        QMutex m_mutex;
+        QWaitCondition m_pagesQueued;
+        // the pages to extract, and the ones ever queued
+        QList< int > m_pages;
+        QBitArray m_queued;
+        QList< PageLinks > m_extracted;
+        bool m_stopped;
+};
+
+#endif
@@ -0,0 +1,516 @@
+/***************************************************************************
+ *   Copyright (C) 2004-2008 by Albert Astals Cid <tsdgeos@terra.es>       *
+ *   Copyright (C) 2026 by the Okular developers <okular-devel@kde.org>    *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include "sourcesync.h"
+
+#include <qfile.h>
+#include <qfileinfo.h>
+#include <qregexp.h>
+#include <qstack.h>
+#include <qtextstream.h>
+#include <qtalgorithms.h>
+
+#include <kdebug.h>
+
+#include "synctex/synctex_parser.h"
+
+static const int PDFDebug = 4710;
+
+SourceSyncIndex::SourceSyncIndex( const QString &baseDir )
+    : m_baseDir( baseDir )
+{
+}
+
+QString SourceSyncIndex::resolvedPath( const QString &file ) const
+{
+    return QDir::cleanPath( m_baseDir.absoluteFilePath( file ) );
+}
+
+bool SourceSyncIndex::pointLessThan( const Point &p1, const Point &p2 )
+{
+    if ( p1.y != p2.y )
+        return p1.y < p2.y;
+    return p1.x < p2.x;
+}
+
+bool SourceSyncIndex::lineLessThan( const LineEntry &e1, const LineEntry &e2 )
+{
+    if ( e1.line != e2.line )
+        return e1.line < e2.line;
+    if ( e1.page != e2.page )
+        return e1.page < e2.page;
+    if ( e1.y != e2.y )
+        return e1.y < e2.y;
+    return e1.x < e2.x;
+}
+
+static bool pointYLessThan( float y1, float y2 )
+{
+    return y1 < y2;
+}
+
+int SourceSyncIndex::addBox( int page, double left, double top, double right, double bottom )
+{
+    if ( page < 0 )
+        return -1;
+
+    if ( page >= m_boxes.count() )
+    {
+        m_boxes.resize( page + 1 );
+        m_maxBoxHeights.resize( page + 1 );
+    }
+
+    Box b;
+    b.left = left;
+    b.top = top;
+    b.right = right;
+    b.bottom = bottom;
+    QVector< Box > &boxes = m_boxes[ page ];
+    if ( !boxes.isEmpty() )
+    {
+        const Box &last = boxes.last();
+        if ( last.left == b.left && last.top == b.top && last.right == b.right && last.bottom == b.bottom )
+            return boxes.count() - 1;
+    }
+    boxes.append( b );
+    m_maxBoxHeights[ page ] = qMax( m_maxBoxHeights.at( page ), b.bottom - b.top );
+    return boxes.count() - 1;
+}
+
+void SourceSyncIndex::addPoint( int page, double x, double y, const QString &file, int line, int column, int box )
+{
+    if ( page < 0 )
+        return;
+
+    int id = m_fileIds.value( file, -1 );
+    if ( id == -1 )
+    {
+        id = m_files.count();
+        m_files.append( file );
+        m_fileIds.insert( file, id );
+        m_lines.resize( m_files.count() );
+    }
+
+    if ( page >= m_pages.count() )
+        m_pages.resize( page + 1 );
+
+    Point p;
+    p.x = x;
+    p.y = y;
+    p.file = id;
+    p.line = line;
+    p.column = column;
+    p.box = box;
+    m_pages[ page ].append( p );
+
+    LineEntry e;
+    e.line = line;
+    e.page = page;
+    e.x = x;
+    e.y = y;
+    m_lines[ id ].append( e );
+}
+
+void SourceSyncIndex::finish()
+{
+    for ( int i = 0; i < m_pages.count(); ++i )
+    {
+        qSort( m_pages[ i ].begin(), m_pages[ i ].end(), pointLessThan );
+        m_pages[ i ].squeeze();
+    }
+    for ( int i = 0; i < m_boxes.count(); ++i )
+        m_boxes[ i ].squeeze();
+
+    // for the forward search only the first position of each line in each
+    // page is needed
+    for ( int i = 0; i < m_lines.count(); ++i )
+    {
+        QVector< LineEntry > &lines = m_lines[ i ];
+        qSort( lines.begin(), lines.end(), lineLessThan );
+        int kept = 0;
+        for ( int j = 0; j < lines.count(); ++j )
+        {
+            if ( kept > 0 && lines.at( kept - 1 ).line == lines.at( j ).line && lines.at( kept - 1 ).page == lines.at( j ).page )
+                continue;
+            lines[ kept++ ] = lines.at( j );
+        }
+        lines.resize( kept );
+        lines.squeeze();
+    }
+}
+
+bool SourceSyncIndex::isEmpty() const
+{
+    return m_files.isEmpty();
+}
+
+int SourceSyncIndex::pointCount( int page ) const
+{
+    if ( page < 0 || page >= m_pages.count() )
+        return 0;
+    return m_pages.at( page ).count();
+}
+
+void SourceSyncIndex::pointAt( int page, int index, double *x, double *y, QString *file, int *line, int *column ) const
+{
+    const Point &p = m_pages.at( page ).at( index );
+    *x = p.x;
+    *y = p.y;
+    *file = m_files.at( p.file );
+    *line = p.line;
+    *column = p.column;
+}
+
+bool SourceSyncIndex::inverseLookup( int page, double x, double y, QString *file, int *line, int *column ) const
+{
+    if ( page < 0 || page >= m_pages.count() || m_pages.at( page ).isEmpty() )
+        return false;
+
+    // the points are sorted by y: find the ones at the same height
+    const QVector< Point > &points = m_pages.at( page );
+    QVector< Point >::const_iterator start = points.constBegin();
+    int low = 0, high = points.count();
+    while ( low < high )
+    {
+        const int mid = ( low + high ) / 2;
+        if ( pointYLessThan( ( start + mid )->y, y ) )
+            low = mid + 1;
+        else
+            high = mid;
+    }
+
+    int best = -1;
+    double bestDistance = 0;
+
+    // as synctex_edit_query() does, look first for the smallest box
+    // containing the position; a point is inside its box, so only the
+    // points nearer than the highest box of the page can be in one
+    if ( page < m_boxes.count() && !m_boxes.at( page ).isEmpty() )
+    {
+        const QVector< Box > &boxes = m_boxes.at( page );
+        const float maxHeight = m_maxBoxHeights.at( page );
+        double bestArea = 0;
+        int first = low;
+        while ( first > 0 && y - points.at( first - 1 ).y <= maxHeight )
+            --first;
+        for ( int i = first; i < points.count() && points.at( i ).y - y <= maxHeight; ++i )
+        {
+            const Point &p = points.at( i );
+            if ( p.box == -1 )
+                continue;
+            const Box &b = boxes.at( p.box );
+            if ( x < b.left || x > b.right || y < b.top || y > b.bottom )
+                continue;
+            const double area = double( b.right - b.left ) * ( b.bottom - b.top );
+            const double distance = ( p.x - x ) * ( p.x - x ) + ( p.y - y ) * ( p.y - y );
+            if ( best == -1 || area < bestArea || ( area == bestArea && distance < bestDistance ) )
+            {
+                best = i;
+                bestArea = area;
+                bestDistance = distance;
+            }
+        }
+    }
+
+    // no box contains the position: take the nearest point, moving up and
+    // down as long as the points can be nearer than the best one
+    if ( best == -1 )
+    {
+        for ( int i = low; i < points.count(); ++i )
+        {
+            const double dy = points.at( i ).y - y;
+            if ( best != -1 && dy * dy > bestDistance )
+                break;
+            const double dx = points.at( i ).x - x;
+            if ( best == -1 || dx * dx + dy * dy < bestDistance )
+            {
+                best = i;
+                bestDistance = dx * dx + dy * dy;
+            }
+        }
+        for ( int i = low - 1; i >= 0; --i )
+        {
+            const double dy = points.at( i ).y - y;
+            if ( best != -1 && dy * dy > bestDistance )
+                break;
+            const double dx = points.at( i ).x - x;
+            if ( best == -1 || dx * dx + dy * dy < bestDistance )
+            {
+                best = i;
+                bestDistance = dx * dx + dy * dy;
+            }
+        }
+    }
+
+    const Point &p = points.at( best );
+    *file = m_files.at( p.file );
+    *line = p.line;
+    *column = p.column;
+    return true;
+}
+
+int SourceSyncIndex::fileId( const QString &file ) const
+{
+    // the references of the editors can be relative to the document or
+    // absolute, and with or without the extension
+    const QString path = resolvedPath( file );
+    const int id = m_fileIds.value( path, -1 );
+    if ( id != -1 )
+        return id;
+
+    const QLatin1String texStr( ".tex" );
+    if ( path.endsWith( texStr ) )
+        return -1;
+    return m_fileIds.value( path + texStr, -1 );
+}
+
+bool SourceSyncIndex::forwardLookup( const QString &file, int line, int *page, double *x, double *y ) const
+{
+    const int id = fileId( file );
+    if ( id == -1 || m_lines.at( id ).isEmpty() )
+        return false;
+
+    const QVector< LineEntry > &lines = m_lines.at( id );
+    LineEntry key;
+    key.line = line;
+    key.page = -1;
+    key.x = 0;
+    key.y = 0;
+    QVector< LineEntry >::const_iterator it = qLowerBound( lines.constBegin(), lines.constEnd(), key, lineLessThan );
+    // past the last line with a position: use the last one
+    if ( it == lines.constEnd() )
+        --it;
+
+    *page = it->page;
+    *x = it->x;
+    *y = it->y;
+    return true;
+}
+
+
+SourceSyncLoader::SourceSyncLoader( const QString &pdfFilePath, int pages, double dpiX, double dpiY, QObject *parent )
+    : QThread( parent ), m_pdfFilePath( pdfFilePath ), m_pages( pages ),
+      m_dpiX( dpiX ), m_dpiY( dpiY ), m_index( 0 ), m_pdfSync( false ), m_goOn( true )
+{
+}
+
+SourceSyncLoader::~SourceSyncLoader()
+{
+    stop();
+    wait();
+    delete m_index;
+}
+
+SourceSyncIndex * SourceSyncLoader::takeIndex()
+{
+    SourceSyncIndex *index = m_index;
+    m_index = 0;
+    return index;
+}
+
+void SourceSyncLoader::stop()
+{
+    m_goOn = false;
+}
+
+bool SourceSyncLoader::isPdfSync() const
+{
+    return m_pdfSync;
+}
+
+void SourceSyncLoader::run()
+{
+    m_index = new SourceSyncIndex( QFileInfo( m_pdfFilePath ).absolutePath() );
+
+    // no need to check for the existence of a synctex file, the parser
+    // fails quickly if none exists
+    loadSynctex();
+    if ( m_goOn && m_index->isEmpty() && QFile::exists( m_pdfFilePath + QLatin1String( "sync" ) ) )
+    {
+        m_pdfSync = true;
+        loadPdfSync();
+    }
+
+    m_index->finish();
+    kDebug(PDFDebug) << "Source sync index ready, empty:" << m_index->isEmpty();
+}
+
+void SourceSyncLoader::loadSynctex()
+{
+    synctex_scanner_t scanner = synctex_scanner_new_with_output_file( QFile::encodeName( m_pdfFilePath ), 0, 1 );
+    if ( !scanner )
+        return;
+
+    QHash< int, QString > names;
+    for ( int page = 0; page < m_pages && m_goOn; ++page )
+    {
+        int lastTag = -1, lastLine = -1;
+        float lastV = 0;
+        synctex_node_t node = synctex_sheet_content( scanner, page + 1 );
+        for ( ; node; node = synctex_node_next( node ) )
+        {
+            const int line = synctex_node_line( node );
+            if ( line <= 0 )
+                continue;
+
+            // keep only the first node of the runs of the same source line
+            // on the same text line
+            const int tag = synctex_node_tag( node );
+            const float v = synctex_node_visible_v( node );
+            if ( tag == lastTag && line == lastLine && qAbs( v - lastV ) < 1.0 )
+                continue;
+            lastTag = tag;
+            lastLine = line;
+            lastV = v;
+
+            QHash< int, QString >::const_iterator nameIt = names.constFind( tag );
+            if ( nameIt == names.constEnd() )
+            {
+                const char *name = synctex_scanner_get_name( scanner, tag );
+                nameIt = names.insert( tag, name ? m_index->resolvedPath( QFile::decodeName( name ) ) : QString() );
+            }
+            if ( nameIt.value().isEmpty() )
+                continue;
+
+            // the enclosing box, for the hit-testing of the inverse search
+            const float boxH = synctex_node_box_visible_h( node );
+            const float boxV = synctex_node_box_visible_v( node );
+            const int box = m_index->addBox( page, ( boxH * m_dpiX ) / 72.27,
+                                             ( ( boxV - synctex_node_box_visible_height( node ) ) * m_dpiY ) / 72.27,
+                                             ( ( boxH + synctex_node_box_visible_width( node ) ) * m_dpiX ) / 72.27,
+                                             ( ( boxV + synctex_node_box_visible_depth( node ) ) * m_dpiY ) / 72.27 );
+
+            // column extraction does not seem to be implemented in synctex so far
+            const int column = qMax( 0, synctex_node_column( node ) );
+            // TeX small points ...
+            m_index->addPoint( page, ( synctex_node_visible_h( node ) * m_dpiX ) / 72.27,
+                               ( v * m_dpiY ) / 72.27, nameIt.value(), line, column, box );
+        }
+    }
+
+    synctex_scanner_free( scanner );
+}
+
+struct pdfsyncpoint
+{
+    QString file;
+    qlonglong x;
+    qlonglong y;
+    int row;
+    int column;
+    int page;
+};
+
+void SourceSyncLoader::loadPdfSync()
+{
+    QFile f( m_pdfFilePath + QLatin1String( "sync" ) );
+    if ( !f.open( QIODevice::ReadOnly ) )
+        return;
+
+    QTextStream ts( &f );
+    // first row: core name of the pdf output
+    const QString coreName = ts.readLine();
+    // second row: version string, in the form 'Version %u'
+    QString versionstr = ts.readLine();
+    QRegExp versionre( "Version (\\d+)" );
+    versionre.setCaseSensitivity( Qt::CaseInsensitive );
+    if ( !versionre.exactMatch( versionstr ) )
+        return;
+
+    QHash<int, pdfsyncpoint> points;
+    QStack<QString> fileStack;
+    int currentpage = -1;
+    const QLatin1String texStr( ".tex" );
+    const QChar spaceChar = QChar::fromLatin1( ' ' );
+
+    fileStack.push( m_index->resolvedPath( coreName + texStr ) );
+
+    QString line;
+    while ( !ts.atEnd() && m_goOn )
+    {
+        line = ts.readLine();
+        const QStringList tokens = line.split( spaceChar, QString::SkipEmptyParts );
+        const int tokenSize = tokens.count();
+        if ( tokenSize < 1 )
+            continue;
+        if ( tokens.first() == QLatin1String( "l" ) && tokenSize >= 3 )
+        {
+            int id = tokens.at( 1 ).toInt();
+            QHash<int, pdfsyncpoint>::const_iterator it = points.constFind( id );
+            if ( it == points.constEnd() )
+            {
+                pdfsyncpoint pt;
+                pt.x = 0;
+                pt.y = 0;
+                pt.row = tokens.at( 2 ).toInt();
+                pt.column = 0; // TODO
+                pt.page = -1;
+                pt.file = fileStack.top();
+                points[ id ] = pt;
+            }
+        }
+        else if ( tokens.first() == QLatin1String( "s" ) && tokenSize >= 2 )
+        {
+            currentpage = tokens.at( 1 ).toInt() - 1;
+        }
+        else if ( tokens.first() == QLatin1String( "p*" ) && tokenSize >= 4 )
+        {
+            // TODO
+            kDebug(PDFDebug) << "PdfSync: 'p*' line ignored";
+        }
+        else if ( tokens.first() == QLatin1String( "p" ) && tokenSize >= 4 )
+        {
+            int id = tokens.at( 1 ).toInt();
+            QHash<int, pdfsyncpoint>::iterator it = points.find( id );
+            if ( it != points.end() )
+            {
+                it->x = tokens.at( 2 ).toInt();
+                it->y = tokens.at( 3 ).toInt();
+                it->page = currentpage;
+            }
+        }
+        else if ( line.startsWith( QLatin1Char( '(' ) ) && tokenSize == 1 )
+        {
+            QString newfile = line;
+            // chop the leading '('
+            newfile.remove( 0, 1 );
+            if ( !newfile.endsWith( texStr ) )
+            {
+                newfile += texStr;
+            }
+            fileStack.push( m_index->resolvedPath( newfile ) );
+        }
+        else if ( line == QLatin1String( ")" ) )
+        {
+            if ( !fileStack.isEmpty() )
+            {
+                fileStack.pop();
+            }
+            else
+                kDebug(PDFDebug) << "PdfSync: going one level down too much";
+        }
+        else
+            kDebug(PDFDebug).nospace() << "PdfSync: unknown line format: '" << line << "'";
+
+    }
+
+    foreach ( const pdfsyncpoint& pt, points )
+    {
+        // drop pdfsync points not completely valid
+        if ( pt.page < 0 || pt.page >= m_pages )
+            continue;
+
+        // magic numbers for TeX's RSU's (Ridiculously Small Units) conversion to pixels
+        m_index->addPoint( pt.page, ( pt.x * m_dpiX ) / ( 72.27 * 65536.0 ), ( pt.y * m_dpiY ) / ( 72.27 * 65536.0 ),
+                           pt.file, pt.row, pt.column );
+    }
+}
+
+#include "sourcesync.moc"
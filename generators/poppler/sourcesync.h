@@ -0,0 +1,173 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by the Okular developers <okular-devel@kde.org>    *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef _OKULAR_SOURCESYNC_H_
+#define _OKULAR_SOURCESYNC_H_
+
+#include <qdir.h>
+#include <qhash.h>
+#include <qstringlist.h>
+#include <qthread.h>
+#include <qvector.h>
+
+/**
+ * A compact index of the source positions of a document, built from a
+ * SyncTeX or pdfsync file.
+ *
+ * All the positions are in page units (the same as the pages of the
+ * generator); the index answers both the inverse search
+ * (page, position) -> (file, line) and the forward search
+ * (file, line) -> (page, position) in logarithmic time.
+ */
+class SourceSyncIndex
+{
+    public:
+        /**
+         * Creates an empty index, whose relative file names are relative
+         * to @p baseDir.
+         */
+        explicit SourceSyncIndex( const QString &baseDir );
+
+        /**
+         * Returns the absolute path of @p file, resolved against the base
+         * directory of the index; the points are to be added with it.
+         */
+        QString resolvedPath( const QString &file ) const;
+
+        /**
+         * Adds the box with the given edges to the @p page, returning its
+         * id for addPoint(); consecutive additions of the same box return
+         * the same id.
+         */
+        int addBox( int page, double left, double top, double right, double bottom );
+
+        /**
+         * Adds the source position @p file : @p line of the point
+         * (@p x, @p y) of the @p page, contained in the box @p box
+         * (-1 if unknown).
+         */
+        void addPoint( int page, double x, double y, const QString &file, int line, int column, int box = -1 );
+
+        /**
+         * Sorts the index; to be called once all the points were added.
+         */
+        void finish();
+
+        bool isEmpty() const;
+
+        /**
+         * Returns the number of source positions of the @p page.
+         */
+        int pointCount( int page ) const;
+
+        /**
+         * Reads the @p index -th source position of the @p page.
+         */
+        void pointAt( int page, int index, double *x, double *y, QString *file, int *line, int *column ) const;
+
+        /**
+         * Finds the source position of (@p x, @p y) in @p page: like
+         * synctex_edit_query(), the nearest point among the ones in the
+         * smallest box containing the position, or the nearest point of
+         * the page if no box contains it.
+         */
+        bool inverseLookup( int page, double x, double y, QString *file, int *line, int *column ) const;
+
+        /**
+         * Finds the first position of the @p line of @p file (or of the
+         * first line after it having a position) in the document.
+         */
+        bool forwardLookup( const QString &file, int line, int *page, double *x, double *y ) const;
+
+    private:
+        struct Point
+        {
+            float x;
+            float y;
+            int file;
+            int line;
+            int column;
+            int box;
+        };
+
+        struct Box
+        {
+            float left;
+            float top;
+            float right;
+            float bottom;
+        };
+
+        struct LineEntry
+        {
+            int line;
+            int page;
+            float x;
+            float y;
+        };
+
+        static bool pointLessThan( const Point &p1, const Point &p2 );
+        static bool lineLessThan( const LineEntry &e1, const LineEntry &e2 );
+        int fileId( const QString &file ) const;
+
+        QDir m_baseDir;
+        QVector< QVector< Point > > m_pages;
+        QVector< QVector< Box > > m_boxes;
+        // the highest box of each page, bounding the points to look at
+        QVector< float > m_maxBoxHeights;
+        QVector< QVector< LineEntry > > m_lines;
+        QStringList m_files;
+        QHash< QString, int > m_fileIds;
+};
+
+/**
+ * Parses a SyncTeX or a pdfsync file in a thread, filling a SourceSyncIndex.
+ */
+class SourceSyncLoader : public QThread
+{
+    Q_OBJECT
+
+    public:
+        SourceSyncLoader( const QString &pdfFilePath, int pages, double dpiX, double dpiY, QObject *parent = 0 );
+        ~SourceSyncLoader();
+
+        /**
+         * Returns the index, passing its ownership to the caller; to be
+         * called only once the loader finished.
+         */
+        SourceSyncIndex * takeIndex();
+
+        /**
+         * Asks the loader to stop as soon as possible, without waiting.
+         */
+        void stop();
+
+        /**
+         * Whether the index was built from a pdfsync file rather than a
+         * SyncTeX one.
+         */
+        bool isPdfSync() const;
+
+    protected:
+        virtual void run();
+
+    private:
+        void loadSynctex();
+        void loadPdfSync();
+
+        QString m_pdfFilePath;
+        int m_pages;
+        double m_dpiX;
+        double m_dpiY;
+        SourceSyncIndex *m_index;
+        bool m_pdfSync;
+        bool m_goOn;
+};
+
+#endif
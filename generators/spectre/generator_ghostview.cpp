@@ -192,6 +192,14 @@ void GSGenerator::slotImageGenerated(QImage *img, Okular::PixmapRequest *request
     // of all the generators attached to it
     if (request != m_request) return;
 
+    if ( request->isCancelled() )
+    {
+        m_request = 0;
+        delete img;
+        signalPixmapRequestDone( request );
+        return;
+    }
+
     if ( !request->page()->isBoundingBoxKnown() )
         updatePageBoundingBox( request->page()->number(), Okular::Utils::imageBoundingBox( img ) );
 
@@ -53,6 +53,15 @@ void GSRendererThread::run()
             GSRendererThreadRequest req = m_queue.dequeue();
             m_queueMutex.unlock();
 
+            // libspectre can not be interrupted, so only skip the requests
+            // cancelled while waiting in the queue
+            if (req.request->isCancelled())
+            {
+                emit imageDone(new QImage(), req.request);
+                spectre_page_free(req.spectrePage);
+                continue;
+            }
+
             spectre_render_context_set_scale(m_renderContext, req.magnify, req.magnify);
             spectre_render_context_set_use_platform_fonts(m_renderContext, req.platformFonts);
             spectre_render_context_set_antialias_bits(m_renderContext, req.graphicsAAbits, req.textAAbits);
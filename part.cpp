@@ -335,6 +335,9 @@ m_cliPresentation(false), m_embedMode(detectEmbedMode(parentWidget, parent, args
     connect( m_document, SIGNAL(openUrl(KUrl)), this, SLOT(openUrlFromDocument(KUrl)) );
     connect( m_document->bookmarkManager(), SIGNAL(openUrl(KUrl)), this, SLOT(openUrlFromBookmarks(KUrl)) );
     connect( m_document, SIGNAL(close()), this, SLOT(close()) );
+    // the generator asks for them while loading, so let it finish first
+    connect( m_document, SIGNAL(reloadRequested()), this, SLOT(slotReload()), Qt::QueuedConnection );
+    connect( m_document, SIGNAL(closeRequested()), this, SLOT(closeUrlFromDocument()), Qt::QueuedConnection );
 
     if ( parent && parent->metaObject()->indexOfSlot( QMetaObject::normalizedSignature( "slotQuit()" ) ) != -1 )
         connect( m_document, SIGNAL(quit()), parent, SLOT(slotQuit()) );
@@ -935,6 +938,11 @@ void Part::openUrlFromDocument(const KUrl &url)
     }
 }
 
+void Part::closeUrlFromDocument()
+{
+    closeUrl();
+}
+
 void Part::openUrlFromBookmarks(const KUrl &_url)
 {
     KUrl url = _url;
@@ -2099,7 +2107,7 @@ void Part::slotPreferences()
         return;
 
     // we didn't find an instance of this dialog, so lets create it
-    PreferencesDialog * dialog = new PreferencesDialog( m_pageView, Okular::Settings::self(), m_embedMode );
+    PreferencesDialog * dialog = new PreferencesDialog( m_pageView, Okular::Settings::self(), m_embedMode, m_document );
     // keep us informed when the user changes settings
     connect( dialog, SIGNAL(settingsChanged(QString)), this, SLOT(slotNewConfig()) );
 
@@ -167,6 +167,7 @@ class Part : public KParts::ReadWritePart, public Okular::DocumentObserver, publ
     protected slots:
         // connected to actions
         void openUrlFromDocument(const KUrl &url);
+        void closeUrlFromDocument();
         void openUrlFromBookmarks(const KUrl &url);
         void slotGoToPage();
         void slotHistoryBack();
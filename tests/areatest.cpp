@@ -0,0 +1,187 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by the Okular developers <okular-devel@kde.org>    *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include <qtest_kde.h>
+
+#include "../core/area.h"
+#include "../core/area_p.h"
+
+Q_DECLARE_METATYPE( Okular::NormalizedRect )
+
+namespace QTest
+{
+template<>
+char* toString( const Okular::NormalizedRect& rect )
+{
+    return qstrdup( QString( "(%1, %2, %3, %4)" ).arg( rect.left ).arg( rect.top )
+                    .arg( rect.right ).arg( rect.bottom ).toLocal8Bit() );
+}
+}
+
+class AreaTest
+    : public QObject
+{
+    Q_OBJECT
+
+    private slots:
+        void testSimplifyEmpty();
+        void testSimplifyMerge();
+        void testSimplifyChain();
+        void testIndexEmpty();
+        void testIndexContains_data();
+        void testIndexContains();
+        void testIndexIntersects_data();
+        void testIndexIntersects();
+        void testIndexMatchesArea();
+};
+
+// two lines of rects: a wide rect before a narrow one in the first line,
+// so a point past the narrow one is found only through the wide one; a
+// single rect in the second line
+static void fillArea( Okular::RegularAreaRect &area )
+{
+    area.append( Okular::NormalizedRect( 0.3, 0.1, 0.4, 0.2 ) );
+    area.append( Okular::NormalizedRect( 0.1, 0.5, 0.9, 0.6 ) );
+    area.append( Okular::NormalizedRect( 0.0, 0.1, 0.8, 0.15 ) );
+    area.append( Okular::NormalizedRect( 0.85, 0.12, 0.9, 0.25 ) );
+}
+
+void AreaTest::testSimplifyEmpty()
+{
+    Okular::RegularAreaRect area;
+    area.simplify();
+    QCOMPARE( area.count(), 0 );
+
+    area.append( Okular::NormalizedRect( 0.1, 0.1, 0.2, 0.2 ) );
+    area.simplify();
+    QCOMPARE( area.count(), 1 );
+    QCOMPARE( area.first(), Okular::NormalizedRect( 0.1, 0.1, 0.2, 0.2 ) );
+}
+
+void AreaTest::testSimplifyMerge()
+{
+    Okular::RegularAreaRect area;
+    area.append( Okular::NormalizedRect( 0.0, 0.0, 0.2, 0.1 ) );
+    area.append( Okular::NormalizedRect( 0.1, 0.0, 0.3, 0.1 ) );
+    area.append( Okular::NormalizedRect( 0.5, 0.5, 0.6, 0.6 ) );
+    area.append( Okular::NormalizedRect( 0.55, 0.5, 0.7, 0.65 ) );
+    area.simplify();
+
+    QCOMPARE( area.count(), 2 );
+    QCOMPARE( area.at( 0 ), Okular::NormalizedRect( 0.0, 0.0, 0.3, 0.1 ) );
+    QCOMPARE( area.at( 1 ), Okular::NormalizedRect( 0.5, 0.5, 0.7, 0.65 ) );
+}
+
+void AreaTest::testSimplifyChain()
+{
+    // the third rect intersects only the union of the first two
+    Okular::RegularAreaRect area;
+    area.append( Okular::NormalizedRect( 0.0, 0.0, 0.2, 0.1 ) );
+    area.append( Okular::NormalizedRect( 0.15, 0.0, 0.3, 0.1 ) );
+    area.append( Okular::NormalizedRect( 0.25, 0.0, 0.4, 0.1 ) );
+    area.simplify();
+
+    QCOMPARE( area.count(), 1 );
+    QCOMPARE( area.first(), Okular::NormalizedRect( 0.0, 0.0, 0.4, 0.1 ) );
+}
+
+void AreaTest::testIndexEmpty()
+{
+    const Okular::RegularAreaRect area;
+    const Okular::RegularAreaRectIndex index( area );
+
+    QVERIFY( !index.contains( 0.5, 0.5 ) );
+    QVERIFY( !index.intersects( Okular::NormalizedRect( 0.0, 0.0, 1.0, 1.0 ) ) );
+}
+
+void AreaTest::testIndexContains_data()
+{
+    QTest::addColumn<double>( "x" );
+    QTest::addColumn<double>( "y" );
+    QTest::addColumn<bool>( "contained" );
+
+    QTest::newRow( "above the first line" ) << 0.35 << 0.05 << false;
+    QTest::newRow( "top left corner of the first line" ) << 0.0 << 0.1 << true;
+    QTest::newRow( "before the first rect" ) << -0.01 << 0.12 << false;
+    QTest::newRow( "in the wide rect only" ) << 0.6 << 0.12 << true;
+    QTest::newRow( "in both rects" ) << 0.35 << 0.12 << true;
+    QTest::newRow( "gap in the line" ) << 0.82 << 0.12 << false;
+    QTest::newRow( "bottom right corner of the last rect of the line" ) << 0.9 << 0.25 << true;
+    QTest::newRow( "below the narrow rect" ) << 0.35 << 0.22 << false;
+    QTest::newRow( "between the lines" ) << 0.5 << 0.4 << false;
+    QTest::newRow( "left edge of the last line" ) << 0.1 << 0.55 << true;
+    QTest::newRow( "bottom right corner of the last line" ) << 0.9 << 0.6 << true;
+    QTest::newRow( "after the last rect" ) << 0.95 << 0.55 << false;
+    QTest::newRow( "below the last line" ) << 0.5 << 0.7 << false;
+}
+
+void AreaTest::testIndexContains()
+{
+    QFETCH( double, x );
+    QFETCH( double, y );
+    QFETCH( bool, contained );
+
+    Okular::RegularAreaRect area;
+    fillArea( area );
+    const Okular::RegularAreaRectIndex index( area );
+
+    QCOMPARE( index.contains( x, y ), contained );
+}
+
+void AreaTest::testIndexIntersects_data()
+{
+    QTest::addColumn<Okular::NormalizedRect>( "rect" );
+    QTest::addColumn<bool>( "intersected" );
+
+    QTest::newRow( "above everything" ) << Okular::NormalizedRect( 0.0, 0.0, 1.0, 0.05 ) << false;
+    QTest::newRow( "touching the top of the first line" ) << Okular::NormalizedRect( 0.5, 0.0, 0.6, 0.1 ) << true;
+    QTest::newRow( "in the gap of the first line" ) << Okular::NormalizedRect( 0.81, 0.11, 0.84, 0.14 ) << false;
+    QTest::newRow( "between the lines" ) << Okular::NormalizedRect( 0.0, 0.3, 1.0, 0.45 ) << false;
+    QTest::newRow( "right of everything" ) << Okular::NormalizedRect( 0.95, 0.0, 0.96, 1.0 ) << false;
+    QTest::newRow( "covering the last line" ) << Okular::NormalizedRect( 0.0, 0.45, 1.0, 0.65 ) << true;
+    QTest::newRow( "touching the right of the last line" ) << Okular::NormalizedRect( 0.9, 0.55, 1.0, 0.56 ) << true;
+    QTest::newRow( "below everything" ) << Okular::NormalizedRect( 0.0, 0.61, 1.0, 1.0 ) << false;
+}
+
+void AreaTest::testIndexIntersects()
+{
+    QFETCH( Okular::NormalizedRect, rect );
+    QFETCH( bool, intersected );
+
+    Okular::RegularAreaRect area;
+    fillArea( area );
+    const Okular::RegularAreaRectIndex index( area );
+
+    QCOMPARE( index.intersects( rect ), intersected );
+}
+
+void AreaTest::testIndexMatchesArea()
+{
+    Okular::RegularAreaRect area;
+    fillArea( area );
+    const Okular::RegularAreaRectIndex index( area );
+
+    // the index answers like the linear scans of the area
+    for ( int i = 0; i <= 40; ++i )
+    {
+        for ( int j = 0; j <= 40; ++j )
+        {
+            const double x = i / 40.0;
+            const double y = j / 40.0;
+            QCOMPARE( index.contains( x, y ), area.contains( x, y ) );
+
+            const Okular::NormalizedRect rect( x, y, x + 0.03, y + 0.03 );
+            QCOMPARE( index.intersects( rect ), area.intersects( rect ) );
+        }
+    }
+}
+
+QTEST_KDEMAIN_CORE( AreaTest )
+
+#include "areatest.moc"
@@ -0,0 +1,319 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by the Okular developers <okular-devel@kde.org>    *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+// A headless benchmark for okularcore: it opens a document with any of the
+// installed generators and times the operations a viewer does, printing the
+// results as one JSON object per line, eg:
+//   okularbenchmark --dpi 72,150 --search okular file.pdf > results.json
+
+#include <qcolor.h>
+#include <qdatetime.h>
+#include <qeventloop.h>
+#include <qfileinfo.h>
+#include <qlinkedlist.h>
+#include <qset.h>
+#include <qsize.h>
+#include <qstringlist.h>
+#include <qtextstream.h>
+#include <qtimer.h>
+
+#include <kaboutdata.h>
+#include <kapplication.h>
+#include <kcmdlineargs.h>
+#include <kmimetype.h>
+#include <kurl.h>
+
+#include "core/document.h"
+#include "core/generator.h"
+#include "core/observer.h"
+#include "core/page.h"
+#include "core/renderstatistics.h"
+
+// how long to wait for a single operation before giving up on it
+#define BENCHMARK_TIMEOUT 120000
+
+static QTextStream out( stdout );
+
+static QString jsonString( const QString &str )
+{
+    QString escaped = str;
+    escaped.replace( '\\', "\\\\" ).replace( '"', "\\\"" ).replace( '\n', "\\n" );
+    return '"' + escaped + '"';
+}
+
+static void report( const QString &file, const QString &metric, const QString &extra, double msecs )
+{
+    out << "{\"file\": " << jsonString( file )
+        << ", \"metric\": " << jsonString( metric );
+    if ( !extra.isEmpty() )
+        out << ", " << extra;
+    out << ", \"ms\": " << msecs << "}" << endl;
+}
+
+class BenchmarkObserver : public Okular::DocumentObserver
+{
+    public:
+        BenchmarkObserver( uint id, int priority )
+            : m_id( id ), m_priority( priority ), m_loop( 0 )
+        {
+        }
+
+        uint observerId() const
+        {
+            return m_id;
+        }
+
+        void notifyPageChanged( int page, int flags )
+        {
+            if ( !( flags & Pixmap ) || !m_pending.remove( page ) )
+                return;
+
+            if ( m_pending.isEmpty() && m_loop )
+                m_loop->quit();
+        }
+
+        /**
+         * Renders the @p page of the @p document at @p width x @p height and
+         * waits for it; returns the time it took, or -1 on failure.
+         */
+        int renderPage( Okular::Document *document, int page, int width, int height )
+        {
+            // the document drops the requests that are too big
+            if ( (long)width * (long)height > 20000000L )
+                return -1;
+
+            // the document drops the requests for a pixmap the page already
+            // has, so make it render the page again
+            Okular::Page *p = const_cast< Okular::Page * >( document->page( page ) );
+            if ( p && p->hasPixmap( m_id, width, height ) )
+                p->deletePixmap( m_id );
+
+            QTime time;
+            time.start();
+
+            m_pending.insert( page );
+            QLinkedList< Okular::PixmapRequest * > requests;
+            requests.append( new Okular::PixmapRequest( m_id, page, width, height, m_priority, true ) );
+            document->requestPixmaps( requests, Okular::Document::NoOption );
+
+            if ( !m_pending.isEmpty() )
+            {
+                QEventLoop loop;
+                m_loop = &loop;
+                QTimer::singleShot( BENCHMARK_TIMEOUT, &loop, SLOT(quit()) );
+                loop.exec();
+                m_loop = 0;
+            }
+
+            const bool done = m_pending.isEmpty();
+            m_pending.clear();
+            return done ? time.elapsed() : -1;
+        }
+
+    private:
+        uint m_id;
+        int m_priority;
+        QSet< int > m_pending;
+        QEventLoop *m_loop;
+};
+
+static QSize pageSize( const Okular::Page *page, int dpi )
+{
+    // the size of the pages is in points, ie at 72 DPI
+    return QSize( qRound( page->width() * dpi / 72.0 ), qRound( page->height() * dpi / 72.0 ) );
+}
+
+static void benchmarkRendering( Okular::Document *document, BenchmarkObserver *observer, const QString &file, const QList< int > &dpis )
+{
+    const int pages = document->pages();
+
+    for ( int i = 0; i < dpis.count(); ++i )
+    {
+        const int dpi = dpis.at( i );
+        const QString dpiField = QString( "\"dpi\": %1" ).arg( dpi );
+
+        // start from an empty cache for each resolution
+        document->removeObserver( observer );
+        document->addObserver( observer );
+
+        int failed = 0;
+        double total = 0;
+        for ( int page = 0; page < pages; ++page )
+        {
+            const QSize size = pageSize( document->page( page ), dpi );
+            const int msecs = observer->renderPage( document, page, size.width(), size.height() );
+            if ( msecs < 0 )
+                ++failed;
+            else
+                total += msecs;
+        }
+        report( file, "document_render", dpiField + QString( ", \"pages\": %1, \"failed\": %2" ).arg( pages ).arg( failed ), total );
+    }
+}
+
+static void benchmarkThumbnails( Okular::Document *document, BenchmarkObserver *observer, const QString &file, int thumbnailWidth )
+{
+    const int pages = document->pages();
+    int failed = 0;
+    double total = 0;
+    for ( int page = 0; page < pages; ++page )
+    {
+        const int height = qRound( thumbnailWidth * document->page( page )->ratio() );
+        const int msecs = observer->renderPage( document, page, thumbnailWidth, height );
+        if ( msecs < 0 )
+            ++failed;
+        else
+            total += msecs;
+    }
+    report( file, "thumbnails", QString( "\"width\": %1, \"pages\": %2, \"failed\": %3" ).arg( thumbnailWidth ).arg( pages ).arg( failed ), total );
+}
+
+static void benchmarkText( Okular::Document *document, const QString &file )
+{
+    const int pages = document->pages();
+    int extracted = 0;
+    QTime time;
+    time.start();
+    for ( int page = 0; page < pages; ++page )
+    {
+        if ( document->page( page )->hasTextPage() )
+            continue;
+
+        document->requestTextPage( page );
+        ++extracted;
+    }
+    report( file, "text_extraction", QString( "\"pages\": %1" ).arg( extracted ), time.elapsed() );
+}
+
+static void benchmarkSearch( Okular::Document *document, const QString &file, const QString &text )
+{
+    // searchFinished() is emitted asynchronously for non empty texts
+    QEventLoop loop;
+    QObject::connect( document, SIGNAL(searchFinished(int,Okular::Document::SearchStatus)), &loop, SLOT(quit()) );
+    QTimer::singleShot( BENCHMARK_TIMEOUT, &loop, SLOT(quit()) );
+
+    QTime time;
+    time.start();
+    document->searchText( PART_SEARCH_ID, text, true, Qt::CaseInsensitive, Okular::Document::AllDocument, false, QColor( Qt::yellow ), true );
+    loop.exec();
+    report( file, "search", QString( "\"text\": %1" ).arg( jsonString( text ) ), time.elapsed() );
+    document->resetSearch( PART_SEARCH_ID );
+}
+
+static void reportStatistics( Okular::Document *document, const QString &file )
+{
+    const Okular::RenderStatistics stats = document->renderStatistics();
+    const QList< int > buckets = Okular::RenderStatistics::latencyBuckets();
+    const QVector< qulonglong > histogram = stats.latencyHistogram( Okular::RenderStatistics::PixmapRendering );
+
+    QStringList bucketCounts;
+    for ( int i = 0; i < histogram.count(); ++i )
+        bucketCounts << QString::number( histogram.at( i ) );
+    QStringList bucketLimits;
+    foreach ( int limit, buckets )
+        bucketLimits << QString::number( limit );
+
+    report( file, "render_statistics",
+            QString( "\"generator\": %1, \"renders\": %2, \"max_ms\": %3, \"evicted\": %4, \"bucket_limits\": [%5], \"buckets\": [%6]" )
+                .arg( jsonString( stats.generatorName() ) )
+                .arg( stats.operationCount( Okular::RenderStatistics::PixmapRendering ) )
+                .arg( stats.maximumLatency( Okular::RenderStatistics::PixmapRendering ) )
+                .arg( stats.counter( Okular::RenderStatistics::PixmapsEvicted ) )
+                .arg( bucketLimits.join( ", " ) )
+                .arg( bucketCounts.join( ", " ) ),
+            stats.averageLatency( Okular::RenderStatistics::PixmapRendering ) );
+}
+
+int main( int argc, char **argv )
+{
+    KAboutData about( "okularbenchmark", 0, ki18n( "Okular Benchmark" ), "0.1",
+                      ki18n( "Times the document operations of okularcore" ),
+                      KAboutData::License_GPL );
+
+    KCmdLineArgs::init( argc, argv, &about );
+
+    KCmdLineOptions options;
+    options.add( "dpi <list>", ki18n( "Comma separated list of resolutions to render at" ), "72,150,300" );
+    options.add( "search <text>", ki18n( "Text to search for" ), "the" );
+    options.add( "thumbnail-width <pixels>", ki18n( "Width of the thumbnails" ), "128" );
+    options.add( "+file", ki18n( "Documents to benchmark" ) );
+    KCmdLineArgs::addCmdLineOptions( options );
+
+    // pixmaps can be created only with a windowing system: without it, the
+    // rendering benchmarks are skipped, but nothing is ever shown anyway
+#ifdef Q_WS_X11
+    const bool hasDisplay = !qgetenv( "DISPLAY" ).isEmpty();
+#else
+    const bool hasDisplay = true;
+#endif
+    KApplication app( hasDisplay );
+
+    KCmdLineArgs *args = KCmdLineArgs::parsedArgs();
+    if ( args->count() == 0 )
+        KCmdLineArgs::usageError( "No document specified" );
+
+    QList< int > dpis;
+    foreach ( const QString &dpi, args->getOption( "dpi" ).split( ',', QString::SkipEmptyParts ) )
+        if ( dpi.toInt() > 0 )
+            dpis.append( dpi.toInt() );
+    const QString searchText = args->getOption( "search" );
+    const int thumbnailWidth = qMax( 16, args->getOption( "thumbnail-width" ).toInt() );
+
+    int ret = 0;
+    for ( int i = 0; i < args->count(); ++i )
+    {
+        const QString file = QFileInfo( args->arg( i ) ).absoluteFilePath();
+        const KMimeType::Ptr mime = KMimeType::findByPath( file );
+
+        Okular::Document document( 0 );
+        BenchmarkObserver pageObserver( PAGEVIEW_ID, PAGEVIEW_PRIO );
+        BenchmarkObserver thumbnailObserver( THUMBNAILS_ID, THUMBNAILS_PRIO );
+
+        QTime time;
+        time.start();
+        if ( !document.openDocument( file, KUrl( file ), mime ) || document.pages() == 0 )
+        {
+            report( file, "open_failed", QString( "\"mimetype\": %1" ).arg( jsonString( mime->name() ) ), time.elapsed() );
+            ret = 1;
+            continue;
+        }
+        report( file, "open", QString( "\"mimetype\": %1, \"pages\": %2" ).arg( jsonString( mime->name() ) ).arg( document.pages() ), time.elapsed() );
+
+        document.addObserver( &pageObserver );
+        document.addObserver( &thumbnailObserver );
+
+        if ( hasDisplay && !dpis.isEmpty() )
+        {
+            const QSize firstSize = pageSize( document.page( 0 ), dpis.first() );
+            report( file, "first_page_render", QString( "\"dpi\": %1" ).arg( dpis.first() ),
+                    pageObserver.renderPage( &document, 0, firstSize.width(), firstSize.height() ) );
+        }
+
+        if ( document.supportsSearching() )
+        {
+            benchmarkText( &document, file );
+            if ( !searchText.isEmpty() )
+                benchmarkSearch( &document, file, searchText );
+        }
+
+        if ( hasDisplay )
+        {
+            benchmarkRendering( &document, &pageObserver, file, dpis );
+            benchmarkThumbnails( &document, &thumbnailObserver, file, thumbnailWidth );
+            reportStatistics( &document, file );
+        }
+
+        document.removeObserver( &thumbnailObserver );
+        document.removeObserver( &pageObserver );
+        document.closeDocument();
+    }
+
+    args->clear();
+    return ret;
+}
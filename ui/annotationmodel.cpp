@@ -9,9 +9,12 @@
 
 #include "annotationmodel.h"
 
+#include <qdatetime.h>
+#include <qhash.h>
 #include <qlinkedlist.h>
 #include <qlist.h>
 #include <qpointer.h>
+#include <qset.h>
 
 #include <kicon.h>
 #include <klocale.h>
@@ -31,9 +34,13 @@ struct AnnItem
 
     AnnItem *parent;
     QList< AnnItem* > children;
+    // position in the children of the parent
+    int row;
 
     Okular::Annotation *annotation;
     int page;
+    // what is shown of the annotation, to find out whether it changed
+    uint signature;
 };
 
 
@@ -49,28 +56,51 @@ public:
 
     QModelIndex indexForItem( AnnItem *item ) const;
     void rebuildTree( const QVector< Okular::Page * > &pages );
-    AnnItem* findItem( int page, int *index ) const;
+    AnnItem* addAnnotationItem( AnnItem *pageItem, Okular::Annotation *ann );
+    void removeItems( AnnItem *parent, int first, int last );
+    void forgetItem( AnnItem *item );
 
     AnnotationModel *q;
     AnnItem *root;
     QPointer< Okular::Document > document;
+
+    // the items of the pages and of the annotations, for the lookups while
+    // updating the tree
+    QHash< int, AnnItem* > pageItems;
+    QHash< Okular::Annotation*, AnnItem* > annotationItems;
 };
 
 
+static uint annotationSignature( const Okular::Annotation *ann )
+{
+    return qHash( GuiUtils::captionForAnnotation( ann ) + QLatin1Char( '\n' )
+                  + GuiUtils::authorForAnnotation( ann ) + QLatin1Char( '\n' )
+                  + GuiUtils::contents( ann ) + QLatin1Char( '\n' )
+                  + ann->modificationDate().toString( Qt::ISODate ) );
+}
+
+static void renumberChildren( AnnItem *parent, int from )
+{
+    for ( int i = from; i < parent->children.count(); ++i )
+        parent->children.at( i )->row = i;
+}
+
+
 AnnItem::AnnItem()
-    : parent( 0 ), annotation( 0 ), page( -1 )
+    : parent( 0 ), row( 0 ), annotation( 0 ), page( -1 ), signature( 0 )
 {
 }
 
 AnnItem::AnnItem( AnnItem *_parent, Okular::Annotation *ann )
-    : parent( _parent ), annotation( ann ), page( _parent->page )
+    : parent( _parent ), row( _parent->children.count() ), annotation( ann ), page( _parent->page ),
+      signature( annotationSignature( ann ) )
 {
     Q_ASSERT( !parent->annotation );
     parent->children.append( this );
 }
 
 AnnItem::AnnItem( AnnItem *_parent, int _page )
-    : parent( _parent ), annotation( 0 ), page( _page )
+    : parent( _parent ), row( _parent->children.count() ), annotation( 0 ), page( _page ), signature( 0 )
 {
     Q_ASSERT( !parent->parent );
     parent->children.append( this );
@@ -104,6 +134,8 @@ void AnnotationModelPrivate::notifySetup( const QVector< Okular::Page * > &pages
 
     qDeleteAll( root->children );
     root->children.clear();
+    pageItems.clear();
+    annotationItems.clear();
     q->reset();
 
     rebuildTree( pages );
@@ -115,111 +147,109 @@ void AnnotationModelPrivate::notifyPageChanged( int page, int flags )
     if ( !(flags & Okular::DocumentObserver::Annotations ) )
         return;
 
-    QLinkedList< Okular::Annotation* > annots = document->page( page )->annotations();
-    int annItemIndex = -1;
-    AnnItem *annItem = findItem( page, &annItemIndex );
+    const QLinkedList< Okular::Annotation* > annots = document->page( page )->annotations();
+    AnnItem *annItem = pageItems.value( page );
     // case 1: the page has no more annotations
     //         => remove the branch, if any
     if ( annots.isEmpty() )
     {
         if ( annItem )
-        {
-            q->beginRemoveRows( indexForItem( root ), annItemIndex, annItemIndex );
-            delete root->children.at( annItemIndex );
-            root->children.removeAt( annItemIndex );
-            q->endRemoveRows();
-        }
+            removeItems( root, annItem->row, annItem->row );
         return;
     }
     // case 2: no existing branch
-    //         => add a new branch, and add the annotations for the page
+    //         => add a new branch, with the annotations for the page
     if ( !annItem )
     {
-        int i = 0;
-        while ( i < root->children.count() && root->children.at( i )->page < page ) ++i;
+        // the branches are sorted by page
+        int first = 0, last = root->children.count();
+        while ( first < last )
+        {
+            const int mid = ( first + last ) / 2;
+            if ( root->children.at( mid )->page < page )
+                first = mid + 1;
+            else
+                last = mid;
+        }
 
-        AnnItem *annItem = new AnnItem();
+        annItem = new AnnItem();
         annItem->page = page;
         annItem->parent = root;
-        q->beginInsertRows( indexForItem( root ), i, i );
-        annItem->parent->children.insert( i, annItem );
-        q->endInsertRows();
+        q->beginInsertRows( indexForItem( root ), first, first );
+        root->children.insert( first, annItem );
+        renumberChildren( root, first );
+        pageItems.insert( page, annItem );
         QLinkedList< Okular::Annotation* >::ConstIterator it = annots.begin(), itEnd = annots.end();
-        int newid = 0;
-        for ( ; it != itEnd; ++it, ++newid )
-        {
-            q->beginInsertRows( indexForItem( annItem ), newid, newid );
-            new AnnItem( annItem, *it );
-            q->endInsertRows();
-        }
+        for ( ; it != itEnd; ++it )
+            addAnnotationItem( annItem, *it );
+        q->endInsertRows();
         return;
     }
-    // case 3: existing branch, less annotations than items
-    //         => lookup and remove the annotations
-    if ( annItem->children.count() > annots.count() )
+
+    // case 3: existing branch
+    //         => remove the items of the annotations no more in the page,
+    //            add the new annotations and update the changed ones,
+    //            notifying each contiguous range of items at once
+    QSet< Okular::Annotation* > current;
+    current.reserve( annots.count() );
+    QLinkedList< Okular::Annotation* >::ConstIterator it = annots.begin(), itEnd = annots.end();
+    for ( ; it != itEnd; ++it )
+        current.insert( *it );
+
+    for ( int i = annItem->children.count() - 1; i >= 0; --i )
     {
-        for ( int i = annItem->children.count(); i > 0; --i )
-        {
-            Okular::Annotation *ref = annItem->children.at( i - 1 )->annotation;
-            bool found = false;
-            QLinkedList< Okular::Annotation* >::ConstIterator it = annots.begin(), itEnd = annots.end();
-            for ( ; !found && it != itEnd; ++it )
-            {
-                if ( ( *it ) == ref )
-                    found = true;
-            }
-            if ( !found )
-            {
-                q->beginRemoveRows( indexForItem( annItem ), i - 1, i - 1 );
-                delete annItem->children.at( i - 1 );
-                annItem->children.removeAt( i - 1 );
-                q->endRemoveRows();
-            }
-        }
-        return;
+        if ( current.contains( annItem->children.at( i )->annotation ) )
+            continue;
+
+        const int last = i;
+        while ( i > 0 && !current.contains( annItem->children.at( i - 1 )->annotation ) )
+            --i;
+        removeItems( annItem, i, last );
     }
-    // case 4: existing branch, less items than annotations
-    //         => lookup and add annotations if not in the branch
-    if ( annots.count() > annItem->children.count() )
+
+    QList< Okular::Annotation* > added;
+    for ( it = annots.begin(); it != itEnd; ++it )
+        if ( !annotationItems.contains( *it ) )
+            added.append( *it );
+    if ( !added.isEmpty() )
     {
-        QLinkedList< Okular::Annotation* >::ConstIterator it = annots.begin(), itEnd = annots.end();
-        for ( ; it != itEnd; ++it )
-        {
-            Okular::Annotation *ref = *it;
-            bool found = false;
-            int count = annItem->children.count();
-            for ( int i = 0; !found && i < count; ++i )
-            {
-                if ( ref == annItem->children.at( i )->annotation )
-                    found = true;
-            }
-            if ( !found )
-            {
-                q->beginInsertRows( indexForItem( annItem ), count, count );
-                new AnnItem( annItem, ref );
-                q->endInsertRows();
-            }
-        }
-        return;
+        const int count = annItem->children.count();
+        q->beginInsertRows( indexForItem( annItem ), count, count + added.count() - 1 );
+        foreach ( Okular::Annotation *ann, added )
+            addAnnotationItem( annItem, ann );
+        q->endInsertRows();
     }
-    // case 5: the data of some annotation changed
-    // TODO: what do we do in this case?
-    // FIXME: for now, update ALL the annotations for that page
-    for ( int i = 0; i < annItem->children.count(); ++i )
+
+    int firstChanged = -1;
+    const int count = annItem->children.count();
+    for ( int i = 0; i <= count; ++i )
     {
-        QModelIndex index = indexForItem( annItem->children.at( i ) );
-        emit q->dataChanged( index, index );
+        bool changed = false;
+        if ( i < count )
+        {
+            AnnItem *item = annItem->children.at( i );
+            const uint signature = annotationSignature( item->annotation );
+            changed = signature != item->signature;
+            item->signature = signature;
+        }
+
+        if ( changed && firstChanged == -1 )
+        {
+            firstChanged = i;
+        }
+        else if ( !changed && firstChanged != -1 )
+        {
+            emit q->dataChanged( indexForItem( annItem->children.at( firstChanged ) ),
+                                 indexForItem( annItem->children.at( i - 1 ) ) );
+            firstChanged = -1;
+        }
     }
 }
 
 QModelIndex AnnotationModelPrivate::indexForItem( AnnItem *item ) const
 {
     if ( item->parent )
-    {
-        int id = item->parent->children.indexOf( item );
-        if ( id >= 0 && id < item->parent->children.count() )
-           return q->createIndex( id, 0, item );
-    }
+        return q->createIndex( item->row, 0, item );
     return QModelIndex();
 }
 
@@ -236,30 +266,48 @@ void AnnotationModelPrivate::rebuildTree( const QVector< Okular::Page * > &pages
             continue;
 
         AnnItem *annItem = new AnnItem( root, i );
+        pageItems.insert( i, annItem );
         QLinkedList< Okular::Annotation* >::ConstIterator it = annots.begin(), itEnd = annots.end();
         for ( ; it != itEnd; ++it )
         {
-            new AnnItem( annItem, *it );
+            addAnnotationItem( annItem, *it );
         }
     }
     emit q->layoutChanged();
 }
 
-AnnItem* AnnotationModelPrivate::findItem( int page, int *index ) const
+AnnItem* AnnotationModelPrivate::addAnnotationItem( AnnItem *pageItem, Okular::Annotation *ann )
+{
+    AnnItem *item = new AnnItem( pageItem, ann );
+    annotationItems.insert( ann, item );
+    return item;
+}
+
+void AnnotationModelPrivate::removeItems( AnnItem *parent, int first, int last )
 {
-    for ( int i = 0; i < root->children.count(); ++i )
+    q->beginRemoveRows( indexForItem( parent ), first, last );
+    for ( int i = first; i <= last; ++i )
     {
-        AnnItem *tmp = root->children.at( i );
-        if ( tmp->page == page )
-        {
-            if ( index )
-                *index = i;
-            return tmp;
-        }
+        AnnItem *item = parent->children.at( i );
+        forgetItem( item );
+        delete item;
     }
-    if ( index )
-        *index = -1;
-    return 0;
+    parent->children.erase( parent->children.begin() + first, parent->children.begin() + last + 1 );
+    renumberChildren( parent, first );
+    q->endRemoveRows();
+}
+
+void AnnotationModelPrivate::forgetItem( AnnItem *item )
+{
+    if ( item->annotation )
+    {
+        annotationItems.remove( item->annotation );
+        return;
+    }
+
+    pageItems.remove( item->page );
+    foreach ( AnnItem *child, item->children )
+        annotationItems.remove( child->annotation );
 }
 
 
@@ -13,10 +13,18 @@
 #include <qcolor.h>
 #include <qevent.h>
 #include <qpainter.h>
+#include <qstack.h>
+
+#include <math.h>
 
 // local includes
 #include "core/annotations.h"
 
+// how many segments of a path share a bounding rect
+#define SMOOTHPATH_CHUNK 64
+// how far the points of the simplified path can be from the drawn path, in pixels
+#define SMOOTHPATH_TOLERANCE 0.5
+
 AnnotatorEngine::AnnotatorEngine( const QDomElement & engineElement )
     : m_engineElement( engineElement ), m_creationCompleted( false ), m_item( 0 )
 {
@@ -57,7 +65,7 @@ SmoothPath::SmoothPath( const QLinkedList<Okular::NormalizedPoint> &points, cons
 
 /** SmoothPathEngine */
 SmoothPathEngine::SmoothPathEngine( const QDomElement & engineElement )
-    : AnnotatorEngine( engineElement )
+    : AnnotatorEngine( engineElement ), lastXScale( 1.0 ), lastYScale( 1.0 )
 {
     // parse engine specific attributes
 }
@@ -68,6 +76,9 @@ QRect SmoothPathEngine::event( EventType type, Button button, double nX, double
     if ( button != Left )
         return QRect();
 
+    lastXScale = xScale;
+    lastYScale = yScale;
+
     // start operation
     if ( type == Press && points.isEmpty() )
     {
@@ -75,39 +86,42 @@ QRect SmoothPathEngine::event( EventType type, Button button, double nX, double
         lastPoint.y = nY;
         totalRect.left = totalRect.right = lastPoint.x;
         totalRect.top = totalRect.bottom = lastPoint.y;
-        points.append( lastPoint );
+        appendPoint( lastPoint );
     }
     // add a point to the path
     else if ( type == Move && points.count() > 0 )
     {
-        //double dist = hypot( nX - points.last().x, nY - points.last().y );
-        //if ( dist > 0.0001 )
-        //{
-            // append mouse position (as normalized point) to the list
-            Okular::NormalizedPoint nextPoint = Okular::NormalizedPoint( nX, nY );
-            points.append( nextPoint );
-            // update total rect
-            double dX = 2.0 / (double)xScale;
-            double dY = 2.0 / (double)yScale;
-            totalRect.left = qMin( totalRect.left, nX - dX );
-            totalRect.top = qMin( totalRect.top, nY - dY );
-            totalRect.right = qMax( nX + dX, totalRect.right );
-            totalRect.bottom = qMax( nY + dY, totalRect.bottom );
-            // paint the difference to previous full rect
-            Okular::NormalizedRect incrementalRect;
-            incrementalRect.left = qMin( nextPoint.x, lastPoint.x ) - dX;
-            incrementalRect.right = qMax( nextPoint.x, lastPoint.x ) + dX;
-            incrementalRect.top = qMin( nextPoint.y, lastPoint.y ) - dY;
-            incrementalRect.bottom = qMax( nextPoint.y, lastPoint.y ) + dY;
-            lastPoint = nextPoint;
-            return incrementalRect.geometry( (int)xScale, (int)yScale );
-        //}
+        // skip the points falling in the same pixel as the last one
+        if ( fabs( ( nX - lastPoint.x ) * xScale ) < 1.0 && fabs( ( nY - lastPoint.y ) * yScale ) < 1.0 )
+            return QRect();
+
+        // append mouse position (as normalized point) to the list
+        Okular::NormalizedPoint nextPoint = Okular::NormalizedPoint( nX, nY );
+        appendPoint( nextPoint );
+        // update total rect
+        double dX = 2.0 / (double)xScale;
+        double dY = 2.0 / (double)yScale;
+        totalRect.left = qMin( totalRect.left, nX - dX );
+        totalRect.top = qMin( totalRect.top, nY - dY );
+        totalRect.right = qMax( nX + dX, totalRect.right );
+        totalRect.bottom = qMax( nY + dY, totalRect.bottom );
+        // paint the difference to previous full rect
+        Okular::NormalizedRect incrementalRect;
+        incrementalRect.left = qMin( nextPoint.x, lastPoint.x ) - dX;
+        incrementalRect.right = qMax( nextPoint.x, lastPoint.x ) + dX;
+        incrementalRect.top = qMin( nextPoint.y, lastPoint.y ) - dY;
+        incrementalRect.bottom = qMax( nextPoint.y, lastPoint.y ) + dY;
+        lastPoint = nextPoint;
+        return incrementalRect.geometry( (int)xScale, (int)yScale );
     }
     // terminate process
     else if ( type == Release && points.count() > 0 )
     {
         if ( points.count() < 2 )
+        {
             points.clear();
+            chunkRects.clear();
+        }
         else
             m_creationCompleted = true;
         return totalRect.geometry( (int)xScale, (int)yScale );
@@ -115,13 +129,107 @@ QRect SmoothPathEngine::event( EventType type, Button button, double nX, double
     return QRect();
 }
 
-void SmoothPathEngine::paint( QPainter * painter, double xScale, double yScale, const QRect & /*clipRect*/ )
+void SmoothPathEngine::appendPoint( const Okular::NormalizedPoint &point )
 {
+    points.append( point );
+    const int count = points.count();
+    if ( count < 2 )
+        return;
+
+    // the segment ending at the new point
+    const int chunk = ( count - 2 ) / SMOOTHPATH_CHUNK;
+    const Okular::NormalizedPoint &previous = points.at( count - 2 );
+    const Okular::NormalizedRect segmentRect( qMin( previous.x, point.x ), qMin( previous.y, point.y ),
+                                              qMax( previous.x, point.x ), qMax( previous.y, point.y ) );
+    if ( chunk == chunkRects.count() )
+        chunkRects.append( segmentRect );
+    else
+        chunkRects[ chunk ] |= segmentRect;
+}
+
+void SmoothPathEngine::paint( QPainter * painter, double xScale, double yScale, const QRect & clipRect )
+{
+    if ( points.count() < 2 )
+        return;
+
     // use engine's color for painting
-    const SmoothPath path( points, QPen(m_engineColor, 1) );
+    painter->setPen( QPen( m_engineColor, 1 ) );
+
+    // while drawing only the area of the last segments is updated, so
+    // paint just the runs of segments crossing it
+    Okular::NormalizedRect clip( 0.0, 0.0, 1.0, 1.0 );
+    if ( clipRect.isValid() )
+        clip = Okular::NormalizedRect( clipRect.adjusted( -2, -2, 2, 2 ), xScale, yScale );
+
+    const int segments = points.count() - 1;
+    for ( int c = 0; c < chunkRects.count(); ++c )
+    {
+        if ( !chunkRects.at( c ).intersects( clip ) )
+            continue;
+
+        const int last = qMin( ( c + 1 ) * SMOOTHPATH_CHUNK, segments );
+        for ( int i = c * SMOOTHPATH_CHUNK; i < last; ++i )
+        {
+            const Okular::NormalizedPoint &pA = points.at( i );
+            const Okular::NormalizedPoint &pB = points.at( i + 1 );
+            if ( !clip.intersects( qMin( pA.x, pB.x ), qMin( pA.y, pB.y ), qMax( pA.x, pB.x ), qMax( pA.y, pB.y ) ) )
+                continue;
+
+            painter->drawLine( (int)(pA.x * (double)xScale), (int)(pA.y * (double)yScale),
+                               (int)(pB.x * (double)xScale), (int)(pB.y * (double)yScale) );
+        }
+    }
+}
+
+QLinkedList<Okular::NormalizedPoint> SmoothPathEngine::simplifiedPoints() const
+{
+    // Douglas-Peucker: keep the point farthest from the chord of each
+    // range, if it is farther than the tolerance, and split the range there
+    const int count = points.count();
+    QVector<bool> keep( count, false );
+    keep[ 0 ] = true;
+    keep[ count - 1 ] = true;
+
+    QStack< QPair<int, int> > ranges;
+    ranges.push( qMakePair( 0, count - 1 ) );
+    while ( !ranges.isEmpty() )
+    {
+        const QPair<int, int> range = ranges.pop();
+        if ( range.second - range.first < 2 )
+            continue;
+
+        // work in pixels, at the zoom the path was drawn at
+        const double ax = points.at( range.first ).x * lastXScale, ay = points.at( range.first ).y * lastYScale;
+        const double bx = points.at( range.second ).x * lastXScale, by = points.at( range.second ).y * lastYScale;
+        const double dx = bx - ax, dy = by - ay;
+        const double length = sqrt( dx * dx + dy * dy );
+
+        double maxDistance = -1;
+        int farthest = -1;
+        for ( int i = range.first + 1; i < range.second; ++i )
+        {
+            const double px = points.at( i ).x * lastXScale - ax, py = points.at( i ).y * lastYScale - ay;
+            const double distance = length > 0 ? fabs( px * dy - py * dx ) / length : sqrt( px * px + py * py );
+            if ( distance > maxDistance )
+            {
+                maxDistance = distance;
+                farthest = i;
+            }
+        }
+
+        if ( maxDistance > SMOOTHPATH_TOLERANCE )
+        {
+            keep[ farthest ] = true;
+            ranges.push( qMakePair( range.first, farthest ) );
+            ranges.push( qMakePair( farthest, range.second ) );
+        }
+    }
 
-    // draw the path
-    path.paint( painter, xScale, yScale );
+    QLinkedList<Okular::NormalizedPoint> simplified;
+    for ( int i = 0; i < count; ++i )
+        if ( keep.at( i ) )
+            simplified.append( points.at( i ) );
+    return simplified;
 }
 
 void SmoothPath::paint( QPainter * painter, double xScale, double yScale ) const
@@ -165,7 +273,7 @@ QList< Okular::Annotation* > SmoothPathEngine::end()
             ann->style().setWidth( m_annotElement.attribute( "width" ).toDouble() );
         // fill points
         QList< QLinkedList<Okular::NormalizedPoint> > list = ia->inkPaths();
-        list.append( points );
+        list.append( simplifiedPoints() );
         ia->setInkPaths( list );
         // set boundaries
         ia->setBoundingRectangle( totalRect );
@@ -196,6 +304,6 @@ SmoothPath SmoothPathEngine::endSmoothPath()
     QColor color( m_annotElement.hasAttribute( "color" ) ?
         m_annotElement.attribute( "color" ) : m_engineColor );
 
-    return SmoothPath( points, QPen(color, width) );
+    return SmoothPath( simplifiedPoints(), QPen(color, width) );
 }
 
@@ -14,6 +14,7 @@
 #include <qlinkedlist.h>
 #include <qpen.h>
 #include <qrect.h>
+#include <qvector.h>
 
 #include "core/area.h"
 
@@ -92,10 +93,18 @@ class SmoothPathEngine
         SmoothPath endSmoothPath();
 
     private:
+        void appendPoint( const Okular::NormalizedPoint &point );
+        QLinkedList<Okular::NormalizedPoint> simplifiedPoints() const;
+
         // data
-        QLinkedList<Okular::NormalizedPoint> points;
+        QVector<Okular::NormalizedPoint> points;
+        // the bounding rects of each run of segments, to paint only the
+        // segments in the area to update
+        QVector<Okular::NormalizedRect> chunkRects;
         Okular::NormalizedRect totalRect;
         Okular::NormalizedPoint lastPoint;
+        double lastXScale;
+        double lastYScale;
 };
 
 #endif
@@ -21,9 +21,11 @@
 
 #include "ktreeviewsearchline.h"
 
+#include <QtCore/QHash>
 #include <QtCore/QList>
 #include <QtCore/QTimer>
 #include <QtCore/QRegExp>
+#include <QtCore/QVector>
 #include <QtGui/QApplication>
 #include <QtGui/QContextMenuEvent>
 #include <QtGui/QHBoxLayout>
@@ -63,7 +65,46 @@ class KTreeViewSearchLine::Private
     int queuedSearches;
     QList<int> searchColumns;
 
+    struct SearchEntry
+    {
+      QModelIndex parent;
+      int row;
+      // the entry of the parent row, -1 for the top level rows
+      int parentEntry;
+      QStringList texts;
+      QStringList lowerTexts;
+      bool matched;
+      bool hidden;
+    };
+
+    // A copy of the texts of the searched columns of a tree, flattened with
+    // the parents before their children, so that a search does not query
+    // the model for every row; it is rebuilt when the model changes.
+    struct SearchIndex
+    {
+      SearchIndex()
+        : valid( false ), caseSensitive( Qt::CaseInsensitive ), regularExpression( false ), defaultMatches( false )
+      {
+      }
+
+      bool valid;
+      QVector<SearchEntry> entries;
+      // the search the entries were last matched against
+      QString search;
+      Qt::CaseSensitivity caseSensitive;
+      bool regularExpression;
+      // whether the entries were last matched against their texts, and not
+      // through a reimplemented itemMatches()
+      bool defaultMatches;
+    };
+    QHash<QTreeView *, SearchIndex> indexes;
+
+    // the search prepared for entryMatches()
+    QRegExp searchExpression;
+    QString lowerSearch;
+
     void rowsInserted(const QModelIndex & parent, int start, int end) const;
+    void modelChanged();
     void treeViewDeleted( QObject *treeView );
     void slotColumnActivated(QAction* action);
     void slotAllVisibleColumns();
@@ -71,8 +112,10 @@ class KTreeViewSearchLine::Private
     void slotRegularExpression();
 
     void checkColumns();
-    void checkItemParentsNotVisible(QTreeView *treeView);
-    bool checkItemParentsVisible(QTreeView *treeView, const QModelIndex &index);
+    void buildIndex(QTreeView *treeView, SearchIndex &index);
+    void addEntries(QTreeView *treeView, const QModelIndex &parentIndex, int parentEntry, QVector<SearchEntry> &entries);
+    bool entryMatches(const SearchEntry &entry) const;
+    void filter(QTreeView *treeView);
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -100,9 +143,21 @@ void KTreeViewSearchLine::Private::rowsInserted( const QModelIndex & parentIndex
   }
 }
 
+void KTreeViewSearchLine::Private::modelChanged()
+{
+  QAbstractItemModel* model = qobject_cast<QAbstractItemModel*>( parent->sender() );
+  if ( !model )
+    return;
+
+  foreach ( QTreeView* tree, treeViews )
+    if ( tree->model() == model )
+      indexes[ tree ].valid = false;
+}
+
 void KTreeViewSearchLine::Private::treeViewDeleted( QObject *object )
 {
   treeViews.removeAll( static_cast<QTreeView *>( object ) );
+  indexes.remove( static_cast<QTreeView *>( object ) );
   parent->setEnabled( treeViews.isEmpty() );
 }
 
@@ -142,6 +197,7 @@ void KTreeViewSearchLine::Private::slotColumnActivated( QAction *action )
     }
   }
 
+  indexes.clear();
   parent->updateSearch();
 }
 
@@ -152,6 +208,7 @@ void KTreeViewSearchLine::Private::slotAllVisibleColumns()
   else
     searchColumns.clear();
 
+  indexes.clear();
   parent->updateSearch();
 }
 
@@ -185,45 +242,131 @@ void KTreeViewSearchLine::Private::checkColumns()
   canChooseColumns = parent->canChooseColumnsCheck();
 }
 
-void KTreeViewSearchLine::Private::checkItemParentsNotVisible( QTreeView *treeView )
+void KTreeViewSearchLine::Private::buildIndex( QTreeView *treeView, SearchIndex &index )
 {
-// TODO: PORT ME
-#if 0
-  QTreeWidgetItemIterator it( treeWidget );
+  index.entries.clear();
+  addEntries( treeView, treeView->rootIndex(), -1, index.entries );
+  index.search.clear();
+  index.valid = true;
+}
+
+void KTreeViewSearchLine::Private::addEntries( QTreeView *treeView, const QModelIndex &parentIndex, int parentEntry, QVector<SearchEntry> &entries )
+{
+  const QAbstractItemModel *model = treeView->model();
+  const int rowCount = model->rowCount( parentIndex );
+  const int columnCount = model->columnCount( parentIndex );
 
-  for ( ; *it; ++it ) {
-    QTreeWidgetItem *item = *it;
-    item->treeWidget()->setItemHidden( item, !parent->itemMatches( item, search ) );
+  // If the search column list is populated, search just the columns
+  // specifified.  If it is empty default to searching all of the columns.
+  QList<int> columns;
+  if ( !searchColumns.isEmpty() ) {
+    foreach ( int column, searchColumns )
+      if ( column < columnCount )
+        columns.append( column );
+  } else {
+    for ( int i = 0; i < columnCount; ++i )
+      columns.append( i );
+  }
+
+  for ( int row = 0; row < rowCount; ++row ) {
+    SearchEntry entry;
+    entry.parent = parentIndex;
+    entry.row = row;
+    entry.parentEntry = parentEntry;
+    foreach ( int column, columns ) {
+      const QString text = model->index( row, column, parentIndex ).data( Qt::DisplayRole ).toString();
+      entry.texts.append( text );
+      entry.lowerTexts.append( text.toLower() );
+    }
+    entry.matched = false;
+    entry.hidden = treeView->isRowHidden( row, parentIndex );
+    entries.append( entry );
+
+    addEntries( treeView, model->index( row, 0, parentIndex ), entries.count() - 1, entries );
   }
-#endif
 }
 
-#include <kvbox.h>
+bool KTreeViewSearchLine::Private::entryMatches( const SearchEntry &entry ) const
+{
+  if ( search.isEmpty() )
+    return true;
 
-/** Check whether \p item, its siblings and their descendents should be shown. Show or hide the items as necessary.
+  for ( int j = 0; j < entry.texts.count(); ++j ) {
+    if ( regularExpression ) {
+      if ( searchExpression.indexIn( entry.texts.at( j ) ) >= 0 )
+        return true;
+    } else if ( caseSensitive == Qt::CaseSensitive ) {
+      if ( entry.texts.at( j ).contains( search ) )
+        return true;
+    } else if ( entry.lowerTexts.at( j ).contains( lowerSearch ) ) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/** Match the rows of \p treeView against the search, and show or hide them as necessary.
  *
- *  \p item  The list view item to start showing / hiding items at. Typically, this is the first child of another item, or the
- *              the first child of the list view.
- *  \return \c true if an item which should be visible is found, \c false if all items found should be hidden. If this function
- *             returns true and \p highestHiddenParent was not 0, highestHiddenParent will have been shown.
+ *  Unless itemMatches() is reimplemented, the rows are matched against the copy of their texts, and if the
+ *  search just got longer only the rows which matched the previous search are checked again.
+ *  The rows are shown or hidden only if their state changes.
  */
-bool KTreeViewSearchLine::Private::checkItemParentsVisible( QTreeView *treeView, const QModelIndex &index )
-{
-  bool childMatch = false;
-  const int rowcount = treeView->model()->rowCount( index );
-  for ( int i = 0; i < rowcount; ++i )
-    childMatch |= checkItemParentsVisible( treeView, treeView->model()->index( i, 0, index ) );
-
-  // Should this item be shown? It should if any children should be, or if it matches.
-  const QModelIndex parentindex = index.parent();
-  if ( childMatch || parent->itemMatches( parentindex, index.row(), search ) ) {
-    treeView->setRowHidden( index.row(), parentindex, false );
-    return true;
+void KTreeViewSearchLine::Private::filter( QTreeView *treeView )
+{
+  SearchIndex &index = indexes[ treeView ];
+  if ( !index.valid )
+    buildIndex( treeView, index );
+
+  QVector<SearchEntry> &entries = index.entries;
+  const int count = entries.count();
+
+  // A reimplemented itemMatches() may match a longer search on more rows,
+  // so the previous results are reused only if they came from the texts.
+  const bool defaultMatches = parent->usesDefaultItemMatches();
+  const bool refine = defaultMatches && index.defaultMatches && !regularExpression && !index.regularExpression
+                      && index.caseSensitive == caseSensitive
+                      && !index.search.isEmpty() && search.contains( index.search, caseSensitive );
+
+  searchExpression = QRegExp( search, caseSensitive, QRegExp::RegExp );
+  lowerSearch = search.toLower();
+
+  for ( int i = 0; i < count; ++i ) {
+    SearchEntry &entry = entries[ i ];
+    if ( refine && !entry.matched )
+      continue;
+
+    if ( defaultMatches )
+      entry.matched = entryMatches( entry );
+    else
+      entry.matched = parent->itemMatches( entry.parent, entry.row, search );
   }
 
-  treeView->setRowHidden( index.row(), parentindex, true );
+  index.search = search;
+  index.caseSensitive = caseSensitive;
+  index.regularExpression = regularExpression;
+  index.defaultMatches = defaultMatches;
+
+  // A row should be shown if it matches, or (if the parents are kept
+  // visible) if any of its children should be; the children come after
+  // their parent, so going backwards they are all done before it.
+  QVector<bool> visible( count, false );
+  for ( int i = count - 1; i >= 0; --i ) {
+    const SearchEntry &entry = entries.at( i );
+    if ( entry.matched )
+      visible[ i ] = true;
+    if ( visible.at( i ) && keepParentsVisible && entry.parentEntry != -1 )
+      visible[ entry.parentEntry ] = true;
+  }
 
-  return false;
+  for ( int i = 0; i < count; ++i ) {
+    SearchEntry &entry = entries[ i ];
+    const bool hidden = !visible.at( i );
+    if ( entry.hidden != hidden ) {
+      treeView->setRowHidden( entry.row, entry.parent, hidden );
+      entry.hidden = hidden;
+    }
+  }
 }
 
 
@@ -321,6 +464,7 @@ void KTreeViewSearchLine::removeTreeView( QTreeView *treeView )
 
     if ( index != -1 ) {
       d->treeViews.removeAt( index );
+      d->indexes.remove( treeView );
       d->checkColumns();
 
       disconnectTreeView( treeView );
@@ -351,11 +495,7 @@ void KTreeViewSearchLine::updateSearch( QTreeView *treeView )
 
   bool wasUpdateEnabled = treeView->updatesEnabled();
   treeView->setUpdatesEnabled( false );
-  if ( d->keepParentsVisible )
-    for ( int i = 0; i < treeView->model()->rowCount(); ++i )
-      d->checkItemParentsVisible( treeView, treeView->rootIndex() );
-  else
-    d->checkItemParentsNotVisible( treeView );
+  d->filter( treeView );
   treeView->setUpdatesEnabled( wasUpdateEnabled );
 
   if ( currentIndex.isValid() )
@@ -390,8 +530,10 @@ void KTreeViewSearchLine::setKeepParentsVisible( bool visible )
 
 void KTreeViewSearchLine::setSearchColumns( const QList<int> &columns )
 {
-  if ( d->canChooseColumns )
+  if ( d->canChooseColumns ) {
     d->searchColumns = columns;
+    d->indexes.clear();
+  }
 }
 
 void KTreeViewSearchLine::setTreeView( QTreeView *treeView )
@@ -406,6 +548,7 @@ void KTreeViewSearchLine::setTreeViews( const QList<QTreeView *> &treeViews )
     disconnectTreeView( treeView );
 
   d->treeViews = treeViews;
+  d->indexes.clear();
 
   foreach ( QTreeView* treeView, d->treeViews )
     connectTreeView( treeView );
@@ -453,6 +596,11 @@ bool KTreeViewSearchLine::itemMatches( const QModelIndex &index, int row, const
   return false;
 }
 
+bool KTreeViewSearchLine::usesDefaultItemMatches() const
+{
+  return true;
+}
+
 void KTreeViewSearchLine::contextMenuEvent( QContextMenuEvent *event )
 {
   QMenu *popup = KLineEdit::createStandardContextMenu();
@@ -520,6 +668,18 @@ void KTreeViewSearchLine::connectTreeView( QTreeView *treeView )
 
   connect( treeView->model(), SIGNAL(rowsInserted(QModelIndex,int,int)),
            this, SLOT(rowsInserted(QModelIndex,int,int)) );
+
+  // the search index of the view is rebuilt after any change of the model
+  connect( treeView->model(), SIGNAL(rowsInserted(QModelIndex,int,int)),
+           this, SLOT(modelChanged()) );
+  connect( treeView->model(), SIGNAL(rowsRemoved(QModelIndex,int,int)),
+           this, SLOT(modelChanged()) );
+  connect( treeView->model(), SIGNAL(dataChanged(QModelIndex,QModelIndex)),
+           this, SLOT(modelChanged()) );
+  connect( treeView->model(), SIGNAL(layoutChanged()),
+           this, SLOT(modelChanged()) );
+  connect( treeView->model(), SIGNAL(modelReset()),
+           this, SLOT(modelChanged()) );
 }
 
 void KTreeViewSearchLine::disconnectTreeView( QTreeView *treeView )
@@ -529,6 +689,8 @@ void KTreeViewSearchLine::disconnectTreeView( QTreeView *treeView )
 
   disconnect( treeView->model(), SIGNAL(rowsInserted(QModelIndex,int,int)),
               this, SLOT(rowsInserted(QModelIndex,int,int)) );
+
+  disconnect( treeView->model(), 0, this, SLOT(modelChanged()) );
 }
 
 bool KTreeViewSearchLine::canChooseColumnsCheck()
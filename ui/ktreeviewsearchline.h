@@ -205,9 +205,24 @@ class KTreeViewSearchLine : public KLineEdit
      * Returns true if \a item matches the search \a pattern.  This will be evaluated
      * based on the value of caseSensitive().  This can be overridden in
      * subclasses to implement more complicated matching schemes.
+     *
+     * The searches do not call the default implementation: they compare a copy
+     * of the texts of the views instead of querying their models. Subclasses
+     * reimplementing it have to reimplement usesDefaultItemMatches() too.
      */
     virtual bool itemMatches( const QModelIndex &item, int row, const QString &pattern ) const;
 
+    /**
+     * Returns whether the rows are matched like the default itemMatches() does,
+     * so a search compares a copy of the texts of the views instead of calling
+     * itemMatches(), and a search that extends the previous one checks again
+     * only the rows that matched the previous search.
+     *
+     * The default implementation returns true; subclasses reimplementing
+     * itemMatches() should return false.
+     */
+    virtual bool usesDefaultItemMatches() const;
+
     /**
     * Re-implemented for internal reasons.  API not affected.
     */
@@ -277,6 +292,7 @@ class KTreeViewSearchLine : public KLineEdit
     Private* const d;
 
     Q_PRIVATE_SLOT( d, void rowsInserted( const QModelIndex&, int, int ) const )
+    Q_PRIVATE_SLOT( d, void modelChanged() )
     Q_PRIVATE_SLOT( d, void treeViewDeleted( QObject* ) )
     Q_PRIVATE_SLOT( d, void slotColumnActivated( QAction* ) )
     Q_PRIVATE_SLOT( d, void slotAllVisibleColumns() )
@@ -1211,6 +1211,10 @@ void PageView::notifyZoom( int factor )
 
 bool PageView::canUnloadPixmap( int pageNumber ) const
 {
+    // nothing is seen of a hidden view (like the one of a background tab)
+    if ( !isVisible() )
+        return true;
+
     if ( Okular::Settings::memoryLevel() == Okular::Settings::EnumMemoryLevel::Low ||
          Okular::Settings::memoryLevel() == Okular::Settings::EnumMemoryLevel::Normal )
     {
@@ -1548,6 +1552,20 @@ void PageView::resizeEvent( QResizeEvent *e )
     d->verticalScrollBarVisible = verticalScrollBar()->isVisible();
 }
 
+void PageView::showEvent( QShowEvent *e )
+{
+    // let the document know we are shown, so our pixmaps are among the last
+    // ones to be freed when the memory runs short
+    d->document->setObserverVisible( PAGEVIEW_ID, true );
+    QAbstractScrollArea::showEvent( e );
+}
+
+void PageView::hideEvent( QHideEvent *e )
+{
+    d->document->setObserverVisible( PAGEVIEW_ID, false );
+    QAbstractScrollArea::hideEvent( e );
+}
+
 void PageView::keyPressEvent( QKeyEvent * e )
 {
     e->accept();
@@ -134,6 +134,8 @@ Q_OBJECT
 
     protected:
         void resizeEvent( QResizeEvent* );
+        void showEvent( QShowEvent* );
+        void hideEvent( QHideEvent* );
 
         // mouse / keyboard events
         void keyPressEvent( QKeyEvent* );
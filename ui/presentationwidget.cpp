@@ -65,6 +65,9 @@
 // comment this to disable the top-right progress indicator
 #define ENABLE_PROGRESS_OVERLAY
 
+// milliseconds between two frames of a transition
+#define TRANSITION_FRAME_INTERVAL 16
+
 
 // a frame contains a pointer to the page object, its geometry and the
 // transition effect to the next frame
@@ -130,6 +133,7 @@ class PresentationToolBar : public QToolBar
 PresentationWidget::PresentationWidget( QWidget * parent, Okular::Document * doc, KActionCollection * collection )
     : QWidget( 0 /* must be null, to have an independent widget */, Qt::FramelessWindowHint ),
     m_pressedLink( 0 ), m_handCursor( false ), m_drawingEngine( 0 ),
+    m_transitionDuration( 0 ), m_transitionRectsShown( 0 ),
     m_parentWidget( parent ),
     m_document( doc ), m_frameIndex( -1 ), m_topBar( 0 ), m_pagesEdit( 0 ), m_searchBar( 0 ),
     m_screenSelect( 0 ), m_isSetup( false ), m_blockNotifications( false ), m_inBlackScreenMode( false )
@@ -212,7 +216,7 @@ PresentationWidget::PresentationWidget( QWidget * parent, Okular::Document * doc
     setMouseTracking( true );
     setContextMenuPolicy( Qt::PreventContextMenu );
     m_transitionTimer = new QTimer( this );
-    m_transitionTimer->setSingleShot( true );
+    m_transitionTimer->setInterval( TRANSITION_FRAME_INTERVAL );
     connect( m_transitionTimer, SIGNAL(timeout()), this, SLOT(slotTransitionStep()) );
     m_overlayHideTimer = new QTimer( this );
     m_overlayHideTimer->setSingleShot( true );
@@ -487,8 +491,10 @@ void PresentationWidget::mousePressEvent( QMouseEvent * e )
         QRect r = routeMouseDrawingEvent( e );
         if ( r.isValid() )
         {
-            m_drawingRect |= r.translated( m_frames[ m_frameIndex ]->geometry.topLeft() );
-            update( m_drawingRect );
+            // repaint just the new piece of the drawing
+            const QRect updateRect = r.translated( m_frames[ m_frameIndex ]->geometry.topLeft() );
+            m_drawingRect |= updateRect;
+            update( updateRect );
         }
         return;
     }
@@ -586,8 +592,9 @@ void PresentationWidget::mouseMoveEvent( QMouseEvent * e )
             QRect r = routeMouseDrawingEvent( e );
             if ( r.isValid() )
             {
-                m_drawingRect |= r.translated( m_frames[ m_frameIndex ]->geometry.topLeft() );
-                update( m_drawingRect );
+                const QRect updateRect = r.translated( m_frames[ m_frameIndex ]->geometry.topLeft() );
+                m_drawingRect |= updateRect;
+                update( updateRect );
             }
         }
         else
@@ -638,8 +645,21 @@ void PresentationWidget::paintEvent( QPaintEvent * pe )
         return;
     }
 
-    // blit the pixmap to the screen
-    QVector<QRect> allRects = pe->region().rects();
+    // blit the pixmap to the screen; while a transition is running, what
+    // it has not revealed yet still comes from the previous screen
+    QVector<QRect> allRects;
+    uint numNewRects;
+    if ( m_transitionTimer->isActive() )
+    {
+        allRects = ( pe->region() & m_transitionRegion ).rects();
+        numNewRects = allRects.count();
+        allRects += ( pe->region() - m_transitionRegion ).rects();
+    }
+    else
+    {
+        allRects = pe->region().rects();
+        numNewRects = allRects.count();
+    }
     uint numRects = allRects.count();
     QPainter painter( this );
     for ( uint i = 0; i < numRects; i++ )
@@ -647,6 +667,7 @@ void PresentationWidget::paintEvent( QPaintEvent * pe )
         const QRect & r = allRects[i];
         if ( !r.isValid() )
             continue;
+        const QPixmap & pixmap = i < numNewRects ? m_lastRenderedPixmap : m_transitionSourcePixmap;
 #ifdef ENABLE_PROGRESS_OVERLAY
         if ( Okular::Settings::slidesShowProgress() && r.intersects( m_overlayGeometry ) )
         {
@@ -655,7 +676,7 @@ void PresentationWidget::paintEvent( QPaintEvent * pe )
             QPainter pixPainter( &backPixmap );
 
             // first draw the background on the backbuffer
-            pixPainter.drawPixmap( QPoint(0,0), m_lastRenderedPixmap, r );
+            pixPainter.drawPixmap( QPoint(0,0), pixmap, r );
 
             // then blend the overlay (a piece of) over the background
             QRect ovr = m_overlayGeometry.intersect( r );
@@ -669,7 +690,7 @@ void PresentationWidget::paintEvent( QPaintEvent * pe )
         } else
 #endif
         // copy the rendered pixmap to the screen
-        painter.drawPixmap( r.topLeft(), m_lastRenderedPixmap, r );
+        painter.drawPixmap( r.topLeft(), pixmap, r );
     }
 
     // paint drawings
@@ -684,7 +705,7 @@ void PresentationWidget::paintEvent( QPaintEvent * pe )
             drawing.paint( &painter, geom.width(), geom.height() );
 
         if ( m_drawingEngine && m_drawingRect.intersects( pe->rect() ) )
-            m_drawingEngine->paint( &painter, geom.width(), geom.height(), m_drawingRect.intersect( pe->rect() ) );
+            m_drawingEngine->paint( &painter, geom.width(), geom.height(), m_drawingRect.intersect( pe->rect() ).translated( -geom.topLeft() ) );
 
         painter.restore();
     }
@@ -857,6 +878,12 @@ void PresentationWidget::changePage( int newPage )
 
 void PresentationWidget::generatePage( bool disableTransition )
 {
+    const bool useTransition = !disableTransition && Okular::Settings::slidesTransitionsEnabled();
+
+    // keep the current screen, for the transition to start from (painting
+    // detaches the rendered pixmap, so this is not overwritten)
+    m_transitionSourcePixmap = useTransition ? m_lastRenderedPixmap : QPixmap();
+
     if ( m_lastRenderedPixmap.isNull() )
         m_lastRenderedPixmap = QPixmap( m_width, m_height );
 
@@ -878,7 +905,7 @@ void PresentationWidget::generatePage( bool disableTransition )
 #endif
 
     // start transition on pages that have one
-    if ( !disableTransition && Okular::Settings::slidesTransitionsEnabled() )
+    if ( useTransition )
     {
         const Okular::PageTransition * transition = m_frameIndex != -1 ?
             m_frames[ m_frameIndex ]->page->transition() : 0;
@@ -1249,6 +1276,7 @@ void PresentationWidget::slotNextPage()
         if ( m_transitionTimer->isActive() )
         {
             m_transitionTimer->stop();
+            m_transitionSourcePixmap = QPixmap();
             update();
         }
     }
@@ -1275,6 +1303,7 @@ void PresentationWidget::slotPrevPage()
         if ( m_transitionTimer->isActive() )
         {
             m_transitionTimer->stop();
+            m_transitionSourcePixmap = QPixmap();
             update();
         }
     }
@@ -1299,20 +1328,30 @@ void PresentationWidget::slotHideOverlay()
 
 void PresentationWidget::slotTransitionStep()
 {
-    if ( m_transitionRects.empty() )
+    // reveal the rects that are due by now, so the transition lasts its
+    // duration whatever the number of rects and the speed of the painting
+    const int count = m_transitionRects.count();
+    const int elapsed = m_transitionStart.elapsed();
+    const int due = elapsed < m_transitionDuration ?
+        (int)( ( (qint64)count * elapsed ) / m_transitionDuration ) : count;
+
+    QRegion revealed;
+    for ( ; m_transitionRectsShown < due; ++m_transitionRectsShown )
+        revealed += m_transitionRects[ m_transitionRectsShown ];
+
+    m_transitionRegion += revealed;
+    if ( m_transitionRectsShown >= count )
     {
-        // it's better to fix the transition to cover the whole screen than
-        // enabling the following line that wastes cpu for nothing
-        //update();
-        return;
+        // the rects may leave some gaps, show the new page there too
+        revealed += QRegion( 0, 0, m_width, m_height ) - m_transitionRegion;
+        m_transitionTimer->stop();
+        m_transitionRects.clear();
+        m_transitionRegion = QRegion();
+        m_transitionSourcePixmap = QPixmap();
     }
 
-    for ( int i = 0; i < m_transitionMul && !m_transitionRects.empty(); i++ )
-    {
-        update( m_transitionRects.first() );
-        m_transitionRects.pop_front();
-    }
-    m_transitionTimer->start( m_transitionDelay );
+    if ( !revealed.isEmpty() )
+        update( revealed );
 }
 
 void PresentationWidget::slotDelayedEvents()
@@ -1664,9 +1703,17 @@ const Okular::PageTransition PresentationWidget::defaultTransition( int type ) c
 /** ONLY the TRANSITIONS GENERATION function from here on **/
 void PresentationWidget::initTransition( const Okular::PageTransition *transition )
 {
-    // if it's just a 'replace' transition, repaint the screen
-    if ( transition->type() == Okular::PageTransition::Replace )
+    m_transitionTimer->stop();
+    m_transitionRects.clear();
+    m_transitionRegion = QRegion();
+    m_transitionRectsShown = 0;
+
+    // if it's just a 'replace' transition, or there is nothing to start
+    // from, repaint the screen
+    if ( transition->type() == Okular::PageTransition::Replace ||
+         m_transitionSourcePixmap.size() != m_lastRenderedPixmap.size() )
     {
+        m_transitionSourcePixmap = QPixmap();
         update();
         return;
     }
@@ -1675,8 +1722,6 @@ void PresentationWidget::initTransition( const Okular::PageTransition *transitio
     const bool isHorizontal = transition->alignment() == Okular::PageTransition::Horizontal;
     const float totalTime = transition->duration();
 
-    m_transitionRects.clear();
-
     switch( transition->type() )
     {
             // split: horizontal / vertical and inward / outward
@@ -1733,8 +1778,6 @@ void PresentationWidget::initTransition( const Okular::PageTransition *transitio
                     }
                 }
             }
-            m_transitionMul = 2;
-            m_transitionDelay = (int)( (totalTime * 1000) / steps );
         } break;
 
             // blinds: horizontal(l-to-r) / vertical(t-to-b)
@@ -1774,8 +1817,6 @@ void PresentationWidget::initTransition( const Okular::PageTransition *transitio
                     }
                 }
             }
-            m_transitionMul = blinds;
-            m_transitionDelay = (int)( (totalTime * 1000) / steps );
         } break;
 
             // box: inward / outward
@@ -1818,8 +1859,6 @@ void PresentationWidget::initTransition( const Okular::PageTransition *transitio
                     L = newL; T = newT; R = newR, B = newB;
                 }
             }
-            m_transitionMul = 4;
-            m_transitionDelay = (int)( (totalTime * 1000) / steps );
         } break;
 
             // wipe: implemented for 4 canonical angles
@@ -1869,11 +1908,10 @@ void PresentationWidget::initTransition( const Okular::PageTransition *transitio
             }
             else
             {
+                m_transitionSourcePixmap = QPixmap();
                 update();
                 return;
             }
-            m_transitionMul = 1;
-            m_transitionDelay = (int)( (totalTime * 1000) / steps );
         } break;
 
             // dissolve: replace 'random' rects
@@ -1911,8 +1949,6 @@ void PresentationWidget::initTransition( const Okular::PageTransition *transitio
                 }
             }
             // set global transition parameters
-            m_transitionMul = 40;
-            m_transitionDelay = (int)( (m_transitionMul * 1000 * totalTime) / steps );
         } break;
 
             // glitter: similar to dissolve but has a direction
@@ -2002,9 +2038,6 @@ void PresentationWidget::initTransition( const Okular::PageTransition *transitio
                 }
             }
             // set global transition parameters
-            m_transitionMul = (angle == 90) || (angle == 270) ? gridYsteps : gridXsteps;
-            m_transitionMul /= 2;
-            m_transitionDelay = (int)( (m_transitionMul * 1000 * totalTime) / steps );
         } break;
 
         // implement missing transitions (a binary raster engine needed here)
@@ -2019,12 +2052,14 @@ void PresentationWidget::initTransition( const Okular::PageTransition *transitio
         case Okular::PageTransition::Fade:
 
         default:
+            m_transitionSourcePixmap = QPixmap();
             update();
             return;
     }
 
-    // send the first start to the timer
-    m_transitionTimer->start( 0 );
+    m_transitionDuration = (int)( totalTime * 1000 );
+    m_transitionStart.start();
+    m_transitionTimer->start();
 }
 
 void PresentationWidget::slotProcessMovieAction( const Okular::MovieAction *action )
@@ -12,7 +12,10 @@
 
 #include <qlist.h>
 #include <qpixmap.h>
+#include <qregion.h>
 #include <qstringlist.h>
+#include <qdatetime.h>
+#include <qvector.h>
 #include <qwidget.h>
 #include "ui/annotationtools.h"
 #include "core/area.h"
@@ -115,9 +118,15 @@ class PresentationWidget : public QWidget, public Okular::DocumentObserver
         QTimer * m_transitionTimer;
         QTimer * m_overlayHideTimer;
         QTimer * m_nextPageTimer;
-        int m_transitionDelay;
-        int m_transitionMul;
-        QList< QRect > m_transitionRects;
+        // the rects of the transition are revealed in order, as many as
+        // the time elapsed since the start over the duration allows
+        QTime m_transitionStart;
+        int m_transitionDuration;
+        int m_transitionRectsShown;
+        QVector< QRect > m_transitionRects;
+        QRegion m_transitionRegion;
+        // what was on the screen before the transition started
+        QPixmap m_transitionSourcePixmap;
 
         // misc stuff
         QWidget * m_parentWidget;
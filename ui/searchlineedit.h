@@ -63,6 +63,7 @@ class SearchLineEdit : public KLineEdit
         bool m_changed;
         bool m_fromStart;
         bool m_searchRunning;
+        QString m_lastSearchText;
 
     private slots:
         void slotTextChanged( const QString & text );
@@ -11,6 +11,7 @@
 
 // qt/kde includes
 #include <qevent.h>
+#include <qmap.h>
 #include <qtimer.h>
 #include <qpainter.h>
 #include <qscrollbar.h>
@@ -55,7 +56,13 @@ class ThumbnailListPrivate : public QWidget
         ThumbnailWidget *m_selected;
         QTimer *m_delayTimer;
         QPixmap *m_bookmarkOverlay;
-        QVector<ThumbnailWidget *> m_thumbnails;
+        // the pages shown, in order, and the top of the thumbnail of each
+        // of them followed by the end of the last one; the thumbnails are
+        // created only around the visible area, indexed as the pages
+        QVector<const Okular::Page *> m_pages;
+        QVector<int> m_offsets;
+        int m_thumbnailWidth;
+        QMap<int, ThumbnailWidget *> m_thumbnails;
         QList<ThumbnailWidget *> m_visibleThumbnails;
         int m_vectorIndex;
         // Grabbing variables
@@ -70,7 +77,21 @@ class ThumbnailListPrivate : public QWidget
         // called by ThumbnailWidgets to send (forward) the mouse move signals
         ChangePageDirection forwardTrack( const QPoint &, const QSize & );
 
-        ThumbnailWidget* itemFor( const QPoint & p ) const;
+        // compute the position of the thumbnails for the given width, and
+        // return the height of the contents
+        int layoutThumbnails( int width );
+        // index of the thumbnail at (or of the spacing below it) the y
+        int indexAt( int y ) const;
+        // index of the page, or of the first shown one after it
+        int lowerBoundPage( int pageNumber ) const;
+        int indexOfPage( int pageNumber ) const;
+        QRect thumbnailRect( int index ) const;
+        // the thumbnail at the index, created if needed
+        ThumbnailWidget* thumbnail( int index );
+        // delete the thumbnails out of the range (but the ones in use)
+        void releaseThumbnails( int first, int last );
+
+        ThumbnailWidget* itemFor( const QPoint & p );
         void delayedRequestVisiblePixmaps( int delayMs = 0 );
 
         // SLOTS:
@@ -78,9 +99,9 @@ class ThumbnailListPrivate : public QWidget
         void slotRequestVisiblePixmaps( int newContentsY = -1 );
         // delay timeout: resize overlays and requests pixmaps
         void slotDelayTimeout();
-        ThumbnailWidget* getPageByNumber( int page ) const;
+        ThumbnailWidget* getPageByNumber( int page );
         int getNewPageOffset( int n, ThumbnailListPrivate::ChangePageDirection dir ) const;
-        ThumbnailWidget *getThumbnailbyOffset( int current, int offset ) const;
+        ThumbnailWidget *getThumbnailbyOffset( int current, int offset );
 
     protected:
         void mousePressEvent( QMouseEvent * e );
@@ -116,6 +137,9 @@ class ThumbnailWidget
         void paint( QPainter &p, const QRect &clipRect );
 
         static int margin() { return m_margin; }
+        // the height of the thumbnail of the page when fit in the width
+        static int heightForWidth( const Okular::Page * page, int width, int labelHeight )
+        { return qRound( page->ratio() * (double)( width - m_margin ) ) + labelHeight + m_margin; }
 
         // simulating QWidget
         QRect rect() const { return m_rect; }
@@ -142,52 +166,142 @@ class ThumbnailWidget
 
 ThumbnailListPrivate::ThumbnailListPrivate( ThumbnailList *qq, Okular::Document *document )
     : QWidget(), q( qq ), m_document( document ), m_selected( 0 ),
-    m_delayTimer( 0 ), m_bookmarkOverlay( 0 ), m_vectorIndex( 0 )
+    m_delayTimer( 0 ), m_bookmarkOverlay( 0 ), m_thumbnailWidth( 0 ), m_vectorIndex( 0 )
 {
     setMouseTracking( true );
     m_mouseGrabItem = 0;
 }
 
 
-ThumbnailWidget* ThumbnailListPrivate::getPageByNumber( int page ) const
+ThumbnailWidget* ThumbnailListPrivate::getPageByNumber( int page )
 {
-    QVector< ThumbnailWidget * >::const_iterator tIt = m_thumbnails.constBegin(), tEnd = m_thumbnails.constEnd();
+    const int index = indexOfPage( page );
+    return index != -1 ? thumbnail( index ) : 0;
+}
+
+ThumbnailListPrivate::~ThumbnailListPrivate()
+{
+    qDeleteAll( m_thumbnails );
+}
+
+int ThumbnailListPrivate::layoutThumbnails( int width )
+{
+    // the heights come from the ratio of the pages, so there is no need
+    // of the thumbnails themselves to lay them out
+    const int labelHeight = QFontMetrics( font() ).height();
+    const int spacing = KDialog::spacingHint();
+    const int count = m_pages.count();
+    m_offsets.resize( count + 1 );
+    int height = 0;
+    for ( int i = 0; i < count; ++i )
+    {
+        m_offsets[ i ] = height;
+        height += ThumbnailWidget::heightForWidth( m_pages[ i ], width, labelHeight ) + spacing;
+    }
+    m_offsets[ count ] = height;
+    m_thumbnailWidth = width;
+
+    QMap<int, ThumbnailWidget *>::const_iterator tIt = m_thumbnails.constBegin(), tEnd = m_thumbnails.constEnd();
     for ( ; tIt != tEnd; ++tIt )
     {
-        if ( (*tIt)->pageNumber() == page )
-            return (*tIt);
+        tIt.value()->move( 0, m_offsets[ tIt.key() ] );
+        tIt.value()->resizeFitWidth( width );
     }
-    return 0;
+
+    return count > 0 ? height - spacing : 0;
 }
 
-ThumbnailListPrivate::~ThumbnailListPrivate()
+int ThumbnailListPrivate::indexAt( int y ) const
 {
+    if ( m_pages.isEmpty() )
+        return -1;
+
+    const int index = qUpperBound( m_offsets.constBegin(), m_offsets.constEnd() - 1, y ) - m_offsets.constBegin() - 1;
+    return qBound( 0, index, m_pages.count() - 1 );
 }
 
-ThumbnailWidget* ThumbnailListPrivate::itemFor( const QPoint & p ) const
+int ThumbnailListPrivate::lowerBoundPage( int pageNumber ) const
 {
-    QVector< ThumbnailWidget * >::const_iterator tIt = m_thumbnails.constBegin(), tEnd = m_thumbnails.constEnd();
-    for ( ; tIt != tEnd; ++tIt )
+    // the pages are sorted by number
+    int low = 0, high = m_pages.count();
+    while ( low < high )
     {
-        if ( (*tIt)->rect().contains( p ) )
-            return (*tIt);
+        const int middle = ( low + high ) / 2;
+        if ( (int)m_pages[ middle ]->number() < pageNumber )
+            low = middle + 1;
+        else
+            high = middle;
     }
-    return 0;
+    return low;
+}
+
+int ThumbnailListPrivate::indexOfPage( int pageNumber ) const
+{
+    const int index = lowerBoundPage( pageNumber );
+    if ( index < m_pages.count() && (int)m_pages[ index ]->number() == pageNumber )
+        return index;
+    return -1;
+}
+
+QRect ThumbnailListPrivate::thumbnailRect( int index ) const
+{
+    return QRect( 0, m_offsets[ index ], m_thumbnailWidth, m_offsets[ index + 1 ] - m_offsets[ index ] - KDialog::spacingHint() );
+}
+
+ThumbnailWidget* ThumbnailListPrivate::thumbnail( int index )
+{
+    ThumbnailWidget *&t = m_thumbnails[ index ];
+    if ( !t )
+    {
+        t = new ThumbnailWidget( this, m_pages[ index ] );
+        t->move( 0, m_offsets[ index ] );
+        t->resizeFitWidth( m_thumbnailWidth );
+    }
+    return t;
+}
+
+void ThumbnailListPrivate::releaseThumbnails( int first, int last )
+{
+    QMap<int, ThumbnailWidget *>::iterator tIt = m_thumbnails.begin();
+    while ( tIt != m_thumbnails.end() )
+    {
+        ThumbnailWidget *t = tIt.value();
+        if ( ( tIt.key() < first || tIt.key() > last ) && t != m_selected && t != m_mouseGrabItem )
+        {
+            delete t;
+            tIt = m_thumbnails.erase( tIt );
+        }
+        else
+            ++tIt;
+    }
+}
+
+ThumbnailWidget* ThumbnailListPrivate::itemFor( const QPoint & p )
+{
+    const int index = indexAt( p.y() );
+    if ( index == -1 || !thumbnailRect( index ).contains( p ) )
+        return 0;
+    return thumbnail( index );
 }
 
 void ThumbnailListPrivate::paintEvent( QPaintEvent * e )
 {
+    if ( m_pages.isEmpty() )
+        return;
+
     QPainter painter( this );
-    QVector<ThumbnailWidget *>::const_iterator tIt = m_thumbnails.constBegin(), tEnd = m_thumbnails.constEnd();
-    for ( ; tIt != tEnd; ++tIt )
+    const int first = indexAt( e->rect().top() );
+    const int last = indexAt( e->rect().bottom() );
+    for ( int i = first; i <= last; ++i )
     {
-        QRect rect = e->rect().intersected( (*tIt)->rect() );
+        QRect rect = e->rect().intersected( thumbnailRect( i ) );
         if ( !rect.isNull() )
         {
-            rect.translate( -(*tIt)->pos() );
+            ThumbnailWidget *t = thumbnail( i );
+            rect.translate( -t->pos() );
             painter.save();
-            painter.translate( (*tIt)->pos() );
-            (*tIt)->paint( painter, rect );
+            painter.translate( t->pos() );
+            t->paint( painter, rect );
             painter.restore();
         }
     }
@@ -245,10 +359,10 @@ void ThumbnailList::notifySetup( const QVector< Okular::Page * > & pages, int se
         prevPage = d->m_document->viewport().pageNumber;
 
     // delete all the Thumbnails
-    QVector<ThumbnailWidget *>::const_iterator tIt = d->m_thumbnails.constBegin(), tEnd = d->m_thumbnails.constEnd();
-    for ( ; tIt != tEnd; ++tIt )
-        delete *tIt;
+    qDeleteAll( d->m_thumbnails );
     d->m_thumbnails.clear();
+    d->m_pages.clear();
+    d->m_offsets.clear();
     d->m_visibleThumbnails.clear();
     d->m_selected = 0;
     d->m_mouseGrabItem = 0;
@@ -270,36 +384,32 @@ void ThumbnailList::notifySetup( const QVector< Okular::Page * > & pages, int se
         if ( (*pIt)->hasHighlights( SW_SEARCH_ID ) )
             skipCheck = false;
 
-    // generate Thumbnails for the given set of pages
-    const int width = viewport()->width();
-    int height = 0;
-    int centerHeight = 0;
+    // lay out the Thumbnails for the given set of pages; they are created
+    // when they get close to the visible area
     for ( pIt = pages.constBegin(); pIt != pEnd ; ++pIt )
         //if ( skipCheck || (*pIt)->attributes() & flags )
         if ( skipCheck || (*pIt)->hasHighlights( SW_SEARCH_ID ) )
-        {
-            ThumbnailWidget * t = new ThumbnailWidget( d, *pIt );
-            t->move(0, height);
-            // add to the internal queue
-            d->m_thumbnails.push_back( t );
-            // update total height (asking widget its own height)
-            t->resizeFitWidth( width );
-            // restoring the previous selected page, if any
-            if ( (*pIt)->number() < prevPage )
-            {
-                centerHeight = height + t->height() + KDialog::spacingHint()/2;
-            }
-            if ( (*pIt)->number() == prevPage )
-            {
-                d->m_selected = t;
-                d->m_selected->setSelected( true );
-                centerHeight = height + t->height() / 2;
-            }
-            height += t->height() + KDialog::spacingHint();
-        }
+            d->m_pages.push_back( *pIt );
+
+    const int width = viewport()->width();
+    const int height = d->layoutThumbnails( width );
+
+    // restoring the previous selected page, if any
+    int centerHeight = 0;
+    const int prevIndex = d->lowerBoundPage( prevPage );
+    if ( prevIndex < d->m_pages.count() && (int)d->m_pages[ prevIndex ]->number() == prevPage )
+    {
+        d->m_selected = d->thumbnail( prevIndex );
+        d->m_selected->setSelected( true );
+        d->m_vectorIndex = prevIndex;
+        centerHeight = d->m_offsets[ prevIndex ] + d->m_selected->height() / 2;
+    }
+    else if ( prevIndex > 0 )
+    {
+        centerHeight = d->m_offsets[ prevIndex ] - KDialog::spacingHint() / 2;
+    }
 
     // update scrollview's contents size (sets scrollbars limits)
-    height -= KDialog::spacingHint();
     widget()->resize( width, height );
 
     // enable scrollbar when there's something to scroll
@@ -323,22 +433,17 @@ void ThumbnailList::notifyViewportChanged( bool /*smoothMove*/ )
     d->m_selected = 0;
 
     // select the page with viewport and ensure it's centered in the view
-    d->m_vectorIndex = 0;
-    QVector<ThumbnailWidget *>::const_iterator tIt = d->m_thumbnails.constBegin(), tEnd = d->m_thumbnails.constEnd();
-    for ( ; tIt != tEnd; ++tIt )
+    const int index = d->indexOfPage( newPage );
+    d->m_vectorIndex = qMax( index, 0 );
+    if ( index != -1 )
     {
-        if ( (*tIt)->pageNumber() == newPage )
+        d->m_selected = d->thumbnail( index );
+        d->m_selected->setSelected( true );
+        if ( Okular::Settings::syncThumbnailsViewport() )
         {
-            d->m_selected = *tIt;
-            d->m_selected->setSelected( true );
-            if ( Okular::Settings::syncThumbnailsViewport() )
-            {
-                int yOffset = qMax( viewport()->height() / 4, d->m_selected->height() / 2 );
-                ensureVisible( 0, d->m_selected->pos().y() + d->m_selected->height()/2, 0, yOffset );
-            }
-            break;
+            int yOffset = qMax( viewport()->height() / 4, d->m_selected->height() / 2 );
+            ensureVisible( 0, d->m_selected->pos().y() + d->m_selected->height()/2, 0, yOffset );
         }
-        d->m_vectorIndex++;
     }
 }
 
@@ -370,23 +475,25 @@ void ThumbnailList::notifyVisibleRectsChanged()
 {
     bool found = false;
     const QVector<Okular::VisiblePageRect *> & visibleRects = d->m_document->visiblePageRects();
-    QVector<ThumbnailWidget *>::const_iterator tIt = d->m_thumbnails.constBegin(), tEnd = d->m_thumbnails.constEnd();
+    // the thumbnails not created yet get their visible rect when created
+    QMap<int, ThumbnailWidget *>::const_iterator tIt = d->m_thumbnails.constBegin(), tEnd = d->m_thumbnails.constEnd();
     QVector<Okular::VisiblePageRect *>::const_iterator vEnd = visibleRects.end();
     for ( ; tIt != tEnd; ++tIt )
     {
+        ThumbnailWidget *t = tIt.value();
         found = false;
         QVector<Okular::VisiblePageRect *>::const_iterator vIt = visibleRects.begin();
         for ( ; ( vIt != vEnd ) && !found; ++vIt )
         {
-            if ( (*tIt)->pageNumber() == (*vIt)->pageNumber )
+            if ( t->pageNumber() == (*vIt)->pageNumber )
             {
-                (*tIt)->setVisibleRect( (*vIt)->rect );
+                t->setVisibleRect( (*vIt)->rect );
                 found = true;
             }
         }
         if ( !found )
         {
-            (*tIt)->setVisibleRect( Okular::NormalizedRect() );
+            t->setVisibleRect( Okular::NormalizedRect() );
         }
     }
 }
@@ -448,24 +555,15 @@ int ThumbnailListPrivate::getNewPageOffset(int n, ThumbnailListPrivate::ChangePa
     return 0;
 }
 
-ThumbnailWidget *ThumbnailListPrivate::getThumbnailbyOffset(int current, int offset) const
+ThumbnailWidget *ThumbnailListPrivate::getThumbnailbyOffset(int current, int offset)
 {
-    QVector<ThumbnailWidget *>::const_iterator it = m_thumbnails.begin();
-    QVector<ThumbnailWidget *>::const_iterator itE = m_thumbnails.end();
-    int idx = 0;
-    while ( it != itE )
-    {
-        if ( (*it)->pageNumber() == current )
-            break;
-        ++idx;
-        ++it;
-    }
-    if ( it == itE )
+    int idx = indexOfPage( current );
+    if ( idx == -1 )
         return 0;
     idx += offset;
-    if ( idx < 0 || idx >= m_thumbnails.size() )
+    if ( idx < 0 || idx >= m_pages.size() )
         return 0;
-    return m_thumbnails[idx];
+    return thumbnail( idx );
 }
 
 ThumbnailListPrivate::ChangePageDirection ThumbnailListPrivate::forwardTrack(const QPoint &point, const QSize &r )
@@ -508,7 +606,7 @@ void ThumbnailList::slotFilterBookmarks( bool filterOn )
 //BEGIN widget events 
 void ThumbnailList::keyPressEvent( QKeyEvent * keyEvent )
 {
-    if ( d->m_thumbnails.count() < 1 )
+    if ( d->m_pages.count() < 1 )
         return keyEvent->ignore();
 
     int nextPage = -1;
@@ -517,23 +615,23 @@ void ThumbnailList::keyPressEvent( QKeyEvent * keyEvent )
         if ( !d->m_selected )
             nextPage = 0;
         else if ( d->m_vectorIndex > 0 )
-            nextPage = d->m_thumbnails[ d->m_vectorIndex - 1 ]->pageNumber();
+            nextPage = d->m_pages[ d->m_vectorIndex - 1 ]->number();
     }
     else if ( keyEvent->key() == Qt::Key_Down )
     {
         if ( !d->m_selected )
             nextPage = 0;
-        else if ( d->m_vectorIndex < (int)d->m_thumbnails.count() - 1 )
-            nextPage = d->m_thumbnails[ d->m_vectorIndex + 1 ]->pageNumber();
+        else if ( d->m_vectorIndex < (int)d->m_pages.count() - 1 )
+            nextPage = d->m_pages[ d->m_vectorIndex + 1 ]->number();
     }
     else if ( keyEvent->key() == Qt::Key_PageUp )
         verticalScrollBar()->triggerAction( QScrollBar::SliderPageStepSub );
     else if ( keyEvent->key() == Qt::Key_PageDown )
         verticalScrollBar()->triggerAction( QScrollBar::SliderPageStepAdd );
     else if ( keyEvent->key() == Qt::Key_Home )
-        nextPage = d->m_thumbnails[ 0 ]->pageNumber();
+        nextPage = d->m_pages[ 0 ]->number();
     else if ( keyEvent->key() == Qt::Key_End )
-        nextPage = d->m_thumbnails[ d->m_thumbnails.count() - 1 ]->pageNumber();
+        nextPage = d->m_pages[ d->m_pages.count() - 1 ]->number();
 
     if ( nextPage == -1 )
         return keyEvent->ignore();
@@ -562,7 +660,7 @@ bool ThumbnailList::viewportEvent( QEvent * e )
 
 void ThumbnailListPrivate::viewportResizeEvent( QResizeEvent * e )
 {
-    if ( m_thumbnails.count() < 1 || width() < 1 )
+    if ( m_pages.count() < 1 || width() < 1 )
         return;
 
     // if width changed resize all the Thumbnails, reposition them to the
@@ -574,18 +672,9 @@ void ThumbnailListPrivate::viewportResizeEvent( QResizeEvent * e )
 
         // resize and reposition items
         const int newWidth = q->viewport()->width();
-        int newHeight = 0;
-        QVector<ThumbnailWidget *>::const_iterator tIt = m_thumbnails.constBegin(), tEnd = m_thumbnails.constEnd();
-        for ( ; tIt != tEnd; ++tIt )
-        {
-            ThumbnailWidget *t = *tIt;
-            t->move(0, newHeight);
-            t->resizeFitWidth( newWidth );
-            newHeight += t->height() + KDialog::spacingHint();
-        }
+        const int newHeight = layoutThumbnails( newWidth );
 
         // update scrollview's contents size (sets scrollbars limits)
-        newHeight -= KDialog::spacingHint();
         const int oldHeight = q->widget()->height();
         const int oldYCenter = q->verticalScrollBar()->value() + q->viewport()->height() / 2;
         q->widget()->resize( newWidth, newHeight );
@@ -629,17 +718,28 @@ void ThumbnailListPrivate::slotRequestVisiblePixmaps( int /*newContentsY*/ )
     if ( ( m_delayTimer && m_delayTimer->isActive() ) || q->isHidden() )
         return;
 
-    // scroll from the top to the last visible thumbnail
     m_visibleThumbnails.clear();
-    QLinkedList< Okular::PixmapRequest * > requestedPixmaps;
-    QVector<ThumbnailWidget *>::const_iterator tIt = m_thumbnails.constBegin(), tEnd = m_thumbnails.constEnd();
+    if ( m_pages.isEmpty() )
+        return;
+
+    // keep the thumbnails within a viewport height of the visible ones,
+    // and delete the others
     const QRect viewportRect = q->viewport()->rect().translated( q->horizontalScrollBar()->value(), q->verticalScrollBar()->value() );
-    for ( ; tIt != tEnd; ++tIt )
+    const int first = indexAt( viewportRect.top() );
+    const int last = indexAt( viewportRect.bottom() );
+    const int prefetchFirst = indexAt( viewportRect.top() - viewportRect.height() );
+    const int prefetchLast = indexAt( viewportRect.bottom() + viewportRect.height() );
+    releaseThumbnails( prefetchFirst, prefetchLast );
+    for ( int i = prefetchFirst; i <= prefetchLast; ++i )
+        thumbnail( i );
+
+    // go from the first to the last visible thumbnail
+    QLinkedList< Okular::PixmapRequest * > requestedPixmaps;
+    for ( int i = first; i <= last; ++i )
     {
-        ThumbnailWidget * t = *tIt;
-        const QRect thumbRect = t->rect();
-        if ( !thumbRect.intersects( viewportRect ) )
+        if ( !thumbnailRect( i ).intersects( viewportRect ) )
           continue;
+        ThumbnailWidget * t = thumbnail( i );
         // add ThumbnailWidget to visible list
         m_visibleThumbnails.push_back( t );
         // if pixmap not present add it to requests
@@ -692,6 +792,17 @@ ThumbnailWidget::ThumbnailWidget( ThumbnailListPrivate * parent, const Okular::P
     m_labelNumber = m_page->number() + 1;
     m_labelHeight = QFontMetrics( m_parent->font() ).height();
 
+    // the thumbnails are created late, so pick the current visible rect
+    const QVector<Okular::VisiblePageRect *> & visibleRects = m_parent->m_document->visiblePageRects();
+    QVector<Okular::VisiblePageRect *>::const_iterator vIt = visibleRects.constBegin(), vEnd = visibleRects.constEnd();
+    for ( ; vIt != vEnd; ++vIt )
+    {
+        if ( (*vIt)->pageNumber == m_labelNumber - 1 )
+        {
+            m_visibleRect = (*vIt)->rect;
+            break;
+        }
+    }
 }
 
 void ThumbnailWidget::resizeFitWidth( int width )